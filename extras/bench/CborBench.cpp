@@ -0,0 +1,101 @@
+#include <chrono>
+
+#include <GSMCbor.h>
+
+//size and encoding time of one telemetry record as CBOR (integer and text keys) and as
+//the equivalent JSON, built with String concatenation as sketches did and with snprintf
+struct Record {
+    uint32_t time;
+    float lat;
+    float lon;
+    uint16_t speed;
+    uint16_t course;
+    uint8_t sats;
+    uint16_t battery;
+    bool fix;
+};
+
+enum {KEY_TIME, KEY_LAT, KEY_LON, KEY_SPEED, KEY_COURSE, KEY_SATS, KEY_BATTERY, KEY_FIX};
+static const char* const KEY_NAMES[] = {"time", "lat", "lon", "speed", "course", "sats", "battery", "fix"};
+static constexpr CborKeyTable INTEGER_KEYS(KEY_NAMES);
+static constexpr CborKeyTable TEXT_KEYS(KEY_NAMES, false);
+
+static uint32_t cbor(const Record& r, const CborKeyTable& keys, uint8_t* buf, uint16_t size)
+{
+    CborWriter writer(buf, size);
+    writer.setKeys(keys);
+    writer.beginMap(8);
+    writer.key(KEY_TIME);
+    writer.writeUint(r.time);
+    writer.key(KEY_LAT);
+    writer.writeFloat(r.lat);
+    writer.key(KEY_LON);
+    writer.writeFloat(r.lon);
+    writer.key(KEY_SPEED);
+    writer.writeUint(r.speed);
+    writer.key(KEY_COURSE);
+    writer.writeUint(r.course);
+    writer.key(KEY_SATS);
+    writer.writeUint(r.sats);
+    writer.key(KEY_BATTERY);
+    writer.writeUint(r.battery);
+    writer.key(KEY_FIX);
+    writer.writeBool(r.fix);
+    return writer.ok() ? writer.length() : 0;
+}
+
+static uint32_t jsonString(const Record& r)
+{
+    String json = "{\"time\":";
+    json += r.time;
+    json += ",\"lat\":";
+    json += String(r.lat, 6);
+    json += ",\"lon\":";
+    json += String(r.lon, 6);
+    json += ",\"speed\":";
+    json += r.speed;
+    json += ",\"course\":";
+    json += r.course;
+    json += ",\"sats\":";
+    json += r.sats;
+    json += ",\"battery\":";
+    json += r.battery;
+    json += ",\"fix\":";
+    json += r.fix ? "true" : "false";
+    json += "}";
+    return json.length();
+}
+
+static uint32_t jsonPrintf(const Record& r, char* buf, uint16_t size)
+{
+    int n = snprintf(buf, size, "{\"time\":%lu,\"lat\":%.6f,\"lon\":%.6f,\"speed\":%u,\"course\":%u,"
+        "\"sats\":%u,\"battery\":%u,\"fix\":%s}", (unsigned long)r.time, r.lat, r.lon, r.speed, r.course,
+        r.sats, r.battery, r.fix ? "true" : "false");
+    return n > 0 && n < size ? n : 0;
+}
+
+template <typename Encode>
+static void run(const char* name, Encode encode)
+{
+    const int rounds = 200000;
+    Record r = {1760860800, 45.464211f, 9.191383f, 37, 271, 9, 3980, true};
+    uint32_t len = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        r.time++;
+        len = encode(r);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-22s %6u %10.0f\n", name, len, elapsed * 1e9 / rounds);
+}
+
+int main()
+{
+    static uint8_t buf[128];
+    printf("%-22s %6s %10s\n", "encoding", "bytes", "ns/record");
+    run("CBOR integer keys", [](const Record& r) { return cbor(r, INTEGER_KEYS, buf, sizeof(buf)); });
+    run("CBOR text keys", [](const Record& r) { return cbor(r, TEXT_KEYS, buf, sizeof(buf)); });
+    run("JSON String", [](const Record& r) { return jsonString(r); });
+    run("JSON snprintf", [](const Record& r) { return jsonPrintf(r, (char*)buf, sizeof(buf)); });
+    return 0;
+}
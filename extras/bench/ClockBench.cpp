@@ -0,0 +1,32 @@
+#include <chrono>
+
+#include <GSMClock.h>
+
+//cost of GSMClock::now() between resyncs, against calling millis() alone; the clock is
+//synced from a network time report, no modem is needed
+int main()
+{
+    Uart uart("/dev/null");
+    ModemClass modem(uart, 115200);
+    GSMClock clock(modem);
+    const char urc[] = "+CTZV: \"26/10/19,08:30:00+08\"";
+    clock.handleUrc(urc, strlen(urc));
+
+    const int rounds = 10000000;
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink = millis();
+    }
+    double base = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink = clock.now();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-10s %10s\n", "call", "ns/call");
+    printf("%-10s %10.1f\n", "millis()", base * 1e9 / rounds);
+    printf("%-10s %10.1f\n", "now()", elapsed * 1e9 / rounds);
+    return sink == 0 ? 1 : 0;
+}
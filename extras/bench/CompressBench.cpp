@@ -0,0 +1,81 @@
+#include <chrono>
+
+#include <GSMCompress.h>
+
+//frame()/unframe() ratio and throughput on payloads typical for a tracker, with a full
+//round trip check of every frame
+struct Payload {
+    const char* name;
+    uint8_t data[LZ_BATCH_MAX];
+    uint16_t len;
+};
+
+static void fillJson(Payload& p)
+{
+    p.name = "json telemetry";
+    p.len = 0;
+    for (int i = 0; p.len < LZ_BATCH_MAX - 64; i++) {
+        p.len += snprintf((char*)p.data + p.len, LZ_BATCH_MAX - p.len,
+            "{\"t\":%d,\"lat\":45.%04d,\"lon\":9.%04d,\"v\":%d}", 1700000000 + i * 10, 1234 + i, 5678 - i, 12 + i % 3);
+    }
+}
+
+static void fillNmea(Payload& p)
+{
+    p.name = "nmea";
+    p.len = 0;
+    for (int i = 0; p.len < LZ_BATCH_MAX - 80; i++) {
+        p.len += snprintf((char*)p.data + p.len, LZ_BATCH_MAX - p.len,
+            "$GPRMC,1200%02d.00,A,4512.%04d,N,00912.%04d,E,0.%d,,191026,,,A*6C\r\n", i, 1000 + i * 7, 2000 + i * 3, i);
+    }
+}
+
+static void fillRandom(Payload& p)
+{
+    p.name = "random";
+    p.len = LZ_BATCH_MAX;
+    srand(1);
+    for (uint16_t i = 0; i < p.len; i++) {
+        p.data[i] = rand();
+    }
+}
+
+int main()
+{
+    static Payload payloads[3];
+    fillJson(payloads[0]);
+    fillNmea(payloads[1]);
+    fillRandom(payloads[2]);
+
+    LzEncoder encoder;
+    LzDecoder decoder;
+    const int rounds = 2000;
+    printf("%-16s %6s %6s %7s %12s %12s\n", "payload", "in", "frame", "ratio", "encode MB/s", "decode MB/s");
+    for (Payload& p : payloads) {
+        uint8_t frame[LZ_FRAME_MAX];
+        uint8_t out[LZ_BATCH_MAX];
+        uint16_t frameLen = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            frameLen = encoder.frame(p.data, p.len, frame, sizeof(frame));
+        }
+        double encode = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int32_t decoded = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            decoded = decoder.unframe(frame, frameLen, out, sizeof(out));
+        }
+        double decode = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (frameLen == 0 || decoded != p.len || memcmp(out, p.data, p.len) != 0) {
+            printf("%s: round trip failed\n", p.name);
+            return 1;
+        }
+        double mb = (double)p.len * rounds / 1e6;
+        printf("%-16s %6u %6u %6.1f%% %12.1f %12.1f\n", p.name, p.len, frameLen,
+            100.0 * frameLen / p.len, mb / encode, mb / decode);
+    }
+    return 0;
+}
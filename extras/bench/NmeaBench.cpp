@@ -0,0 +1,64 @@
+#include <chrono>
+
+#include <GSMNmea.h>
+
+//sentences per second through NmeaParser::feed() on a log recorded at 1 Hz: GGA, RMC
+//and GSA every second, GSV every other one (skipped by the parser after its header)
+static const char LOG[] =
+    "$GNGGA,081830.00,4527.6120,N,00912.3510,E,1,09,0.9,121.4,M,48.2,M,,*74\r\n"
+    "$GNRMC,081830.00,A,4527.6120,N,00912.3510,E,11.50,54.2,191026,,,A*75\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GPGSV,3,1,11,02,62,289,41,05,14,040,33,12,71,101,44,15,22,315,36*7C\r\n"
+    "$GNGGA,081831.00,4527.6151,N,00912.3557,E,1,10,0.9,121.6,M,48.2,M,,*7A\r\n"
+    "$GNRMC,081831.00,A,4527.6151,N,00912.3557,E,11.87,55.0,191026,,,A*78\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GNGGA,081832.00,4527.6182,N,00912.3604,E,1,11,0.9,121.8,M,48.2,M,,*7D\r\n"
+    "$GNRMC,081832.00,A,4527.6182,N,00912.3604,E,12.24,55.8,191026,,,A*72\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GPGSV,3,1,11,02,62,289,41,05,14,040,33,12,71,101,44,15,22,315,36*7C\r\n"
+    "$GNGGA,081833.00,4527.6213,N,00912.3651,E,1,09,0.9,122.0,M,48.2,M,,*75\r\n"
+    "$GNRMC,081833.00,A,4527.6213,N,00912.3651,E,12.61,56.6,191026,,,A*74\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GNGGA,081834.00,4527.6244,N,00912.3698,E,1,10,0.9,122.2,M,48.2,M,,*7F\r\n"
+    "$GNRMC,081834.00,A,4527.6244,N,00912.3698,E,12.98,57.4,191026,,,A*71\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GPGSV,3,1,11,02,62,289,41,05,14,040,33,12,71,101,44,15,22,315,36*7C\r\n"
+    "$GNGGA,081835.00,4527.6275,N,00912.3745,E,1,11,0.9,122.4,M,48.2,M,,*7A\r\n"
+    "$GNRMC,081835.00,A,4527.6275,N,00912.3745,E,13.35,58.2,191026,,,A*7C\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GNGGA,081836.00,4527.6306,N,00912.3792,E,1,09,0.9,122.6,M,48.2,M,,*7D\r\n"
+    "$GNRMC,081836.00,A,4527.6306,N,00912.3792,E,13.72,59.0,191026,,,A*70\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GPGSV,3,1,11,02,62,289,41,05,14,040,33,12,71,101,44,15,22,315,36*7C\r\n"
+    "$GNGGA,081837.00,4527.6337,N,00912.3839,E,1,10,0.9,122.8,M,48.2,M,,*76\r\n"
+    "$GNRMC,081837.00,A,4527.6337,N,00912.3839,E,14.09,59.8,191026,,,A*7E\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GNGGA,081838.00,4527.6368,N,00912.3886,E,1,11,0.9,123.0,M,48.2,M,,*7F\r\n"
+    "$GNRMC,081838.00,A,4527.6368,N,00912.3886,E,14.46,60.6,191026,,,A*70\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    "$GPGSV,3,1,11,02,62,289,41,05,14,040,33,12,71,101,44,15,22,315,36*7C\r\n"
+    "$GNGGA,081839.00,4527.6399,N,00912.3933,E,1,09,0.9,123.2,M,48.2,M,,*74\r\n"
+    "$GNRMC,081839.00,A,4527.6399,N,00912.3933,E,14.83,61.4,191026,,,A*7A\r\n"
+    "$GPGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3*3D\r\n"
+    ;
+
+int main()
+{
+    const int rounds = 20000;
+    NmeaParser parser;
+    uint32_t parsed[NMEA_OTHER + 1] = {0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (const char* c = LOG; *c; c++) {
+            parsed[parser.feed(*c)]++;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t sentences = parser.sentences();
+    printf("%u sentences (%u GGA, %u RMC, %u GSA, %u other), %u checksum errors\n", (unsigned)sentences,
+        (unsigned)parsed[NMEA_GGA], (unsigned)parsed[NMEA_RMC], (unsigned)parsed[NMEA_GSA],
+        (unsigned)parsed[NMEA_OTHER], (unsigned)parser.errors());
+    printf("%.0f sentences/s, %.1f ns/char\n", sentences / elapsed, elapsed * 1e9 / (rounds * (sizeof(LOG) - 1)));
+    return parser.errors() == 0 ? 0 : 1;
+}
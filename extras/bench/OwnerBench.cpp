@@ -0,0 +1,97 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ModemSim.h"
+
+#include <A9GLib.h>
+
+//throughput and mean latency of ModemOwner with 1 to 8 submitting threads: no-op requests
+//measure the MPSC queue and the dispatch alone, ModemCommands add the round trip to a
+//simulated modem on a pseudo terminal
+
+static int noop(ModemClass& modem, void* arg)
+{
+    return 1;
+}
+
+template <typename Submit>
+static void run(const char* name, int threads, int perThread, Submit submit)
+{
+    std::atomic<long long> latency(0);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < perThread; i++) {
+                auto submitted = std::chrono::steady_clock::now();
+                if (!submit(t, i)) {
+                    failures++;
+                }
+                latency += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - submitted).count();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int total = threads * perThread;
+    printf("%-10s %7d %12.0f %12.1f %8d\n", name, threads, total / elapsed, latency / 1e3 / total,
+        (int)failures);
+}
+
+int main()
+{
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        return ModemSim::ok();
+    });
+    if (!sim.start()) {
+        return 1;
+    }
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    if (!modem.init()) {
+        return 1;
+    }
+
+    ModemOwner owner(modem);
+    std::atomic<bool> stop(false);
+    std::thread ownerThread([&owner, &stop]() {
+        while (!stop) {
+            if (owner.run() == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    printf("%-10s %7s %12s %12s %8s\n", "request", "threads", "requests/s", "latency us", "failed");
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        run("no-op", threads, 100000 / threads, [&owner](int t, int i) {
+            ModemRequest request(noop, NULL);
+            owner.submit(request);
+            while (!request.done()) {
+                std::this_thread::yield();
+            }
+            return request.result() == 1;
+        });
+    }
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        run("command", threads, 400 / threads, [&owner](int t, int i) {
+            char command[32];
+            snprintf(command, sizeof(command), "AT+T%dI%d", t, i);
+            ModemCommand request(command, 1000);
+            owner.submit(request);
+            return request.wait(5000) && request.result() == 1;
+        });
+    }
+
+    stop = true;
+    ownerThread.join();
+    sim.stop();
+    return 0;
+}
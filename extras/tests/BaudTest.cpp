@@ -0,0 +1,36 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command.compare(0, 7, "AT+ECHO") == 0) {
+            return std::string("\r\nERROR\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+
+    //with echo off ATE1 is answered by a bare OK
+    CHECK(modem.turnEcho(false));
+    CHECK(modem.turnEcho(true));
+    CHECK(modem.noop());
+
+    //the negotiated rate is only returned: the modem still boots at the configured one
+    CHECK_EQUAL(460800, modem.negotiateBaud(460800));
+    CHECK_EQUAL(115200, modem.baudRate());
+    CHECK_EQUAL(1, sim.received("AT+IPR=230400"));
+    CHECK_EQUAL(1, sim.received("AT+IPR=460800"));
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//boot to first packet after a cold modem start and after an MCU reset with the modem
+//still attached: the batched probe decides which init and attach steps are skipped
+
+struct Boot {
+    std::vector<std::string> commands;
+    unsigned long millis;
+};
+
+static int count(const Boot& boot, const std::string& prefix)
+{
+    int n = 0;
+    for (const std::string& command : boot.commands) {
+        n += command.compare(0, prefix.size(), prefix) == 0;
+    }
+    return n;
+}
+
+static int exact(const Boot& boot, const std::string& command)
+{
+    int n = 0;
+    for (const std::string& sent : boot.commands) {
+        n += sent == command;
+    }
+    return n;
+}
+
+static Boot boot(bool warm)
+{
+    ModemSim sim;
+    sim.respond([warm](const std::string& command, const std::string&) {
+        if (command == PROBE_COMMAND) {
+            //a cold modem fails the batch on the SIM that is not ready yet
+            return warm ? ModemSim::ok("+CPIN: READY\r\n+CREG: 1,1\r\n+CGATT: 1\r\nSTATE: IP GPRSACT")
+                : std::string("\r\n+CME ERROR: 10\r\n");
+        }
+        if (command == "AT+CPIN?") {
+            return ModemSim::ok("+CPIN: READY");
+        }
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    GSM gsm(modem);
+    GPRS gprs(modem);
+    unsigned long start = millis();
+    CHECK_EQUAL(GSM_READY, gsm.init());
+    CHECK_EQUAL(GPRS_READY, gprs.attachGPRS("apn", "", ""));
+    uint8_t mux = 0xFF;
+    CHECK(gprs.connect("10.0.0.1", 5000, &mux, 5, NULL));
+    CHECK_EQUAL(4, gprs.send(mux, "ping", 4));
+    Boot result = {sim.commands(), millis() - start};
+    gprs.close(mux, 1000);
+    sim.stop();
+    return result;
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    Boot cold = boot(false);
+    Boot warm = boot(true);
+    printf("cold boot: %u commands, %lu ms to the first packet\n", (unsigned)cold.commands.size(), cold.millis);
+    printf("warm boot: %u commands, %lu ms to the first packet\n", (unsigned)warm.commands.size(), warm.millis);
+
+    //cold: every step
+    CHECK_EQUAL(1, exact(cold, "AT+CPIN?"));
+    CHECK(count(cold, "AT+CREG?") >= 1);
+    CHECK_EQUAL(1, count(cold, "AT+CGATT=1"));
+    CHECK_EQUAL(1, count(cold, "AT+CSTT="));
+    CHECK_EQUAL(1, count(cold, "AT+CIICR"));
+
+    //warm: no SIM check, registration query, attach or PDP activation
+    CHECK_EQUAL(0, exact(warm, "AT+CPIN?"));
+    CHECK_EQUAL(0, count(warm, "AT+CREG?"));
+    CHECK_EQUAL(0, count(warm, "AT+CGATT=1"));
+    CHECK_EQUAL(0, count(warm, "AT+CSTT="));
+    CHECK_EQUAL(0, count(warm, "AT+CIICR"));
+    //but single connection and transparent mode left by an earlier session are undone
+    CHECK_EQUAL(1, count(warm, "AT+CIPMODE=0"));
+    CHECK_EQUAL(1, count(warm, "AT+CIPMUX=1"));
+
+    CHECK(warm.commands.size() < cold.commands.size());
+    CHECK(warm.millis < cold.millis);
+    return TEST_RESULT();
+}
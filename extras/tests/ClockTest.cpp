@@ -0,0 +1,69 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//network time report of 2026-10-19 00:00:00 UTC plus seconds
+static void report(GSMClock& clock, uint32_t seconds)
+{
+    char urc[48];
+    snprintf(urc, sizeof(urc), "+CTZV: \"26/10/%02u,%02u:%02u:%02u+00\"", (unsigned)(19 + seconds / 86400),
+        (unsigned)(seconds / 3600 % 24), (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60));
+    clock.handleUrc(urc, strlen(urc));
+}
+
+static void testDrift(ModemClass& modem)
+{
+    GSMClock clock(modem);
+
+    //read at 00:00:00.999 and 01:00:01.000: over an hour a second of truncation would
+    //pass for 277 ppm of drift
+    report(clock, 0);
+    advanceHostMillis(3600001);
+    report(clock, 3601);
+    CHECK_EQUAL(0, clock.drift());
+
+    //millis() 50 ppm slow, resynced every 6 hours: measured once a day has passed
+    for (int i = 1; i <= 4; i++) {
+        advanceHostMillis(21600000UL - 1080);
+        report(clock, 3601 + i * 21600);
+        if (i < 4) {
+            CHECK_EQUAL(0, clock.drift());
+        }
+    }
+    CHECK(clock.drift() >= 40 && clock.drift() <= 65);
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CCLK?") {
+            return ModemSim::ok("+CCLK: \"26/10/19,08:30:00+08\"");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+
+    //the first now() after boot queries the modem instead of waiting for the retry interval
+    GSMClock clock(modem);
+    uint32_t utc = clock.now();
+    CHECK_EQUAL(1, sim.received("AT+CCLK?"));
+    CHECK_EQUAL(1792391400UL, utc); //2026-10-19 08:30:00 +02:00
+    CHECK(clock.localNow() - utc == 2 * 3600);
+
+    //answered from the extrapolated clock afterwards
+    clock.now();
+    CHECK_EQUAL(1, sim.received("AT+CCLK?"));
+
+    testDrift(modem);
+
+    sim.stop();
+    return TEST_RESULT();
+}
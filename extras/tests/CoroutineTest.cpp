@@ -0,0 +1,84 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//two flows interleaving their commands on one ModemScheduler while a third one times out
+
+#define FLOW_COMMANDS 5
+
+static int order[3 * FLOW_COMMANDS];
+static int steps = 0;
+
+static ModemTask flow(ModemScheduler& scheduler, int id)
+{
+    int ok = 0;
+    for (int i = 0; i < FLOW_COMMANDS; i++) {
+        char command[20];
+        snprintf(command, sizeof(command), "AT+F%dI%d", id, i);
+        String response;
+        int result = co_await scheduler.command(command, 500, &response);
+        if (result == 1 && response.indexOf(command) != -1) {
+            ok++;
+        }
+        order[steps++] = id;
+        co_await scheduler.sleep(5);
+    }
+    co_return ok;
+}
+
+static ModemTask slow(ModemScheduler& scheduler)
+{
+    int result = co_await scheduler.command("AT+SLOW", 200);
+    co_return result;
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        return command == "AT+SLOW" ? std::string() : ModemSim::ok("+V: " + command);
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+
+    ModemScheduler scheduler(modem);
+    ModemTask first = flow(scheduler, 1);
+    ModemTask second = flow(scheduler, 2);
+    ModemTask third = slow(scheduler);
+    scheduler.spawn(first);
+    scheduler.spawn(second);
+    scheduler.spawn(third);
+    for (unsigned long start = millis(); !(first.done() && second.done() && third.done()) && millis() - start < 10000;) {
+        scheduler.poll();
+        delay(1);
+    }
+
+    CHECK(first.done() && second.done() && third.done());
+    CHECK_EQUAL(FLOW_COMMANDS, first.result());
+    CHECK_EQUAL(FLOW_COMMANDS, second.result());
+    CHECK_EQUAL(-1, third.result());
+    CHECK(scheduler.idle());
+
+    //neither flow ran all its commands before the other started
+    CHECK_EQUAL(2 * FLOW_COMMANDS, steps);
+    int firstOfTwo = steps, lastOfOne = 0;
+    for (int i = 0; i < steps; i++) {
+        if (order[i] == 2 && firstOfTwo == steps) {
+            firstOfTwo = i;
+        }
+        if (order[i] == 1) {
+            lastOfOne = i;
+        }
+    }
+    CHECK(firstOfTwo < lastOfOne);
+    CHECK_EQUAL(1, sim.received("AT+SLOW"));
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,108 @@
+#include <atomic>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//transparent mode: a connection closed by the peer, and suspend/resume with +++ and ATO
+
+static std::atomic<bool> connected(false);
+
+static bool waitFor(ModemSim& sim, const std::string& data)
+{
+    for (unsigned long start = millis(); millis() - start < 2000; delay(5)) {
+        if (sim.data() == data) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void testPeerClose(GPRS& gprs, ModemClass& modem, ModemSim& sim)
+{
+    CHECK(gprs.openDataMode("10.0.0.1", 5000));
+    CHECK(sim.dataMode());
+    CHECK_EQUAL(5, gprs.dataSend("hello", 5));
+    CHECK(waitFor(sim, "hello"));
+
+    //a payload line break followed by the close line: only the payload comes out
+    sim.inject("reply\r\n");
+    connected = false;
+    sim.closeData();
+    char buf[64];
+    uint16_t n = gprs.dataRead(buf, sizeof(buf), 500);
+    CHECK_EQUAL(7, n);
+    CHECK(memcmp(buf, "reply\r\n", 7) == 0);
+    CHECK(!modem.dataMode());
+    CHECK_EQUAL(-1, gprs.dataAvailable());
+
+    //no escape: the modem is in command mode already
+    unsigned long start = millis();
+    CHECK(gprs.closeDataMode());
+    CHECK(millis() - start < 1000);
+    CHECK_EQUAL(0, sim.received("+++"));
+
+    modem.send("AT+CSQ");
+    CHECK_EQUAL(1, modem.waitForResponse(1000));
+}
+
+static void testSuspend(GPRS& gprs, ModemClass& modem, ModemSim& sim)
+{
+    CHECK(gprs.openDataMode("10.0.0.1", 5000));
+    sim.inject("abc");
+    char buf[8];
+    CHECK_EQUAL(3, gprs.dataRead(buf, 3, 500));
+    CHECK(memcmp(buf, "abc", 3) == 0);
+
+    CHECK(gprs.suspendDataMode());
+    CHECK(!sim.dataMode());
+    modem.send("AT+CSQ");
+    CHECK_EQUAL(1, modem.waitForResponse(1000));
+
+    CHECK(gprs.resumeDataMode());
+    CHECK(sim.dataMode());
+    CHECK_EQUAL(1, gprs.dataSend("x", 1));
+    CHECK(waitFor(sim, "hellox"));
+
+    //escape, then close while the connection is still up
+    int restored = sim.received("AT+CIPMUX=1");
+    CHECK(gprs.closeDataMode());
+    CHECK(!connected);
+    CHECK(!modem.dataMode());
+    CHECK_EQUAL(restored + 1, sim.received("AT+CIPMUX=1"));
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            connected = true;
+            return std::string("\r\nOK\r\n\r\nCONNECT\r\n");
+        }
+        if (command == "ATO") {
+            return std::string(connected ? "\r\nCONNECT\r\n" : "\r\nNO CARRIER\r\n");
+        }
+        if (command == "AT+CIPCLOSE") {
+            bool was = connected;
+            connected = false;
+            return std::string(was ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GPRS gprs(modem);
+
+    testPeerClose(gprs, modem, sim);
+    testSuspend(gprs, modem, sim);
+
+    sim.stop();
+    return TEST_RESULT();
+}
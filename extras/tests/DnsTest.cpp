@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//GPRS::connect() by host name: answers from the DNS cache, queries again once the TTL
+//is over or the cached address fails, and keeps DNS within the connect timeout
+
+static const char PROBE_ATTACHED[] = "+CPIN: READY\r\n+CREG: 1,1\r\n+CGATT: 1\r\nSTATE: IP GPRSACT";
+
+static std::atomic<int> dnsHost(1);     //10.0.0.<dnsHost> is the address of example.com
+static std::atomic<int> dnsDelay(0);    //ms before the CDNSGIP answer
+static std::atomic<int> deadHost(0);    //10.0.0.<deadHost> refuses connections
+static std::atomic<bool> silent(false); //CIPSTART never answered
+
+static int connects(ModemSim& sim, int host)
+{
+    return sim.received("AT+CIPSTART=\"TCP\",\"10.0.0." + std::to_string(host) + "\"");
+}
+
+static void connect(GPRS& gprs, bool expected, unsigned long timeout_s = 5)
+{
+    uint8_t mux = 0xFF;
+    CHECK_EQUAL(expected, gprs.connect("example.com", 5000, &mux, timeout_s, NULL));
+    if (expected) {
+        CHECK(gprs.close(mux, 1000));
+    }
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == PROBE_COMMAND) {
+            return ModemSim::ok(PROBE_ATTACHED);
+        }
+        if (command.compare(0, 10, "AT+CDNSGIP") == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(dnsDelay));
+            return ModemSim::ok("+CDNSGIP: 1,\"example.com\",\"10.0.0." + std::to_string(dnsHost) + "\"");
+        }
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            if (silent) {
+                return std::string();
+            }
+            if (command.find("10.0.0." + std::to_string(deadHost) + "\"") != std::string::npos) {
+                return std::string("\r\nCONNECT FAIL\r\n\r\nOK\r\n");
+            }
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GPRS gprs(modem);
+    CHECK_EQUAL(GPRS_READY, gprs.attachGPRS("apn", "", ""));
+    gprs.resolver().setTtl(60000);
+
+    //the second connect is served by the cache
+    connect(gprs, true);
+    connect(gprs, true);
+    CHECK_EQUAL(1, sim.received("AT+CDNSGIP"));
+    CHECK_EQUAL(2, connects(sim, 1));
+
+    //queried again once the TTL is over
+    dnsHost = 2;
+    advanceHostMillis(60001);
+    connect(gprs, true);
+    CHECK_EQUAL(2, sim.received("AT+CDNSGIP"));
+    CHECK_EQUAL(1, connects(sim, 2));
+
+    //the cached address refuses the connection: resolved again and retried
+    deadHost = 2;
+    dnsHost = 3;
+    connect(gprs, true);
+    CHECK_EQUAL(3, sim.received("AT+CDNSGIP"));
+    CHECK_EQUAL(2, connects(sim, 2));
+    CHECK_EQUAL(1, connects(sim, 3));
+
+    //a slow query leaves the connect what is left of the timeout
+    gprs.resolver().clear();
+    dnsDelay = 600;
+    silent = true;
+    unsigned long start = millis();
+    connect(gprs, false, 1);
+    unsigned long elapsed = millis() - start;
+    printf("slow DNS, unanswered connect: %lu ms of a 1000 ms budget\n", elapsed);
+    CHECK(elapsed >= 1000 && elapsed < 1300);
+
+    //no budget is left for the re-resolve after a connect timing out on the cached address
+    dnsDelay = 0;
+    int queries = sim.received("AT+CDNSGIP");
+    start = millis();
+    connect(gprs, false, 1);
+    elapsed = millis() - start;
+    CHECK_EQUAL(queries, sim.received("AT+CDNSGIP"));
+    CHECK(elapsed >= 1000 && elapsed < 1300);
+
+    sim.stop();
+    return TEST_RESULT();
+}
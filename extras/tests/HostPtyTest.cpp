@@ -0,0 +1,57 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//one modem on a pseudo terminal: init sequence, a command round trip and URC dispatch
+//through HostLoop
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command == "AT+GSN") {
+            return ModemSim::ok("867959031234567");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    CHECK(sim.received("ATV1") == 1);
+
+    String response;
+    modem.send("AT+GSN");
+    CHECK_EQUAL(1, modem.waitForResponse(1000, &response));
+    CHECK(response.indexOf("867959031234567") != -1);
+
+    GSMRegistration registration(modem);
+    registration.listen();
+    CHECK(registration.refresh());
+    CHECK_EQUAL(REG_HOME, registration.status());
+    CHECK_EQUAL(0x1A, registration.lac());
+    CHECK_EQUAL(0x2B, registration.ci());
+
+    HostLoop loop;
+    CHECK(loop.add(modem, uart));
+    CHECK_EQUAL(0, loop.run(20)); //nothing arrives
+
+    sim.inject("\r\n+CREG: 5,\"3C\",\"4D\"\r\n");
+    int polled = 0;
+    for (unsigned long start = millis(); millis() - start < 1000 && registration.status() != REG_ROAMING;) {
+        polled += loop.run(50);
+    }
+    CHECK(polled > 0);
+    CHECK_EQUAL(REG_ROAMING, registration.status());
+    CHECK_EQUAL(0x3C, registration.lac());
+
+    loop.remove(modem);
+    sim.stop();
+    return TEST_RESULT();
+}
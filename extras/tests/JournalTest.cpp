@@ -0,0 +1,124 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+static const char PROBE_ATTACHED[] = "+CPIN: READY\r\n+CREG: 1,1\r\n+CGATT: 1\r\nSTATE: IP GPRSACT";
+
+//zero-filled RAM is free space, not a torn record
+static void testZeroFilledBuffer()
+{
+    static uint8_t buf[1024]; //zero initialized
+    RamJournalStorage storage(buf, sizeof(buf));
+    GSMJournal journal(storage);
+    CHECK(journal.begin());
+    CHECK(journal.append("hello", 5));
+    CHECK_EQUAL(1, journal.pending());
+    CHECK(journal.available() > 0);
+
+    //reopening finds the record again
+    GSMJournal reopened(storage);
+    CHECK(reopened.begin());
+    CHECK_EQUAL(1, reopened.pending());
+}
+
+//a reset between the payload and the header write of append() leaves an erased header
+//in front of programmed bytes: nothing may be appended over them until the next erase
+static void testInterruptedAppend()
+{
+    static uint8_t buf[1024];
+    RamJournalStorage storage(buf, sizeof(buf));
+    GSMJournal journal(storage);
+    CHECK(journal.begin());
+    CHECK(journal.append("one", 3));
+    CHECK(journal.append("two", 3));
+    CHECK(storage.write(journal.used() + 6, "three", 5));
+
+    GSMJournal reopened(storage);
+    CHECK(reopened.begin());
+    CHECK_EQUAL(2, reopened.pending());
+    CHECK_EQUAL(0, reopened.available());
+    CHECK(!reopened.append("four", 4));
+
+    //the records before it are still delivered, then the storage is reclaimed
+    char record[8];
+    uint32_t cursor = reopened.cursor();
+    CHECK_EQUAL(3, reopened.readAt(cursor, record, sizeof(record)));
+    CHECK(memcmp(record, "one", 3) == 0);
+    CHECK_EQUAL(3, reopened.readAt(cursor, record, sizeof(record)));
+    CHECK(memcmp(record, "two", 3) == 0);
+    CHECK_EQUAL(0, reopened.readAt(cursor, record, sizeof(record)));
+    CHECK(reopened.consumeUntil(cursor));
+    CHECK_EQUAL(0, reopened.used());
+    CHECK(reopened.append("four", 4));
+
+    //the same with nothing pending in front of it
+    CHECK(reopened.clear());
+    CHECK(storage.write(6, "five", 4));
+    GSMJournal empty(storage);
+    CHECK(empty.begin());
+    CHECK_EQUAL(0, empty.pending());
+    CHECK(!empty.append("six", 3));
+    CHECK(empty.consumeUntil(empty.cursor()));
+    CHECK(empty.append("six", 3));
+}
+
+//link drops and failed closes must give the socket slot back, or connect() fails for good
+//once MAX_SOCKETS of them have happened
+static void testSocketSlots()
+{
+    ModemSim sim;
+    sim.respond([&](const std::string& command, const std::string&) {
+        if (command == PROBE_COMMAND) {
+            return ModemSim::ok(PROBE_ATTACHED);
+        }
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        if (command.compare(0, 11, "AT+CIPCLOSE") == 0) {
+            return std::string("\r\nERROR\r\n"); //already closed by the network
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GPRS gprs(modem);
+
+    static uint8_t buf[1024];
+    RamJournalStorage storage(buf, sizeof(buf));
+    GSMJournal journal(storage);
+    CHECK(journal.begin());
+    GSMJournalUploader uploader(journal, gprs);
+    uploader.setServer("10.0.0.1", 5000);
+
+    for (int round = 0; round < MAX_SOCKETS + 1; round++) {
+        //lost PDP context
+        CHECK_EQUAL(GPRS_READY, gprs.attachGPRS("apn", "", ""));
+        CHECK(journal.append("a", 1));
+        CHECK_EQUAL(1, uploader.poll());
+        CHECK(journal.append("b", 1));
+        gprs.detachGPRS();
+        CHECK_EQUAL(0, uploader.poll());
+
+        //close failing
+        CHECK_EQUAL(GPRS_READY, gprs.attachGPRS("apn", "", ""));
+        CHECK_EQUAL(1, uploader.poll());
+        uploader.disconnect();
+    }
+    CHECK(journal.append("c", 1));
+    CHECK_EQUAL(1, uploader.poll());
+    CHECK(sim.received("AT+CIPSTART") == 2 * (MAX_SOCKETS + 1) + 1);
+    uploader.disconnect();
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    testZeroFilledBuffer();
+    testInterruptedAppend();
+    testSocketSlots();
+    return TEST_RESULT();
+}
@@ -0,0 +1,57 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command == "AT+CGREG?") {
+            return ModemSim::ok("+CGREG: 1,1");
+        }
+        if (command == "AT+LOCATION=1") {
+            return ModemSim::ok("45.464211,9.191383");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+
+    //without a registration tracker: AT+CREG=2 once, then only AT+CREG? per call
+    GSMLocation location(modem);
+    CHECK(location.locateCell());
+    CHECK(location.locateCell());
+    CHECK_EQUAL(1, sim.received("AT+CREG=2"));
+    CHECK_EQUAL(2, sim.received("AT+CREG?"));
+    CHECK_EQUAL(1, sim.received("AT+LOCATION"));
+    CHECK(location.latitude() > 45.46 && location.latitude() < 45.47);
+
+    //with one, a cached cell costs no AT traffic at all
+    GSMRegistration registration(modem);
+    CHECK(registration.begin());
+    location.setRegistration(&registration);
+    int before = sim.commands().size();
+    CHECK(location.locateCell());
+    CHECK_EQUAL(before, sim.commands().size());
+
+    //a cell change reported by URC is picked up without a query
+    sim.inject("\r\n+CREG: 1,\"1A\",\"3C\"\r\n");
+    for (unsigned long start = millis(); millis() - start < 1000 && registration.ci() != 0x3C;) {
+        modem.poll();
+    }
+    CHECK(location.locateCell());
+    CHECK_EQUAL(before + 1, sim.commands().size()); //the AT+LOCATION=1 of the new cell
+    CHECK_EQUAL(2, sim.received("AT+LOCATION"));
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,201 @@
+#include <poll.h>
+#include <unistd.h>
+
+#include "ModemSim.h"
+
+ModemSim::ModemSim():
+    _stop(false),
+    _echo(true),
+    _transparent(false),
+    _dataMode(false),
+    _lastData(0),
+    _escape(0)
+{
+    _responder = [](const std::string&, const std::string&) { return ok(); };
+}
+
+ModemSim::~ModemSim()
+{
+    stop();
+}
+
+void ModemSim::respond(Responder responder)
+{
+    _responder = responder;
+}
+
+bool ModemSim::start()
+{
+    if (!_pty.open()) {
+        return false;
+    }
+    _stop = false;
+    _thread = std::thread(&ModemSim::run, this);
+    return true;
+}
+
+void ModemSim::stop()
+{
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+const char* ModemSim::device()
+{
+    return _pty.slave();
+}
+
+void ModemSim::inject(const std::string& data)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(_pty.master(), data.data() + done, data.size() - done);
+        if (n <= 0) {
+            return;
+        }
+        done += n;
+    }
+}
+
+int ModemSim::received(const std::string& prefix)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    int n = 0;
+    for (const std::string& command : _commands) {
+        if (command.compare(0, prefix.size(), prefix) == 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+std::vector<std::string> ModemSim::commands()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _commands;
+}
+
+std::string ModemSim::data()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _data;
+}
+
+bool ModemSim::dataMode()
+{
+    return _dataMode;
+}
+
+void ModemSim::closeData(const std::string& line)
+{
+    _dataMode = false;
+    inject("\r\n" + line + "\r\n");
+}
+
+std::string ModemSim::ok(const std::string& lines)
+{
+    return lines.empty() ? "\r\nOK\r\n" : "\r\n" + lines + "\r\n\r\nOK\r\n";
+}
+
+void ModemSim::run()
+{
+    std::string line;
+    std::string payload;
+    bool inPayload = false;
+    bool lineEnd = false; //the \n of a \r\n terminated command line is still to come
+    while (!_stop) {
+        struct pollfd p = {_pty.master(), POLLIN, 0};
+        int ready = poll(&p, 1, 20);
+        unsigned long now = millis();
+        if (_dataMode && _escape == 3 && now - _lastData >= 1000) {
+            _escape = 0;
+            _dataMode = false;
+            inject("\r\nOK\r\n");
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        char c;
+        if (read(_pty.master(), &c, 1) != 1) {
+            continue;
+        }
+        if (lineEnd && c == '\n') {
+            lineEnd = false;
+            continue;
+        }
+        lineEnd = false;
+        if (_dataMode) {
+            receiveData(c, now);
+            continue;
+        }
+        if (inPayload) {
+            if (c == 0x1A) {
+                inPayload = false;
+                reply(line, payload);
+                line.clear();
+                payload.clear();
+            }
+            else {
+                payload += c;
+            }
+        }
+        else if (c == '\r') {
+            lineEnd = true;
+            if (_echo) {
+                inject(line + "\r\n");
+            }
+            if (line.compare(0, 10, "AT+CIPSEND") == 0) {
+                inPayload = true;
+                continue;
+            }
+            if (line == "ATE0" || line == "ATE1") {
+                _echo = line == "ATE1";
+            }
+            if (line == "AT+CIPMODE=0" || line == "AT+CIPMODE=1") {
+                _transparent = line == "AT+CIPMODE=1";
+            }
+            reply(line, payload);
+            line.clear();
+        }
+        else if (c != '\n') {
+            line += c;
+        }
+    }
+}
+
+void ModemSim::reply(const std::string& command, const std::string& payload)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _commands.push_back(command);
+    }
+    std::string answer = _responder(command, payload);
+    if (!answer.empty()) {
+        inject(answer);
+    }
+    bool connect = command.compare(0, 11, "AT+CIPSTART") == 0 || command == "ATO";
+    if (connect && _transparent && answer.find("CONNECT") != std::string::npos
+        && answer.find("CONNECT FAIL") == std::string::npos) {
+        _lastData = millis();
+        _escape = 0;
+        _dataMode = true;
+    }
+}
+
+void ModemSim::receiveData(char c, unsigned long now)
+{
+    //+++ only escapes after a second of silence, anything else is payload
+    if (c == '+' && _escape < 3 && (_escape > 0 || now - _lastData >= 1000)) {
+        _escape++;
+    }
+    else {
+        std::lock_guard<std::mutex> guard(_lock);
+        _data.append(_escape, '+');
+        _data += c;
+        _escape = 0;
+    }
+    _lastData = now;
+}
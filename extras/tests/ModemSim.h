@@ -0,0 +1,80 @@
+#ifndef _MODEM_SIM_H_INCLUDED
+#define _MODEM_SIM_H_INCLUDED
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <HostLoop.h>
+
+/* Simulated A9G on the master side of a pseudo terminal, run by its own thread.
+    Command lines are echoed (unless ATE0 turned echo off) and answered by the responder;
+    the payload following AT+CIPSEND is collected up to its Ctrl-Z and handed to the
+    responder together with the command line. After AT+CIPMODE=1 a CONNECT answer to
+    AT+CIPSTART or ATO switches to transparent mode: bytes are collected as data() until
+    +++ with a second of silence on both sides, which is answered OK.
+*/
+class ModemSim {
+
+public:
+    /** Returns everything the modem answers to command, echo excluded; an empty string
+      leaves the command unanswered
+    */
+    typedef std::function<std::string(const std::string& command, const std::string& payload)> Responder;
+
+    ModemSim();
+    ~ModemSim();
+
+    /** Set before start(), defaults to answering OK to everything
+    */
+    void respond(Responder responder);
+    bool start();
+    void stop();
+
+    /** Serial device to hand to Uart
+    */
+    const char* device();
+
+    /** Write raw bytes to the library, e.g. a URC
+    */
+    void inject(const std::string& data);
+
+    /** Number of commands received so far that start with prefix
+    */
+    int received(const std::string& prefix);
+    std::vector<std::string> commands();
+
+    /** Payload received in transparent mode
+    */
+    std::string data();
+    bool dataMode();
+
+    /** Leave transparent mode as the A9G does when the peer closes, printing line
+    */
+    void closeData(const std::string& line = "CLOSED");
+
+    static std::string ok(const std::string& lines = "");
+
+private:
+    void run();
+    void reply(const std::string& command, const std::string& payload);
+    void receiveData(char c, unsigned long now);
+
+    HostPty _pty;
+    Responder _responder;
+    std::thread _thread;
+    std::atomic<bool> _stop;
+    std::mutex _lock;
+    std::vector<std::string> _commands;
+    bool _echo;
+    bool _transparent;              //AT+CIPMODE=1
+    std::atomic<bool> _dataMode;
+    std::string _data;
+    unsigned long _lastData;        //millis() of the last byte in transparent mode
+    int _escape;                    //+ of a possible escape sequence received so far
+};
+
+#endif
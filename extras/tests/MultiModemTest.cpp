@@ -0,0 +1,116 @@
+#include <map>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+#define MODEMS 3
+
+//every modem instance has its own UART, pins, sockets and URC handlers
+static std::map<uint8_t, int> pinWrites;
+
+static void countPin(uint8_t pin, uint8_t)
+{
+    pinWrites[pin]++;
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    setHostPinHook(countPin);
+
+    ModemSim sims[MODEMS];
+    std::string payloads[MODEMS];
+    for (int i = 0; i < MODEMS; i++) {
+        sims[i].respond([i, &payloads](const std::string& command, const std::string& payload) {
+            if (command == "AT+GSN") {
+                return ModemSim::ok("86795903000000" + std::to_string(i));
+            }
+            if (command == "AT+CREG?") {
+                return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+            }
+            if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+                return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+            }
+            if (command.compare(0, 10, "AT+CIPSEND") == 0) {
+                payloads[i] += payload;
+            }
+            return ModemSim::ok();
+        });
+        CHECK(sims[i].start());
+    }
+
+    Uart* uarts[MODEMS];
+    ModemClass* modems[MODEMS];
+    GPRS* gprs[MODEMS];
+    GSMRegistration* registrations[MODEMS];
+    HostLoop loop;
+    for (int i = 0; i < MODEMS; i++) {
+        uarts[i] = new Uart(sims[i].device());
+        modems[i] = new ModemClass(*uarts[i], 115200, 20 + 3 * i, 21 + 3 * i, 22 + 3 * i);
+        gprs[i] = new GPRS(*modems[i]);
+        registrations[i] = new GSMRegistration(*modems[i]);
+        CHECK(modems[i]->init());
+        registrations[i]->listen();
+        CHECK(registrations[i]->refresh());
+        CHECK(loop.add(*modems[i], *uarts[i]));
+    }
+
+    //each answer comes from its own modem
+    for (int i = 0; i < MODEMS; i++) {
+        String response;
+        modems[i]->send("AT+GSN");
+        CHECK_EQUAL(1, modems[i]->waitForResponse(1000, &response));
+        CHECK(response.indexOf(("86795903000000" + std::to_string(i)).c_str()) != -1);
+    }
+
+    //every modem has its own socket 0
+    for (int i = 0; i < MODEMS; i++) {
+        uint8_t mux = 0xFF;
+        CHECK(gprs[i]->connect("10.0.0.1", 5000, &mux, 5, NULL));
+        CHECK_EQUAL(0, mux);
+    }
+    for (int i = 0; i < MODEMS; i++) {
+        std::string data = "data of modem " + std::to_string(i);
+        CHECK_EQUAL(data.size(), gprs[i]->send(0, data.data(), data.size()));
+    }
+    for (int i = 0; i < MODEMS; i++) {
+        CHECK(payloads[i] == "data of modem " + std::to_string(i));
+    }
+
+    //a URC only reaches the handlers of the modem it came from
+    sims[1].inject("\r\n+CREG: 5,\"3C\",\"4D\"\r\n");
+    sims[2].inject("+CIPRCV,0,4:pong\r\n");
+    for (unsigned long start = millis(); millis() - start < 1000
+         && (registrations[1]->status() != REG_ROAMING || gprs[2]->available(0) < 4);) {
+        loop.run(50);
+    }
+    CHECK_EQUAL(REG_HOME, registrations[0]->status());
+    CHECK_EQUAL(REG_ROAMING, registrations[1]->status());
+    CHECK_EQUAL(REG_HOME, registrations[2]->status());
+    CHECK_EQUAL(0, gprs[0]->available(0));
+    CHECK_EQUAL(0, gprs[1]->available(0));
+    CHECK_EQUAL(4, gprs[2]->available(0));
+
+    //low power mode drives the pin of that modem only
+    pinWrites.clear();
+    modems[1]->lowPowerMode();
+    modems[1]->send("AT");
+    CHECK_EQUAL(1, modems[1]->waitForResponse(1000));
+    CHECK(pinWrites[25] >= 2); //woken up and put back to sleep
+    CHECK_EQUAL(0, pinWrites[22]);
+    CHECK_EQUAL(0, pinWrites[28]);
+    CHECK_EQUAL(0, pinWrites[GSM_LOW_PWR_PIN]);
+
+    for (int i = 0; i < MODEMS; i++) {
+        loop.remove(*modems[i]);
+        gprs[i]->release(0);
+        delete registrations[i];
+        delete gprs[i];
+        delete modems[i];
+        delete uarts[i];
+        sims[i].stop();
+    }
+    return TEST_RESULT();
+}
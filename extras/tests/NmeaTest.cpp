@@ -0,0 +1,44 @@
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//feed body framed as $body*XX with the checksum in the given hex case
+static NmeaSentence feed(NmeaParser& parser, const char* body, bool lowercase)
+{
+    uint8_t checksum = 0;
+    for (const char* c = body; *c; c++) {
+        checksum ^= *c;
+    }
+    char sentence[96];
+    snprintf(sentence, sizeof(sentence), lowercase ? "$%s*%02x\r\n" : "$%s*%02X\r\n", body, checksum);
+    NmeaSentence result = NMEA_NONE;
+    for (const char* c = sentence; *c; c++) {
+        NmeaSentence s = parser.feed(*c);
+        if (s != NMEA_NONE) {
+            result = s;
+        }
+    }
+    return result;
+}
+
+int main()
+{
+    NmeaParser parser;
+
+    CHECK_EQUAL(NMEA_RMC, feed(parser, "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W", false));
+    CHECK_EQUAL(1152, parser.fix().speed); //22.4 kn
+
+    //above 41.7 kn the conversion used to overflow 32 bits
+    CHECK_EQUAL(NMEA_RMC, feed(parser, "GPRMC,123520,A,4807.038,N,01131.000,E,100.00,084.4,230394,003.1,W", false));
+    CHECK_EQUAL(5144, parser.fix().speed);
+    CHECK_EQUAL(NMEA_RMC, feed(parser, "GPRMC,123521,A,4807.038,N,01131.000,E,1200.00,084.4,230394,003.1,W", false));
+    CHECK_EQUAL(61733, parser.fix().speed);
+
+    //lowercase checksums are valid too (this one is 5b)
+    uint32_t errors = parser.errors();
+    CHECK_EQUAL(NMEA_GGA, feed(parser, "GNGGA,123528,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", true));
+    CHECK_EQUAL(errors, parser.errors());
+    CHECK_EQUAL(8, parser.fix().satellites);
+
+    return TEST_RESULT();
+}
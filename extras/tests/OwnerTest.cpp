@@ -0,0 +1,159 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//threads sharing one modem through ModemOwner; also built as OwnerTestTsan when the
+//compiler has ThreadSanitizer
+
+#define THREADS 4
+#define COMMANDS 50
+#define STREAM_LEN 2000
+
+static int connect(ModemClass& modem, void* arg)
+{
+    uint8_t mux;
+    return reinterpret_cast<GPRS*>(arg)->connect("10.0.0.1", 5000, &mux, 5, NULL) ? mux : -1;
+}
+
+static void testCommands(ModemOwner& owner)
+{
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&owner, &failures, t]() {
+            for (int i = 0; i < COMMANDS; i++) {
+                char command[32];
+                snprintf(command, sizeof(command), "AT+T%dI%d", t, i);
+                ModemCommand request(command, 1000);
+                owner.submit(request);
+                char expected[40];
+                snprintf(expected, sizeof(expected), "+V: %s", command);
+                if (!request.wait(5000) || request.result() != 1 || request.response().indexOf(expected) == -1) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK_EQUAL(0, failures);
+}
+
+static void testSocketQueue(ModemOwner& owner, GPRS& gprs, ModemSim& sim)
+{
+    ModemRequest request(connect, &gprs);
+    owner.submit(request);
+    CHECK(request.wait(5000));
+    CHECK_EQUAL(0, request.result());
+
+    static uint8_t buf[64]; //smaller than the stream, so the owner has to wait for the consumer
+    SpscByteQueue queue(buf, sizeof(buf));
+    CHECK(owner.attachSocket(gprs, 0, queue));
+
+    std::atomic<bool> ok(true);
+    std::thread consumer([&queue, &ok]() {
+        uint32_t n = 0;
+        for (unsigned long start = millis(); n < STREAM_LEN && millis() - start < 10000;) {
+            uint8_t data[16];
+            uint16_t len = queue.pop(data, sizeof(data));
+            for (uint16_t i = 0; i < len; i++, n++) {
+                if (data[i] != 'a' + n % 26) {
+                    ok = false;
+                }
+            }
+            if (len == 0) {
+                delay(1);
+            }
+        }
+        if (n != STREAM_LEN) {
+            ok = false;
+        }
+    });
+    std::string chunk;
+    for (uint32_t n = 0; n < STREAM_LEN; n++) {
+        chunk += 'a' + n % 26;
+        if (chunk.size() == 100) {
+            sim.inject("+CIPRCV,0,100:" + chunk + "\r\n");
+            chunk.clear();
+            delay(5);
+        }
+    }
+    consumer.join();
+    CHECK(ok);
+    owner.detachSocket(0);
+}
+
+static void testSpscQueue()
+{
+    static uint8_t buf[17]; //odd size, wraps often
+    SpscByteQueue queue(buf, sizeof(buf));
+    const uint32_t total = 200000;
+    std::thread producer([&queue, total]() {
+        for (uint32_t i = 0; i < total;) {
+            uint8_t data[3] = {(uint8_t)i, (uint8_t)(i + 1), (uint8_t)(i + 2)};
+            uint16_t pushed = queue.push(data, min((uint32_t)3, total - i));
+            if (pushed == 0) {
+                std::this_thread::yield(); //full, let the consumer run on a busy host
+            }
+            i += pushed;
+        }
+    });
+    bool ok = true;
+    for (uint32_t n = 0; n < total;) {
+        uint8_t data[5];
+        uint16_t len = queue.pop(data, sizeof(data));
+        for (uint16_t i = 0; i < len; i++, n++) {
+            ok = ok && data[i] == (uint8_t)n;
+        }
+        if (len == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(ok);
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok("+V: " + command);
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GPRS gprs(modem);
+
+    ModemOwner owner(modem);
+    std::atomic<bool> stop(false);
+    std::thread ownerThread([&owner, &stop]() {
+        while (!stop) {
+            if (owner.run() == 0) {
+                delay(1);
+            }
+        }
+    });
+
+    testCommands(owner);
+    testSocketQueue(owner, gprs, sim);
+    testSpscQueue();
+
+    stop = true;
+    ownerThread.join();
+    gprs.release(0);
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,75 @@
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//dispatch order of ModemDispatchQueue by class, arrival and age
+
+static void testOrder()
+{
+    ModemDispatchQueue queue;
+    ModemDispatchEntry background(PRIORITY_BACKGROUND), data1(PRIORITY_DATA), data2(PRIORITY_DATA);
+    ModemDispatchEntry interactive(PRIORITY_INTERACTIVE);
+    CHECK(queue.pop() == NULL);
+
+    queue.push(background);
+    queue.push(data1);
+    queue.push(interactive);
+    queue.push(data2);
+    CHECK(queue.pop() == &interactive);
+    CHECK(queue.pop() == &data1);
+    CHECK(queue.pop() == &data2);
+    CHECK(queue.pop() == &background);
+    CHECK(queue.empty());
+
+    CHECK_EQUAL(1, queue.stats(PRIORITY_INTERACTIVE).commands);
+    CHECK_EQUAL(2, queue.stats(PRIORITY_DATA).commands);
+    CHECK_EQUAL(1, queue.stats(PRIORITY_BACKGROUND).commands);
+}
+
+static void testAging()
+{
+    ModemDispatchQueue queue;
+    ModemDispatchEntry background(PRIORITY_BACKGROUND), data(PRIORITY_DATA), interactive(PRIORITY_INTERACTIVE);
+    unsigned long now = millis();
+
+    //younger than one aging step: still behind data
+    queue.push(background, now - PRIORITY_AGING_MS / 2);
+    queue.push(data, now);
+    CHECK(queue.pop() == &data);
+    CHECK(queue.pop() == &background);
+
+    //one step: level with data, and it came first
+    queue.push(background, now - PRIORITY_AGING_MS);
+    queue.push(data, now);
+    CHECK(queue.pop() == &background);
+    CHECK(queue.pop() == &data);
+
+    //two steps: ahead of a later interactive command
+    queue.push(background, now - 2 * PRIORITY_AGING_MS);
+    queue.push(interactive, now);
+    CHECK(queue.pop() == &background);
+    CHECK(queue.pop() == &interactive);
+
+    CHECK(queue.stats(PRIORITY_BACKGROUND).maxDelay >= 2 * PRIORITY_AGING_MS);
+    queue.resetStats();
+    CHECK_EQUAL(0, queue.stats(PRIORITY_BACKGROUND).commands);
+}
+
+static void testClassify()
+{
+    CHECK_EQUAL(PRIORITY_BACKGROUND, ModemDispatchQueue::classify("AT+CSQ"));
+    CHECK_EQUAL(PRIORITY_BACKGROUND, ModemDispatchQueue::classify("AT+CREG?"));
+    CHECK_EQUAL(PRIORITY_DATA, ModemDispatchQueue::classify("AT+CIPSEND=1,5"));
+    CHECK_EQUAL(PRIORITY_DATA, ModemDispatchQueue::classify("AT+CIPSTART=\"TCP\",\"10.0.0.1\",5000"));
+    CHECK_EQUAL(PRIORITY_INTERACTIVE, ModemDispatchQueue::classify("AT+CMGS=\"+391234\""));
+    CHECK_EQUAL(PRIORITY_INTERACTIVE, ModemDispatchQueue::classify("AT"));
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    testOrder();
+    testAging();
+    testClassify();
+    return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//init() skips the settings saved on the modem with AT&W, unless the modem lost them
+
+class RamProfileStore : public ModemProfileStore {
+public:
+    RamProfileStore(): _saved(false), _hash(0) {}
+    bool load(uint32_t& hash)
+    {
+        hash = _hash;
+        return _saved;
+    }
+    bool save(uint32_t hash)
+    {
+        _hash = hash;
+        _saved = true;
+        return true;
+    }
+
+private:
+    bool _saved;
+    uint32_t _hash;
+};
+
+static std::atomic<int> prompt(1);  //AT+CIPSPRT, 1 after a factory reset
+
+static bool initModem(Uart& uart, ModemProfileStore& store)
+{
+    ModemClass modem(uart, 115200);
+    modem.setProfileStore(&store);
+    return modem.init();
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CIPSPRT?") {
+            return ModemSim::ok("+CIPSPRT: " + std::to_string(prompt));
+        }
+        if (command.compare(0, 11, "AT+CIPSPRT=") == 0) {
+            prompt = atoi(command.c_str() + 11);
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+    Uart uart(sim.device());
+    RamProfileStore store;
+
+    //nothing saved yet: full sequence, then AT&W
+    CHECK(initModem(uart, store));
+    CHECK_EQUAL(1, sim.received("ATV1"));
+    CHECK_EQUAL(1, sim.received("AT+CIPSPRT=0"));
+    CHECK_EQUAL(1, sim.received("AT&W"));
+
+    //saved and intact: one query instead of the sequence
+    CHECK(initModem(uart, store));
+    CHECK_EQUAL(1, sim.received("ATV1"));
+    CHECK_EQUAL(1, sim.received("AT+CIPSPRT?"));
+    CHECK_EQUAL(1, sim.received("AT&W"));
+
+    //reset to factory defaults by another tool at the same baud rate: applied again
+    prompt = 1;
+    CHECK(initModem(uart, store));
+    CHECK_EQUAL(2, sim.received("ATV1"));
+    CHECK_EQUAL(2, sim.received("AT+CIPSPRT=0"));
+    CHECK_EQUAL(2, sim.received("AT&W"));
+    CHECK_EQUAL(0, prompt);
+
+    sim.stop();
+    return TEST_RESULT();
+}
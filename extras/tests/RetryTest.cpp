@@ -0,0 +1,228 @@
+#include <atomic>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//GSMRetryPolicy backoff, budget and breaker, and how GSM::init(), GPRS::attachGPRS() and
+//GPRS::connect() report to it
+
+static std::atomic<bool> answerAttach(true);
+static std::atomic<int> simErrors(0);   //AT+CPIN? answers left to fail, -1 for all
+
+//AT+CPIN? alone, sim.received() would count the probe too
+static int simChecks(ModemSim& sim)
+{
+    int n = 0;
+    for (const std::string& command : sim.commands()) {
+        n += command == "AT+CPIN?";
+    }
+    return n;
+}
+
+static void testBackoff()
+{
+    GSMRetryPolicy policy(100, 1000, 0, 0);
+    policy.setJitter(0);
+    CHECK(policy.begin());
+    const unsigned long expected[] = {100, 200, 400, 800, 1000, 1000};
+    unsigned long total = 0;
+    for (unsigned long delay : expected) {
+        CHECK(policy.failure());
+        unsigned long wait = policy.wait();
+        CHECK(wait <= delay && wait + 20 > delay);
+        CHECK(!policy.allow());
+        total += delay;
+    }
+    CHECK_EQUAL(total, policy.counters().backoffMillis);
+    policy.success();
+    CHECK(policy.allow());
+    CHECK_EQUAL(0, policy.wait());
+
+    //jitter cuts up to half of each delay, never adds to it
+    GSMRetryPolicy jittered(1000, 1000, 0, 0);
+    jittered.setJitter(50);
+    unsigned long shortest = 1000, longest = 0;
+    for (int i = 0; i < 200; i++) {
+        jittered.reset();
+        jittered.resetCounters();
+        jittered.failure();
+        unsigned long delay = jittered.counters().backoffMillis;
+        CHECK(delay >= 500 && delay <= 1000);
+        shortest = min(shortest, delay);
+        longest = max(longest, delay);
+    }
+    CHECK(longest - shortest > 100);
+}
+
+static void testBreaker()
+{
+    GSMRetryPolicy policy(10, 10, 0, 2, 200);
+    policy.setJitter(0);
+
+    //open -> half open -> closed
+    CHECK(policy.begin());
+    CHECK(policy.failure());
+    CHECK(!policy.failure());
+    CHECK_EQUAL(BREAKER_OPEN, policy.state());
+    CHECK(!policy.begin());
+    CHECK_EQUAL(1, policy.counters().rejected);
+    delay(210);
+    CHECK_EQUAL(BREAKER_HALF_OPEN, policy.state());
+    CHECK(policy.begin());
+    policy.success();
+    CHECK_EQUAL(BREAKER_CLOSED, policy.state());
+
+    //a failed trial opens it again at once
+    CHECK(policy.failure());
+    CHECK(!policy.failure());
+    delay(210);
+    CHECK_EQUAL(BREAKER_HALF_OPEN, policy.state());
+    CHECK(policy.begin());
+    CHECK(!policy.failure());
+    CHECK_EQUAL(BREAKER_OPEN, policy.state());
+    CHECK(!policy.begin());
+    CHECK_EQUAL(3, policy.counters().opened);
+}
+
+static void testConnectBudget(ModemClass& modem, ModemSim& sim)
+{
+    GPRS gprs(modem);
+    GSMRetryPolicy policy(10, 10, 3, 0);
+    gprs.setConnectPolicy(&policy);
+
+    uint8_t mux;
+    GPRS::ConnectionStatus status;
+    int connects = sim.received("AT+CIPSTART");
+    CHECK(!gprs.connect("10.0.0.1", 5000, &mux, 2, &status));
+    CHECK_EQUAL(GPRS::ConnectionStatus::CONNECT_FAIL, status);
+    CHECK_EQUAL(connects + 3, sim.received("AT+CIPSTART"));
+    CHECK_EQUAL(3, policy.counters().failures);
+    CHECK_EQUAL(1, policy.counters().exhausted);
+}
+
+static void testAttachTimeoutWhileBackingOff(ModemClass& modem, ModemSim& sim)
+{
+    GPRS gprs(modem);
+    GSMRetryPolicy policy(2000, 2000, 0, 100);
+    policy.setJitter(0);
+    gprs.setAttachPolicy(&policy);
+    gprs.setTimeout(500);
+
+    //AT+CGATT=1 fails at once, the timeout hits during the 2 s backoff
+    CHECK_EQUAL(ERROR, gprs.attachGPRS("apn", "", ""));
+    CHECK_EQUAL(1, sim.received("AT+CGATT=1"));
+    CHECK_EQUAL(1, policy.counters().failures);
+
+    //the abandoned attach does not retry once the backoff is over
+    int probes = sim.received(PROBE_COMMAND);
+    delay(2100);
+    for (int i = 0; i < 10; i++) {
+        gprs.ready();
+        delay(10);
+    }
+    CHECK_EQUAL(probes, sim.received(PROBE_COMMAND));
+    CHECK_EQUAL(1, sim.received("AT+CGATT=1"));
+}
+
+static void testAttachTimeoutWhileWaiting(ModemClass& modem, ModemSim& sim)
+{
+    GPRS gprs(modem);
+    GSMRetryPolicy policy(100, 100, 0, 100);
+    gprs.setAttachPolicy(&policy);
+    gprs.setTimeout(500);
+
+    //AT+CGATT=1 is never answered: the timeout is the only failure
+    answerAttach = false;
+    int attaches = sim.received("AT+CGATT=1");
+    CHECK_EQUAL(ERROR, gprs.attachGPRS("apn", "", ""));
+    CHECK_EQUAL(attaches + 1, sim.received("AT+CGATT=1"));
+    CHECK_EQUAL(1, policy.counters().failures);
+}
+
+static void testInitAgain(ModemClass& modem, ModemSim& sim)
+{
+    GSM gsm(modem);
+    GSMRetryPolicy policy(10, 10, 1, 0);
+    gsm.setRetryPolicy(&policy);
+    gsm.setTimeout(5000);
+
+    //the budget of one attempt runs out on the first SIM error
+    simErrors = 1;
+    int checks = simChecks(sim);
+    CHECK_EQUAL(ERROR, gsm.init());
+    CHECK_EQUAL(checks + 1, simChecks(sim));
+    CHECK_EQUAL(1, policy.counters().exhausted);
+
+    //the next call starts over instead of returning the old error, from the probe
+    //that now finds the SIM ready
+    int formats = sim.received("AT+CMGF=0");
+    delay(20);
+    CHECK_EQUAL(GSM_READY, gsm.init());
+    CHECK_EQUAL(formats + 1, sim.received("AT+CMGF=0"));
+    CHECK_EQUAL(1, policy.counters().successes);
+}
+
+static void testInitTimeoutWhileBackingOff(ModemClass& modem, ModemSim& sim)
+{
+    GSM gsm(modem);
+    GSMRetryPolicy policy(2000, 2000, 0, 100);
+    policy.setJitter(0);
+    gsm.setRetryPolicy(&policy);
+    gsm.setTimeout(500);
+
+    simErrors = -1;
+    CHECK_EQUAL(ERROR, gsm.init());
+    CHECK_EQUAL(1, policy.counters().failures);
+    simErrors = 0;
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    testBackoff();
+    testBreaker();
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == PROBE_COMMAND) {
+            return simErrors != 0 ? std::string("\r\nERROR\r\n")
+                : ModemSim::ok("+CPIN: READY\r\n+CREG: 1,1\r\n+CGATT: 0\r\nSTATE: IP INITIAL");
+        }
+        if (command == "AT+CPIN?") {
+            if (simErrors != 0) {
+                if (simErrors > 0) {
+                    simErrors--;
+                }
+                return std::string("\r\n+CME ERROR: 10\r\n");
+            }
+            return ModemSim::ok("+CPIN: READY");
+        }
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command == "AT+CGATT=1") {
+            return answerAttach ? std::string("\r\nERROR\r\n") : std::string();
+        }
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            return std::string("\r\nCONNECT FAIL\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+
+    testConnectBudget(modem, sim);
+    testAttachTimeoutWhileBackingOff(modem, sim);
+    testAttachTimeoutWhileWaiting(modem, sim);
+    testInitAgain(modem, sim);
+    testInitTimeoutWhileBackingOff(modem, sim);
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//SMS-DELIVER "How are you?" from +31641600986
+static const char VALID[] = "07911326040000F0040B911346610089F60000208062917314080CC8F71D14969741F977FD07";
+//the same with a user data length far beyond the PDU
+static const char TRUNCATED[] = "07911326040000F0040B911346610089F600002080629173140FFC8F71D14969741F977FD07";
+//service centre length 0xFF
+static const char SMSC_OVERFLOW[] = "FF04";
+//UDHI set, header length beyond the user data
+static const char UDH_OVERFLOW[] = "00440B911346610089F6000020806291731408030FFF00030A";
+//SMS-SUBMIT left in storage, not a DELIVER
+static const char SUBMIT[] = "0011000B911346610089F60000AA0CC8F71D14969741F977FD07";
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    std::atomic<bool> clean(false);
+    sim.respond([&clean](const std::string& command, const std::string&) {
+        if (command == "AT+CMGL=4") {
+            std::string list;
+            const char* broken[] = {TRUNCATED, SMSC_OVERFLOW, VALID, UDH_OVERFLOW, SUBMIT};
+            const char* valid[] = {VALID, VALID};
+            const char** pdus = clean ? valid : broken;
+            int n = clean ? 2 : 5;
+            for (int i = 0; i < n; i++) {
+                if (i > 0) {
+                    list += "\r\n";
+                }
+                list += "+CMGL: " + std::to_string(i + 1) + ",1,,24\r\n" + pdus[i];
+            }
+            return ModemSim::ok(list);
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GSMSms sms(modem);
+    CHECK(sms.begin());
+
+    static GSMSmsMessage messages[4];
+    CHECK_EQUAL(1, sms.readAll(messages, 4));
+    CHECK(strcmp(messages[0].sender, "+31641600986") == 0);
+    CHECK(strcmp(messages[0].text, "How are you?") == 0);
+
+    //only the message returned is deleted
+    CHECK_EQUAL(1, sim.received("AT+CMGD="));
+    CHECK_EQUAL(1, sim.received("AT+CMGD=3"));
+
+    //every listed PDU returned: a single delete of the read messages
+    clean = true;
+    CHECK_EQUAL(2, sms.readAll(messages, 4));
+    CHECK_EQUAL(2, sim.received("AT+CMGD="));
+    CHECK_EQUAL(1, sim.received("AT+CMGD=1,1"));
+
+    //not everything returned: per index deletes again
+    CHECK_EQUAL(1, sms.readAll(messages, 1));
+    CHECK_EQUAL(3, sim.received("AT+CMGD="));
+    CHECK_EQUAL(1, sim.received("AT+CMGD=1,1"));
+    CHECK_EQUAL(2, sim.received("AT+CMGD=1")); //AT+CMGD=1,1 and AT+CMGD=1
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,29 @@
+#ifndef _TEST_CHECK_H_INCLUDED
+#define _TEST_CHECK_H_INCLUDED
+
+#include <stdio.h>
+
+/* Minimal assertions for the host tests: a failed CHECK is reported and counted, and
+    TEST_RESULT() turns the count into the process exit code that ctest looks at.
+*/
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+        long long _e = (long long)(expected), _a = (long long)(actual); \
+        if (_e != _a) { \
+            fprintf(stderr, "%s:%d: CHECK_EQUAL(%s, %s) failed: %lld != %lld\n", \
+                __FILE__, __LINE__, #expected, #actual, _e, _a); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,105 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//GSMTimerWheel deadlines, and HostLoop waking up for modem timers with no serial traffic
+
+#define TIMERS 7
+
+static unsigned long firedAt[TIMERS];
+static int fires = 0;
+
+static void fire(void* arg)
+{
+    firedAt[(intptr_t)arg] = millis();
+    fires++;
+}
+
+static void testWheel()
+{
+    GSMTimerWheel wheel;
+    GSMTimer timers[TIMERS] = {
+        {fire, (void*)0}, {fire, (void*)1}, {fire, (void*)2}, {fire, (void*)3},
+        {fire, (void*)4}, {fire, (void*)5}, {fire, (void*)6}
+    };
+    const unsigned long ms[TIMERS] = {0, 5, 10, 37, 320, 15, 700};
+    CHECK_EQUAL((unsigned long)-1, wheel.nextExpiry());
+    unsigned long start = millis();
+    for (int i = 0; i < TIMERS; i++) {
+        wheel.arm(timers[i], ms[i]);
+    }
+    CHECK(timers[0].expired());
+    CHECK_EQUAL(TIMERS - 1, wheel.count());
+    CHECK(wheel.nextExpiry() <= TIMER_TICK_MS);
+    wheel.cancel(timers[6]);
+    CHECK(!timers[6].armed());
+
+    while (wheel.count() > 0 && millis() - start < 2000) {
+        wheel.poll();
+        delay(1);
+    }
+    for (int i = 1; i < TIMERS - 1; i++) {
+        //never early, late by at most a tick plus scheduling
+        CHECK(firedAt[i] - start >= ms[i]);
+        CHECK(firedAt[i] - start < ms[i] + 2 * TIMER_TICK_MS + 10);
+    }
+    //armed with 0 expires without a callback, the cancelled one never fires
+    CHECK_EQUAL(TIMERS - 2, fires);
+    CHECK(!timers[6].expired());
+
+    //a wheel nobody polled catches up on expired()
+    GSMTimer near, far;
+    wheel.arm(near, 50);
+    wheel.arm(far, 2000);
+    delay(100);
+    CHECK(near.expired());
+    CHECK(!far.expired());
+    CHECK(wheel.nextExpiry() > 1800);
+    {
+        GSMTimer scoped;
+        wheel.arm(scoped, 100);
+        CHECK_EQUAL(2, wheel.count());
+    }
+    CHECK_EQUAL(1, wheel.count());
+}
+
+static void testLoop()
+{
+    ModemSim sim;
+    CHECK(sim.start());
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    HostLoop loop;
+    CHECK(loop.add(modem, uart));
+
+    //nothing to wait for: the timeout is kept
+    unsigned long start = millis();
+    CHECK_EQUAL(0, loop.run(50));
+    CHECK(millis() - start >= 40);
+
+    //a modem timer cuts a longer wait short and its modem is polled
+    GSMTimer timer(fire, (void*)0);
+    fires = 0;
+    start = millis();
+    modem.timers().arm(timer, 60);
+    int polled = 0;
+    while (fires == 0 && millis() - start < 3000) {
+        polled += loop.run(2000);
+    }
+    CHECK_EQUAL(1, fires);
+    CHECK(polled >= 1);
+    CHECK(millis() - start < 1000);
+
+    loop.remove(modem);
+    sim.stop();
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    testWheel();
+    testLoop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <thread>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//GSM_TRACE timeline of init -> attach -> connect against the simulated modem: every
+//phase is recorded, in order, with the time spent answering accounted to it
+
+#ifndef GSM_TRACE
+#error "TraceTest needs the library built with GSM_TRACE"
+#endif
+
+#define DNS_DELAY_MS 200
+#define CONNECT_DELAY_MS 300
+
+static int first(GSMTracePhase phase, uint8_t step)
+{
+    for (uint16_t i = 0; i < GSMTrace::count(); i++) {
+        if (GSMTrace::event(i).phase == phase && GSMTrace::event(i).step == step) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int events(GSMTracePhase phase)
+{
+    int n = 0;
+    for (uint16_t i = 0; i < GSMTrace::count(); i++) {
+        n += GSMTrace::event(i).phase == phase;
+    }
+    return n;
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CPIN?") {
+            return ModemSim::ok("+CPIN: READY");
+        }
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command.compare(0, 10, "AT+CDNSGIP") == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(DNS_DELAY_MS));
+            return ModemSim::ok("+CDNSGIP: 1,\"example.com\",\"10.0.0.1\"");
+        }
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_DELAY_MS));
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    GSM gsm(modem);
+    GPRS gprs(modem);
+    GSMTrace::clear();
+    unsigned long start = millis();
+    CHECK_EQUAL(GSM_READY, gsm.init());
+    CHECK_EQUAL(GPRS_READY, gprs.attachGPRS("apn", "", ""));
+    uint8_t mux = 0xFF;
+    CHECK(gprs.connect("example.com", 5000, &mux, 5, NULL));
+    unsigned long elapsed = millis() - start;
+    GSMTrace::print(SerialUSB);
+
+    CHECK(GSMTrace::count() > 0);
+    CHECK_EQUAL(0, GSMTrace::dropped());
+
+    //every phase, ending well
+    int initStart = first(TRACE_MODEM_INIT, 0);
+    int initDone = first(TRACE_MODEM_INIT, 1);
+    int autosense = first(TRACE_AUTOSENSE, 0);
+    int dnsQuery = first(TRACE_DNS, 0);
+    int dnsDone = first(TRACE_DNS, 1);
+    int connectStart = first(TRACE_CONNECT, 0);
+    int connectDone = first(TRACE_CONNECT, 1);
+    CHECK_EQUAL(0, initStart);
+    CHECK(events(TRACE_GSM) > 0);
+    CHECK(events(TRACE_GPRS) > 0);
+    CHECK_EQUAL(-1, first(TRACE_MODEM_INIT, 2));
+    CHECK_EQUAL(-1, first(TRACE_DNS, 2));
+    CHECK_EQUAL(-1, first(TRACE_CONNECT, 2));
+
+    //in order: init (autosensing within it), GSM, GPRS, DNS, connect
+    int gsmFirst = -1, gsmLast = -1, gprsFirst = -1, gprsLast = -1;
+    for (uint16_t i = 0; i < GSMTrace::count(); i++) {
+        if (GSMTrace::event(i).phase == TRACE_GSM) {
+            gsmFirst = gsmFirst == -1 ? i : gsmFirst;
+            gsmLast = i;
+        }
+        if (GSMTrace::event(i).phase == TRACE_GPRS) {
+            gprsFirst = gprsFirst == -1 ? i : gprsFirst;
+            gprsLast = i;
+        }
+    }
+    CHECK(initStart < autosense && autosense < initDone);
+    CHECK(initDone < gsmFirst);
+    CHECK(gsmLast < gprsFirst);
+    CHECK(gprsLast < dnsQuery);
+    CHECK_EQUAL(dnsQuery + 1, dnsDone);
+    CHECK(dnsDone < connectStart);
+    CHECK_EQUAL(connectStart + 1, connectDone);
+    CHECK_EQUAL(GSMTrace::count() - 1, connectDone);
+    for (uint16_t i = 1; i < GSMTrace::count(); i++) {
+        CHECK(GSMTrace::event(i).millis >= GSMTrace::event(i - 1).millis);
+    }
+
+    //the delays of the answers land in their phase, and the phases cover the whole path
+    CHECK(GSMTrace::duration(TRACE_DNS) >= DNS_DELAY_MS);
+    CHECK(GSMTrace::duration(TRACE_CONNECT) >= CONNECT_DELAY_MS);
+    CHECK(GSMTrace::duration(TRACE_DNS) < DNS_DELAY_MS + CONNECT_DELAY_MS);
+    uint32_t total = 0;
+    for (int phase = 0; phase < TRACE_PHASES; phase++) {
+        total += GSMTrace::duration((GSMTracePhase)phase);
+    }
+    CHECK_EQUAL(GSMTrace::event(connectDone).millis - GSMTrace::event(initStart).millis, total);
+    CHECK(total <= elapsed);
+
+    gprs.close(mux, 1000);
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+#include <math.h>
+
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//GSMTrack: window filter on a synthetic drive, delta encoding, and cell locations kept
+//out of the track
+
+#define TOLERANCE_M 10
+#define E7_PER_M 89.83f //1e-7 degrees of latitude per meter
+
+static const int32_t ORIGIN_LAT = 454642110;
+static const int32_t ORIGIN_LON = 91913830;
+static const float LON_SCALE = cosf(45.464211f * (float)M_PI / 180);
+
+//local flat coordinates in meters
+static void meters(const TrackPoint& p, float& x, float& y)
+{
+    x = (p.longitude - ORIGIN_LON) * LON_SCALE / E7_PER_M;
+    y = (p.latitude - ORIGIN_LAT) / E7_PER_M;
+}
+
+static float distance(const TrackPoint& a, const TrackPoint& b, const TrackPoint& p)
+{
+    float ax, ay, bx, by, px, py;
+    meters(a, ax, ay);
+    meters(b, bx, by);
+    meters(p, px, py);
+    float dx = bx - ax, dy = by - ay;
+    float len2 = dx * dx + dy * dy;
+    float t = len2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return hypotf(px - ax - t * dx, py - ay - t * dy);
+}
+
+static uint32_t getVarint(const uint8_t*& p)
+{
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        value |= (uint32_t)(*p & 0x7F) << shift;
+        if (!(*p++ & 0x80)) {
+            return value;
+        }
+    }
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void testDrive(GSMLocation& location)
+{
+    //10 m/s: 600 m east, a right angle, 600 m north, with +-1.5 m of wobble
+    GSMTrack track(location, TOLERANCE_M);
+    TrackPoint fixes[121];
+    for (int i = 0; i <= 120; i++) {
+        float x = i <= 60 ? i * 10 : 600;
+        float y = i <= 60 ? 0 : (i - 60) * 10;
+        float wobble = (i * 7 % 5 - 2) * 0.75f;
+        fixes[i].latitude = ORIGIN_LAT + (int32_t)((y + wobble) * E7_PER_M);
+        fixes[i].longitude = ORIGIN_LON + (int32_t)((x - wobble) * E7_PER_M / LON_SCALE);
+        fixes[i].time = 1792368000UL + i;
+        track.add(fixes[i]);
+    }
+    track.flush();
+
+    //a handful of points, the corner among them, and every fix within the tolerance
+    uint8_t kept = track.count();
+    CHECK(kept >= 3 && kept <= 12);
+    bool corner = false;
+    for (uint8_t i = 0; i < kept; i++) {
+        float x, y;
+        meters(track.point(i), x, y);
+        corner = corner || hypotf(x - 600, y) < TOLERANCE_M;
+    }
+    CHECK(corner);
+    for (int i = 0, segment = 0; i <= 120; i++) {
+        while (segment < kept - 2 && fixes[i].time > track.point(segment + 1).time) {
+            segment++;
+        }
+        CHECK(distance(track.point(segment), track.point(segment + 1), fixes[i]) <= TOLERANCE_M + 1);
+    }
+
+    //encode() round trip, and its size against the raw fixes
+    uint8_t buf[256];
+    BufferSink sink(buf, sizeof(buf));
+    uint16_t len = track.encode(sink);
+    CHECK(len > 0);
+    CHECK_EQUAL(len, sink.length());
+    const uint8_t* p = buf;
+    CHECK_EQUAL(kept, getVarint(p));
+    TrackPoint last = {0, 0, 0};
+    for (uint8_t i = 0; i < kept; i++) {
+        last.latitude += unzigzag(getVarint(p));
+        last.longitude += unzigzag(getVarint(p));
+        last.time = i == 0 ? getVarint(p) : last.time + getVarint(p);
+        CHECK_EQUAL(track.point(i).latitude, last.latitude);
+        CHECK_EQUAL(track.point(i).longitude, last.longitude);
+        CHECK_EQUAL(track.point(i).time, last.time);
+    }
+    CHECK_EQUAL(len, p - buf);
+
+    uint32_t raw = sizeof(fixes);
+    printf("1.2 km: %u raw fix bytes, %u points kept, %u bytes encoded\n", (unsigned)raw, kept, len);
+    CHECK(len * 10 <= raw);
+}
+
+static void testCellSkipped(GSMLocation& location)
+{
+    GSMTrack track(location, TOLERANCE_M);
+    const char rmc[] = "+GPSRD:$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+    location.handleUrc(rmc, strlen(rmc));
+    CHECK(track.poll());
+    CHECK_EQUAL(1, track.count());
+    CHECK_EQUAL(LOCATION_GNSS, location.source());
+
+    //the cell fallback kicks in: available(), but not a GNSS fix
+    location.setCellFallback(10);
+    delay(20);
+    CHECK(!track.poll());
+    CHECK_EQUAL(LOCATION_CELL, location.source());
+    track.flush();
+    CHECK_EQUAL(1, track.count());
+    location.setCellFallback(0);
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command == "AT+CREG?") {
+            return ModemSim::ok("+CREG: 2,1,\"1A\",\"2B\"");
+        }
+        if (command == "AT+LOCATION=1") {
+            return ModemSim::ok("45.464211,9.191383");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GSMLocation location(modem);
+
+    testDrive(location);
+    testCellSkipped(location);
+
+    sim.stop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,45 @@
+#include "ModemSim.h"
+#include "TestCheck.h"
+
+#include <A9GLib.h>
+
+//received socket data is counted per mux, chunks for a mux out of range are dropped
+int main()
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    ModemSim sim;
+    sim.respond([](const std::string& command, const std::string&) {
+        if (command.compare(0, 11, "AT+CIPSTART") == 0) {
+            return std::string("\r\n+CIPNUM:0\r\n\r\nCONNECT OK\r\n\r\nOK\r\n");
+        }
+        return ModemSim::ok();
+    });
+    CHECK(sim.start());
+
+    Uart uart(sim.device());
+    ModemClass modem(uart, 115200);
+    CHECK(modem.init());
+    GPRS gprs(modem);
+    uint8_t mux = 0xFF;
+    CHECK(gprs.connect("10.0.0.1", 5000, &mux, 5, NULL));
+    CHECK_EQUAL(0, mux);
+
+    sim.inject("+CIPRCV,7,3:bad\r\n+CIPRCV,200,3:bad\r\n+CIPRCV,0,5:hello\r\n");
+    for (unsigned long start = millis(); millis() - start < 1000 && gprs.available(0) < 5;) {
+        modem.poll();
+    }
+    CHECK_EQUAL(5, gprs.available(0));
+    char buf[8] = {0};
+    CHECK_EQUAL(5, gprs.read(0, buf, 5, 0));
+    CHECK(strcmp(buf, "hello") == 0);
+
+    ModemUsage usage = modem.usage();
+    CHECK_EQUAL(5, usage.socketReceived[0]);
+    CHECK_EQUAL(0, usage.socketReceived[1]);
+    CHECK_EQUAL(0, usage.socketReceived[2]);
+
+    gprs.close(0, 1000);
+    sim.stop();
+    return TEST_RESULT();
+}
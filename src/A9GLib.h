@@ -4,6 +4,25 @@
 #include "GSM.h"
 #include "GPRS.h"
 #include "socket.h"
+#include "GSMJournal.h"
+#include "GSMCompress.h"
+#include "GSMCbor.h"
+#include "GSMResolver.h"
+#include "GSMSms.h"
+#include "GSMLocation.h"
+#include "GSMTrack.h"
+#include "GSMClock.h"
+#include "GSMSignal.h"
+#include "GSMRegistration.h"
+#include "GSMProfile.h"
+#include "GSMTrace.h"
+#include "GSMPower.h"
+#include "GSMEnergy.h"
+#include "GSMOwner.h"
+#include "GSMCoroutine.h"
+#include "GSMTimer.h"
+#include "GSMPriority.h"
+#include "GSMRetry.h"
 
 #define A9GLIB_VERSION "0.1.1"
 
@@ -1,8 +1,13 @@
 #include "GPRS.h"
+#include "GSMTrace.h"
 
 enum {
     GPRS_STATE_IDLE,
 
+    GPRS_STATE_PROBE,
+    GPRS_STATE_WAIT_PROBE_RESPONSE,
+    GPRS_STATE_WAIT_RETRY,
+
     GPRS_STATE_ATTACH,
     GPRS_STATE_WAIT_ATTACH_RESPONSE,
 
@@ -19,17 +24,40 @@ enum {
     GPRS_STATE_WAIT_DEACTIVATE_IP_RESPONSE,
 
     GPRS_STATE_DEATTACH,
-    GPRS_STATE_WAIT_DEATTACH_RESPONSE
+    GPRS_STATE_WAIT_DEATTACH_RESPONSE,
+
+    GPRS_STATE_RESTORE_MODE,
+    GPRS_STATE_WAIT_RESTORE_MODE_RESPONSE,
+    GPRS_STATE_WAIT_RESTORE_MUX_RESPONSE
 };
 
+//what is left of a timeout_ms budget that started at start
+static unsigned long remaining(unsigned long start, unsigned long timeout_ms)
+{
+    unsigned long elapsed = millis() - start;
+    return elapsed < timeout_ms ? timeout_ms - elapsed : 0;
+}
+
 //this should be a singleton!!!
-GPRS::GPRS():
+GPRS::GPRS(ModemClass& modem):
+    _modem(&modem),
     _apn(NULL),
     _username(NULL),
     _password(NULL),
     _state(GPRS_OFF),
-    _timeout(0)
+    _timeout(0),
+    _encoder(NULL),
+    _frame(NULL),
+    _dnsCache(true),
+    _resolver(modem),
+    _attachRetry(NULL),
+    _connectRetry(NULL)
+{
+}
+
+GPRS::~GPRS()
 {
+    setCompression(false);
 }
 
 NetworkStatus GPRS::attachGPRS(const char* apn, const char* user_name, const char* password, bool synchronous)
@@ -38,13 +66,28 @@ NetworkStatus GPRS::attachGPRS(const char* apn, const char* user_name, const cha
     _username = user_name;
     _password = password;
 
-    _readyState = GPRS_STATE_ATTACH;
+    if (_attachRetry != NULL && !_attachRetry->begin()) {
+        //backing off, or the breaker is open
+        _readyState = GPRS_STATE_IDLE;
+        _state = ERROR;
+        return _state;
+    }
+
+    _readyState = GPRS_STATE_PROBE;
     _state = CONNECTING;
 
     if (synchronous) {
-        unsigned long start = millis();
+        GSMTimer deadline;
+        if (_timeout) {
+            _modem->timers().arm(deadline, _timeout);
+        }
         while (ready() == 0) {
-            if (_timeout && !((millis() - start) < _timeout)) {
+            if (deadline.expired()) {
+                //a step that failed and is waiting for its retry was counted by ready()
+                if (_attachRetry != NULL && _readyState != GPRS_STATE_WAIT_RETRY) {
+                    _attachRetry->failure();
+                }
+                _readyState = GPRS_STATE_IDLE;
                 _state = ERROR;
                 break;
             }
@@ -71,20 +114,87 @@ NetworkStatus GPRS::detachGPRS(bool synchronous)
 
 uint8_t GPRS::ready()
 {
-    uint8_t ready = MODEM.ready();
+    uint8_t ready = _modem->ready();
 
     if (ready == 0) {
         return 0;
     }
 
+    #ifdef GSM_TRACE
+    uint8_t previousState = _readyState;
+    #endif
+
     switch (_readyState) {
     case GPRS_STATE_IDLE:
     default: {
         break;
     }
 
+    case GPRS_STATE_PROBE: {
+        _modem->setResponseDataStorage(&_response);
+        _modem->send(PROBE_COMMAND);
+        _readyState = GPRS_STATE_WAIT_PROBE_RESPONSE;
+        ready = 0;
+        break;
+    }
+
+    case GPRS_STATE_WAIT_PROBE_RESPONSE: {
+        //skip what a modem that kept running across an MCU reset already did
+        ModemProbe& probe = _modem->lastProbe();
+        probe = ModemProbe();
+        if (ready == 1) {
+            probe.parse(_response.c_str());
+        }
+        if (probe.pdpActive) {
+            //a data mode session before the reset may have left CIPMODE=1 and CIPMUX=0
+            _readyState = GPRS_STATE_RESTORE_MODE;
+            ready = 0;
+        } else {
+            _readyState = probe.attached ? GPRS_STATE_SET_PDP_CONTEXT : GPRS_STATE_ATTACH;
+            ready = 0;
+        }
+        probe.valid = false;
+        break;
+    }
+
+    case GPRS_STATE_RESTORE_MODE: {
+        _modem->send("AT+CIPMODE=0");
+        _readyState = GPRS_STATE_WAIT_RESTORE_MODE_RESPONSE;
+        ready = 0;
+        break;
+    }
+
+    case GPRS_STATE_WAIT_RESTORE_MODE_RESPONSE: {
+        //an error only means CIPMODE=0 already
+        _modem->send("AT+CIPMUX=1");
+        _readyState = GPRS_STATE_WAIT_RESTORE_MUX_RESPONSE;
+        ready = 0;
+        break;
+    }
+
+    case GPRS_STATE_WAIT_RESTORE_MUX_RESPONSE: {
+        if (ready > 1) {
+            ready = attachFailed(ready);
+        } else {
+            _readyState = GPRS_STATE_IDLE;
+            _state = GPRS_READY;
+            if (_attachRetry != NULL) {
+                _attachRetry->success();
+            }
+        }
+        break;
+    }
+
+    case GPRS_STATE_WAIT_RETRY: {
+        if (_attachRetry->allow()) {
+            _readyState = GPRS_STATE_PROBE; //skips the steps that went through
+        }
+        ready = 0;
+        break;
+    }
+
     case GPRS_STATE_ATTACH: {
-        MODEM.send("AT+CGATT=1");
+        _modem->send("AT+CGATT=1");
         _readyState = GPRS_STATE_WAIT_ATTACH_RESPONSE;
         ready = 0;
         break;
@@ -92,8 +202,7 @@ uint8_t GPRS::ready()
 
     case GPRS_STATE_WAIT_ATTACH_RESPONSE: {
         if (ready > 1) {
-            _readyState = GPRS_STATE_IDLE;
-            _state = ERROR;
+            ready = attachFailed(ready);
         } else {
             _readyState = GPRS_STATE_SET_PDP_CONTEXT;
             ready = 0;
@@ -101,7 +210,7 @@ uint8_t GPRS::ready()
         break;
     }
     case GPRS_STATE_SET_PDP_CONTEXT: {
-        MODEM.sendf("AT+CIPMUX=1"); //enable 8 sockets or simultaneous connections
+        _modem->sendf("AT+CIPMUX=1"); //enable 8 sockets or simultaneous connections
         _readyState = GPRS_STATE_WAIT_SET_PDP_CONTEXT_RESPONSE;
         ready = 0;
         break;
@@ -109,8 +218,7 @@ uint8_t GPRS::ready()
 
     case GPRS_STATE_WAIT_SET_PDP_CONTEXT_RESPONSE: {
         if (ready > 1) {
-            _readyState = GPRS_STATE_IDLE;
-            _state = ERROR;
+            ready = attachFailed(ready);
         } else {
             _readyState = GPRS_STATE_SET_USERNAME_PASSWORD;
             ready = 0;
@@ -119,7 +227,7 @@ uint8_t GPRS::ready()
     }
 
     case GPRS_STATE_SET_USERNAME_PASSWORD: {
-        MODEM.sendf("AT+CSTT=\"%s\",\"%s\",\"%s\"", _apn, _username, _password);
+        _modem->sendf("AT+CSTT=\"%s\",\"%s\",\"%s\"", _apn, _username, _password);
         _readyState = GPRS_STATE_WAIT_SET_USERNAME_PASSWORD_RESPONSE;
         ready = 0;
         break;
@@ -127,8 +235,7 @@ uint8_t GPRS::ready()
 
     case GPRS_STATE_WAIT_SET_USERNAME_PASSWORD_RESPONSE: {
         if (ready > 1) {
-            _readyState = GPRS_STATE_IDLE;
-            _state = ERROR;
+            ready = attachFailed(ready);
         } else {
             _readyState = GPRS_STATE_ACTIVATE_IP;
             ready = 0;
@@ -137,7 +244,7 @@ uint8_t GPRS::ready()
     }
 
     case GPRS_STATE_ACTIVATE_IP: {
-        MODEM.send("AT+CIICR");
+        _modem->send("AT+CIICR");
         _readyState = GPRS_STATE_WAIT_ACTIVATE_IP_RESPONSE;
         ready = 0;
         break;
@@ -146,15 +253,18 @@ uint8_t GPRS::ready()
     case GPRS_STATE_WAIT_ACTIVATE_IP_RESPONSE: {
         _readyState = GPRS_STATE_IDLE;
         if (ready > 1) {
-            _state = ERROR;
+            ready = attachFailed(ready);
         } else {
             _state = GPRS_READY;
+            if (_attachRetry != NULL) {
+                _attachRetry->success();
+            }
         }
         break;
     }
 
     case GPRS_STATE_DEACTIVATE_IP: {
-        MODEM.send("AT+CIPSHUT");
+        _modem->send("AT+CIPSHUT");
         _readyState = GPRS_STATE_WAIT_DEACTIVATE_IP_RESPONSE;
         ready = 0;
         break;
@@ -172,7 +282,7 @@ uint8_t GPRS::ready()
     }
 
     case GPRS_STATE_DEATTACH: {
-        MODEM.send("AT+CGATT=0");
+        _modem->send("AT+CGATT=0");
         _readyState = GPRS_STATE_WAIT_DEATTACH_RESPONSE;
         ready = 0;
         break;
@@ -188,14 +298,30 @@ uint8_t GPRS::ready()
         break;
     }
     }
+    #ifdef GSM_TRACE
+    if (_readyState != previousState) {
+        TRACE(TRACE_GPRS, _readyState);
+    }
+    #endif
+    return ready;
+}
+
+uint8_t GPRS::attachFailed(uint8_t ready)
+{
+    if (_attachRetry != NULL && _attachRetry->failure()) {
+        _readyState = GPRS_STATE_WAIT_RETRY;
+        return 0;
+    }
+    _readyState = GPRS_STATE_IDLE;
+    _state = ERROR;
     return ready;
 }
 
 IPAddress GPRS::getIPAddress()
 {
     String response;
-    MODEM.send("AT+CIFSR?");
-    if (MODEM.waitForResponse(100, &response) == 1) {
+    _modem->send("AT+CIFSR?");
+    if (_modem->waitForResponse(100, &response) == 1) {
         response = response.substring(0, response.indexOf("\r")); //remove response code OK
         IPAddress ip;
         if (ip.fromString(response)) {
@@ -210,6 +336,16 @@ void GPRS::setTimeout(unsigned long timeout)
     _timeout = timeout;
 }
 
+void GPRS::setAttachPolicy(GSMRetryPolicy* policy)
+{
+    _attachRetry = policy;
+}
+
+void GPRS::setConnectPolicy(GSMRetryPolicy* policy)
+{
+    _connectRetry = policy;
+}
+
 NetworkStatus GPRS::status()
 {
     return _state;
@@ -217,20 +353,95 @@ NetworkStatus GPRS::status()
 
 bool GPRS::connect(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, ConnectionStatus* status) 
 {
-    if(MODEM._initSocks >= MAX_SOCKETS){
+    if(_modem->_initSocks >= MAX_SOCKETS){
         if(status != NULL)
             *status = ConnectionStatus::ERROR;
         return false;
     }
 
-    unsigned long start = millis();
+    if (_connectRetry == NULL){
+        return connectOnce(host, port, mux, timeout_s, status);
+    }
+    if (!_connectRetry->begin()){
+        //backing off, or the breaker is open
+        if(status != NULL)
+            *status = ConnectionStatus::ERROR;
+        return false;
+    }
+    for (;;){
+        if (connectOnce(host, port, mux, timeout_s, status)){
+            _connectRetry->success();
+            return true;
+        }
+        if (!_connectRetry->failure()){
+            return false;
+        }
+        GSMTimer backoff;
+        for (_modem->timers().arm(backoff, _connectRetry->wait()); !backoff.expired();){
+            _modem->poll();
+        }
+    }
+}
+
+bool GPRS::connectOnce(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, ConnectionStatus* status)
+{
+    //one budget for the DNS queries and the CIPSTARTs together
     unsigned long timeout_ms = timeout_s * 1000;
-    
+    unsigned long start = millis();
+    IPAddress ip;
+
+    if (!_dnsCache || ip.fromString(host)){
+        return connectTo(host, port, mux, timeout_ms, status);
+    }
+
+    bool cached = _resolver.lookup(host, ip);
+    if (!cached && !_resolver.query(host, ip, timeout_ms)){
+        //let the modem resolve the name itself
+        return connectTo(host, port, mux, remaining(start, timeout_ms), status);
+    }
+
+    char addr[16];
+    sprintf(addr, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    ConnectionStatus result;
+    if (connectTo(addr, port, mux, remaining(start, timeout_ms), &result)){
+        if(status != NULL)
+            *status = result;
+        return true;
+    }
+
+    if (cached && (result == ConnectionStatus::CONNECT_FAIL || result == ConnectionStatus::TIMEOUT)){
+        //the cached address may be stale
+        _resolver.invalidate(host);
+        unsigned long left = remaining(start, timeout_ms);
+        if (left > 0 && _resolver.query(host, ip, left)){
+            sprintf(addr, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+            return connectTo(addr, port, mux, remaining(start, timeout_ms), status);
+        }
+    }
+    if(status != NULL)
+        *status = result;
+    return false;
+}
+
+bool GPRS::connectTo(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_ms, ConnectionStatus* status)
+{
+    if (timeout_ms == 0){
+        //the budget went on DNS
+        if(status != NULL)
+            *status = ConnectionStatus::TIMEOUT;
+        return false;
+    }
     String response;
-    MODEM.sendf("AT+CIPSTART=\"TCP\",\"%s\",%s", host, String(port).c_str());
-    int result = MODEM.waitForResponse(timeout_ms, &response);
-    //this response should contain either "CONNECT OK", "CONNECT FAIL", or "ALREADY CONNECT"
+    TRACE(TRACE_CONNECT, 0);
+    _modem->sendf("AT+CIPSTART=\"TCP\",\"%s\",%s", host, String(port).c_str());
+    int result = _modem->waitForResponse(timeout_ms, &response);
+    TRACE(TRACE_CONNECT, result == 1 && response.indexOf(CONNECT_OK) != -1 ? 1 : 2);
+    return connected(result, response, mux, status);
+}
 
+bool GPRS::connected(int result, const String& response, uint8_t* mux, ConnectionStatus* status)
+{
+    //this response should contain either "CONNECT OK", "CONNECT FAIL", or "ALREADY CONNECT"
     if (result == -1){
         if(status != NULL)
             *status = ConnectionStatus::TIMEOUT;
@@ -247,8 +458,8 @@ bool GPRS::connect(const char* host, uint16_t port, uint8_t* mux, unsigned long
             *status = ConnectionStatus::CONNECT_OK;
         uint8_t newMux = atoi(response.c_str() + 8);
         *mux = newMux;
-        MODEM._sockets[newMux] = new GSM_Socket(newMux);
-        MODEM._initSocks++;
+        _modem->_sockets[newMux] = new GSM_Socket(*_modem, newMux);
+        _modem->_initSocks++;
         return true;
     }
     else if(response.indexOf(CONNECT_FAIL) != -1){
@@ -268,24 +479,208 @@ bool GPRS::connect(const char* host, uint16_t port, uint8_t* mux, unsigned long
     }
 }
 
+bool GPRS::openDataMode(const char* host, uint16_t port, unsigned long timeout_s)
+{
+    if (_modem->_initSocks > 0 || _modem->dataMode()){
+        return false;
+    }
+
+    unsigned long timeout_ms = timeout_s * 1000;
+    unsigned long start = millis();
+    IPAddress ip;
+    char addr[16];
+    if (_dnsCache && !ip.fromString(host) && _resolver.resolve(host, ip, timeout_ms)){
+        sprintf(addr, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+        host = addr;
+    }
+
+    _modem->send("AT+CIPMUX=0");
+    if (_modem->waitForResponse() != 1){
+        return false;
+    }
+    _modem->send("AT+CIPMODE=1");
+    if (_modem->waitForResponse() == 1){
+        char command[128];
+        snprintf(command, sizeof(command), "AT+CIPSTART=\"TCP\",\"%s\",%u", host, port);
+        TRACE(TRACE_CONNECT, 0);
+        unsigned long left = remaining(start, timeout_ms);
+        bool connected = left > 0 && _modem->startDataMode(command, left);
+        TRACE(TRACE_CONNECT, connected ? 1 : 2);
+        if (connected){
+            return true;
+        }
+    }
+
+    _modem->send("AT+CIPMODE=0");
+    _modem->waitForResponse();
+    _modem->send("AT+CIPMUX=1");
+    _modem->waitForResponse();
+    return false;
+}
+
+uint16_t GPRS::dataSend(const void* buff, uint16_t len)
+{
+    if (!_modem->dataMode()){
+        return 0;
+    }
+    uint16_t sent = _modem->write(reinterpret_cast<const uint8_t*>(buff), len);
+    _modem->_usage.socketSent[0] += sent;
+    return sent;
+}
+
+uint16_t GPRS::dataRead(void* buf, uint16_t len, unsigned long timeout)
+{
+    return _modem->dataRead(buf, len, timeout);
+}
+
+int GPRS::dataAvailable()
+{
+    int available = _modem->dataAvailable();
+    return available == 0 && _modem->_dataClosed ? -1 : available;
+}
+
+bool GPRS::suspendDataMode()
+{
+    return _modem->dataMode() && _modem->escapeDataMode() && !_modem->_dataClosed;
+}
+
+bool GPRS::resumeDataMode(unsigned long timeout)
+{
+    return !_modem->dataMode() && _modem->startDataMode("ATO", timeout);
+}
+
+bool GPRS::closeDataMode()
+{
+    if (_modem->dataMode() && !_modem->escapeDataMode()){
+        return false;
+    }
+    //after a close by the peer there is no connection left, CIPCLOSE only fails
+    _modem->send("AT+CIPCLOSE");
+    bool closed = _modem->waitForResponse(1000) == 1 || _modem->_dataClosed;
+    _modem->send("AT+CIPMODE=0");
+    _modem->waitForResponse();
+    _modem->send("AT+CIPMUX=1");
+    return _modem->waitForResponse() == 1 && closed;
+}
+
 bool GPRS::close(uint8_t mux, unsigned long timeout) //just closes the TCP connection
 {	
-    MODEM.sendf("AT+CIPCLOSE=%d", mux);
-    int result = MODEM.waitForResponse(timeout);
+    _modem->sendf("AT+CIPCLOSE=%d", mux);
+    int result = _modem->waitForResponse(timeout);
     if (result == 1){
-        delete MODEM._sockets[mux];
-        MODEM._initSocks--;
+        release(mux);
         return true;
     }
     return false;
 }
 
+void GPRS::release(uint8_t mux)
+{
+    if (mux >= MAX_SOCKETS || _modem->_sockets[mux] == NULL){
+        return;
+    }
+    delete _modem->_sockets[mux];
+    _modem->_sockets[mux] = NULL;
+    _modem->_initSocks--;
+}
+
+void GPRS::setDnsCache(bool on)
+{
+    _dnsCache = on;
+}
+
+GSMResolver& GPRS::resolver()
+{
+    return _resolver;
+}
+
+void GPRS::setCompression(bool on)
+{
+    if (on && _encoder == NULL){
+        _encoder = new LzEncoder();
+        _frame = new uint8_t[LZ_FRAME_MAX];
+    }
+    else if (!on && _encoder != NULL){
+        delete _encoder;
+        delete[] _frame;
+        _encoder = NULL;
+        _frame = NULL;
+    }
+}
+
+uint16_t GPRS::frame(const uint8_t* in, uint16_t len)
+{
+    return _encoder->frame(in, len, _frame, LZ_FRAME_MAX);
+}
+
 uint16_t GPRS::send(uint8_t mux, const void* buff, uint16_t len)
 {
-    return MODEM._sockets[mux]->send(buff, len);
+    if (_encoder == NULL){
+        return _modem->_sockets[mux]->send(buff, len);
+    }
+
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(buff);
+    uint16_t sent = 0;
+    while (sent < len){
+        uint16_t chunk = min(len - sent, LZ_BATCH_MAX);
+        uint16_t frameLen = frame(in + sent, chunk);
+        if (frameLen == 0 || _modem->_sockets[mux]->send(_frame, frameLen) != frameLen){
+            break;
+        }
+        sent += chunk;
+    }
+    return sent; //counted in uncompressed bytes
+}
+
+bool GPRS::sendStart(uint8_t mux, const void* buff, uint16_t len)
+{
+    return _modem->_sockets[mux]->sendStart(buff, len);
+}
+
+uint16_t GPRS::sendEnd(uint8_t mux, int result, uint16_t len)
+{
+    return _modem->_sockets[mux]->sendEnd(result, len);
 }
 
 uint16_t GPRS::read(uint8_t mux, void* buf, uint16_t len, unsigned long timeout)
 {
-    return MODEM._sockets[mux]->read(buf, len, timeout);
+    return _modem->_sockets[mux]->read(buf, len, timeout);
+}
+
+uint16_t GPRS::available(uint8_t mux)
+{
+    if (mux >= MAX_SOCKETS || _modem->_sockets[mux] == NULL){
+        return 0;
+    }
+    return _modem->_sockets[mux]->available();
+}
+
+GSMSocketSink::GSMSocketSink(GPRS& gprs, uint8_t mux):
+    _gprs(&gprs),
+    _mux(mux),
+    _len(0)
+{
+}
+
+uint16_t GSMSocketSink::write(const uint8_t* buf, uint16_t len)
+{
+    uint16_t written = 0;
+    while (written < len){
+        if (_len == SOCKET_SINK_MAX && !flush()){
+            break;
+        }
+        uint16_t n = min(len - written, SOCKET_SINK_MAX - _len);
+        memcpy(_buf + _len, buf + written, n);
+        _len += n;
+        written += n;
+    }
+    return written;
+}
+
+bool GSMSocketSink::flush()
+{
+    if (_len == 0) return true;
+    bool sent = _gprs->send(_mux, _buf, _len) == _len;
+    _len = 0;
+    return sent;
 }
@@ -6,6 +6,10 @@
 #include "GSM.h"
 #include "modem.h"
 #include "socket.h"
+#include "GSMCompress.h"
+#include "GSMSink.h"
+#include "GSMResolver.h"
+#include "GSMRetry.h"
 
 static const char CONNECT_OK[] PROGMEM = "CONNECT OK";
 static const char CONNECT_FAIL[] PROGMEM = "CONNECT FAIL";
@@ -16,21 +20,81 @@ class GPRS{
 public:
 
     enum class ConnectionStatus {ERROR, CONNECT_OK, CONNECT_FAIL, CONNECT_ALREADY, TIMEOUT};
-    GPRS();
+    GPRS(ModemClass& modem = MODEM);
+    ~GPRS();
     NetworkStatus attachGPRS(const char* apn, const char* user_name, const char* password, bool synchronous = true);
     NetworkStatus detachGPRS(bool synchronous = true);
 
     bool connect(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, ConnectionStatus* status);
     bool close(uint8_t mux, unsigned long timeout); 
+    /** Free the socket slot of a connection the modem has already dropped (lost PDP context,
+      failed close()) without sending anything
+    */
+    void release(uint8_t mux);
     uint16_t send(uint8_t mux, const void* buff, uint16_t len);
     uint16_t read(uint8_t mux, void * buf, uint16_t len = 1, unsigned long timeout = 1000L);
+    /** Bytes buffered for mux, read() returns them without waiting
+    */
+    uint16_t available(uint8_t mux);
 
     uint8_t ready();
     IPAddress getIPAddress();
     void setTimeout(unsigned long timeout);
     NetworkStatus status();
-    
+
+    /** Retry policies (see GSMRetry.h), none by default. A failed attach step restarts
+      the attach after the backoff, and connect() retries within its budget; calls are
+      refused while backing off or while the breaker is open.
+    */
+    void setAttachPolicy(GSMRetryPolicy* policy);
+    void setConnectPolicy(GSMRetryPolicy* policy);
+
+    /** Compress every send() into LZ frames (see GSMCompress.h), one CIPSEND per frame.
+      The server has to decode the stream with LzDecoder::unframe or an equivalent.
+      The encoder and its frame buffer (about 1 KB) are allocated while this is on.
+    */
+    void setCompression(bool on);
+
+    /** Resolve host names once with AT+CDNSGIP and connect to the cached address.
+      Enabled by default; a failed connect to a cached address is retried once after
+      resolving the name again. The queries and the connects share the connect() timeout.
+    */
+    void setDnsCache(bool on);
+    GSMResolver& resolver();
+
+    /** Open a single TCP connection in transparent mode (CIPMUX=0, CIPMODE=1): once
+      connected the UART carries raw payload, use dataSend()/dataRead(). No other socket
+      may be open, and every other modem command fails until suspendDataMode(). When the
+      peer closes, data mode ends and dataAvailable() returns -1 once the payload has
+      been read; call closeDataMode() to restore multiple connection mode.
+    */
+    bool openDataMode(const char* host, uint16_t port, unsigned long timeout_s = 30);
+    uint16_t dataSend(const void* buff, uint16_t len);
+    uint16_t dataRead(void* buf, uint16_t len, unsigned long timeout = 1000L);
+    int dataAvailable();
+
+    /** Back to command mode with the escape sequence, keeping the connection. Read the
+      pending payload first: what arrives until the modem answers is discarded.
+    */
+    bool suspendDataMode();
+    /** Back to data mode with ATO
+    */
+    bool resumeDataMode(unsigned long timeout = 5000L);
+    /** Close the connection and restore multiple connection mode
+    */
+    bool closeDataMode();
+
 private:
+    friend class ModemScheduler;
+    ModemClass* _modem;
+    bool connectOnce(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, ConnectionStatus* status);
+    bool connectTo(const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_ms, ConnectionStatus* status);
+    uint8_t attachFailed(uint8_t ready);
+    bool connected(int result, const String& response, uint8_t* mux, ConnectionStatus* status);
+    bool sendStart(uint8_t mux, const void* buff, uint16_t len);
+    uint16_t sendEnd(uint8_t mux, int result, uint16_t len);
+    uint16_t frame(const uint8_t* in, uint16_t len);
+
     const char* _apn;
     const char* _username;
     const char* _password;
@@ -38,6 +102,31 @@ private:
     uint8_t _readyState;
     String _response;
     unsigned long _timeout;
+    LzEncoder* _encoder; //NULL unless compressing
+    uint8_t* _frame;
+    bool _dnsCache;
+    GSMResolver _resolver;
+    GSMRetryPolicy* _attachRetry;
+    GSMRetryPolicy* _connectRetry;
+};
+
+#define SOCKET_SINK_MAX 128
+
+/* Sink buffering bytes for a connected socket and sending them with GPRS::send
+    every SOCKET_SINK_MAX bytes, and on flush().
+*/
+class GSMSocketSink : public ByteSink {
+
+public:
+    GSMSocketSink(GPRS& gprs, uint8_t mux);
+    uint16_t write(const uint8_t* buf, uint16_t len);
+    bool flush();
+
+private:
+    GPRS* _gprs;
+    uint8_t _mux;
+    uint8_t _buf[SOCKET_SINK_MAX];
+    uint16_t _len;
 };
 
 #endif
@@ -1,48 +1,82 @@
-#define _XOPEN_SOURCE
 #include <time.h>
 
 #include "modem.h"
 
 #include "GSM.h"
+#include "GSMTrace.h"
 
 enum {
     READY_STATE_CHECK_SIM,
     READY_STATE_WAIT_CHECK_SIM_RESPONSE,
+    READY_STATE_WAIT_SIM_RETRY,
     READY_STATE_UNLOCK_SIM,
     READY_STATE_WAIT_UNLOCK_SIM_RESPONSE,
     READY_STATE_SET_PREFERRED_MESSAGE_FORMAT,
     READY_STATE_WAIT_SET_PREFERRED_MESSAGE_FORMAT_RESPONSE,
+    READY_STATE_ENABLE_REGISTRATION_REPORTS,
+    READY_STATE_WAIT_ENABLE_REGISTRATION_REPORTS_RESPONSE,
+    READY_STATE_WAIT_ENABLE_GPRS_REGISTRATION_REPORTS_RESPONSE,
     READY_STATE_CHECK_REGISTRATION,
     READY_STATE_WAIT_CHECK_REGISTRATION_RESPONSE,
+    READY_STATE_WAIT_REGISTRATION_REPORT,
     READY_STATE_IDLE
 };
 
+#define REGISTRATION_REQUERY_MS 30000UL //in case a report got lost
+
 static const char GSM_W_SIGNAL[] PROGMEM = "WEAK";
 static const char GSM_F_SIGNAL[] PROGMEM = "FAIR";
 static const char GSM_G_SIGNAL[] PROGMEM = "GOOD";
 static const char GSM_E_SIGNAL[] PROGMEM = "EXCELLENT";
+static const char GSM_U_SIGNAL[] PROGMEM = "UNKNOWN";
 
-GSM::GSM():
+GSM::GSM(ModemClass& modem):
+    _modem(&modem),
     _state(GSM_OFF),
     _readyState(0),
     _pin(NULL),
-    _timeout(0)
+    _timeout(0),
+    _clock(modem),
+    _signal(modem),
+    _registration(modem),
+    _retry(NULL)
 {
 }
 
 NetworkStatus GSM::init(const char* pin, bool restart, bool synchronous)
 {
-    if ((restart && !MODEM.restart()) || (!restart && !MODEM.init())) {
+    if (_retry != NULL && !_retry->begin()) {
+        //backing off, or the breaker is open
         _state = ERROR;
+        return _state;
+    }
+    _state = CONNECTING; //clears the ERROR of a previous call, or ready() would stop at once
+
+    if ((restart && !_modem->restart()) || (!restart && !_modem->init())) {
+        fail();
     } else{
         _pin = pin;
         _readyState = READY_STATE_CHECK_SIM;
 
+        //warm start: a modem that kept running across an MCU reset may be unlocked already
+        if (!restart && _modem->probe() && _modem->lastProbe().simReady) {
+            _readyState = READY_STATE_SET_PREFERRED_MESSAGE_FORMAT;
+        }
+
         if (synchronous) {
-            unsigned long start = millis();
+            GSMTimer deadline;
+            if (_timeout) {
+                _modem->timers().arm(deadline, _timeout);
+            }
             while (ready() == 0) {
-                if (_timeout && !((millis() - start) < _timeout)) {
-                    _state = ERROR;
+                if (deadline.expired()) {
+                    //a SIM check waiting for its retry was counted by ready()
+                    if (_readyState == READY_STATE_WAIT_SIM_RETRY) {
+                        _state = ERROR;
+                    } else {
+                        fail();
+                    }
+                    _readyState = READY_STATE_IDLE;
                     break;
                 }
                 delay(100);
@@ -56,20 +90,17 @@ NetworkStatus GSM::init(const char* pin, bool restart, bool synchronous)
 
 bool GSM::isAccessAlive()
 {
-    String response;
-    MODEM.send("AT+CREG?");
-    if (MODEM.waitForResponse(100, &response) == 1) {
-        int status = response.charAt(response.indexOf(',') + 1) - '0';
-        if (status == 1 || status == 5) {
-            return true;
-        }
+    if (!_registration.enabled()) {
+        _registration.begin();
+    } else {
+        _modem->poll();
     }
-    return false;
+    return _registration.registered();
 }
 
 bool GSM::shutdown()
 {
-    if(MODEM.powerOff()){
+    if(_modem->powerOff()){
         _state = GSM_OFF;
         return true;
     }
@@ -82,16 +113,20 @@ uint8_t GSM::ready()
         return 2;
     }
 
-    uint8_t ready = MODEM.ready();
+    uint8_t ready = _modem->ready();
 
     if (ready == 0) {
         return 0;
     }
 
+    #ifdef GSM_TRACE
+    uint8_t previousState = _readyState;
+    #endif
+
     switch (_readyState) {
     case READY_STATE_CHECK_SIM: {
-        MODEM.setResponseDataStorage(&_response);
-        MODEM.send("AT+CPIN?");
+        _modem->setResponseDataStorage(&_response);
+        _modem->send("AT+CPIN?");
         _readyState = READY_STATE_WAIT_CHECK_SIM_RESPONSE;
         ready = 0;
         break;
@@ -99,9 +134,17 @@ uint8_t GSM::ready()
 
     case READY_STATE_WAIT_CHECK_SIM_RESPONSE: {
         if (ready > 1) {
-            // error => retry
-            _readyState = READY_STATE_CHECK_SIM;
-            ready = 0;
+            // error => retry, after a backoff with a retry policy
+            if (_retry == NULL) {
+                _readyState = READY_STATE_CHECK_SIM;
+                ready = 0;
+            } else if (_retry->failure()) {
+                _readyState = READY_STATE_WAIT_SIM_RETRY;
+                ready = 0;
+            } else {
+                _state = ERROR;
+                ready = 2;
+            }
         } else {
             if (_response.indexOf("READY") != -1) {
                 _readyState = READY_STATE_SET_PREFERRED_MESSAGE_FORMAT;
@@ -110,32 +153,37 @@ uint8_t GSM::ready()
                 _readyState = READY_STATE_UNLOCK_SIM;
                 ready = 0;
             } else {
-                _state = ERROR;
-                ready = 2;
+                ready = fail();
             }
         }
 
         break;
     }
 
+    case READY_STATE_WAIT_SIM_RETRY: {
+        if (_retry->allow()) {
+            _readyState = READY_STATE_CHECK_SIM;
+        }
+        ready = 0;
+        break;
+    }
+
     case READY_STATE_UNLOCK_SIM: {
         if (_pin != NULL) {
-            MODEM.setResponseDataStorage(&_response);
-            MODEM.sendf("AT+CPIN=\"%s\"", _pin);
+            _modem->setResponseDataStorage(&_response);
+            _modem->sendf("AT+CPIN=\"%s\"", _pin);
 
             _readyState = READY_STATE_WAIT_UNLOCK_SIM_RESPONSE;
             ready = 0;
         } else {
-            _state = ERROR;
-            ready = 2;
+            ready = fail();
         }
         break;
     }
 
     case READY_STATE_WAIT_UNLOCK_SIM_RESPONSE: {
         if (ready > 1) {
-            _state = ERROR;
-            ready = 2;
+            ready = fail();
         } else {
             _readyState = READY_STATE_SET_PREFERRED_MESSAGE_FORMAT;
             ready = 0;
@@ -145,7 +193,7 @@ uint8_t GSM::ready()
     }
 
     case READY_STATE_SET_PREFERRED_MESSAGE_FORMAT: {
-        MODEM.send("AT+CMGF=1");
+        _modem->send("AT+CMGF=0"); //PDU mode, see GSMSms
         _readyState = READY_STATE_WAIT_SET_PREFERRED_MESSAGE_FORMAT_RESPONSE;
         ready = 0;
         break;
@@ -153,19 +201,55 @@ uint8_t GSM::ready()
 
     case READY_STATE_WAIT_SET_PREFERRED_MESSAGE_FORMAT_RESPONSE: {
         if (ready > 1) {
-            _state = ERROR;
-            ready = 2;
+            ready = fail();
         } else {
-            _readyState = READY_STATE_CHECK_REGISTRATION;
+            _readyState = READY_STATE_ENABLE_REGISTRATION_REPORTS;
             ready = 0;
         }
 
         break;
     }
 
+    case READY_STATE_ENABLE_REGISTRATION_REPORTS: {
+        //see GSMRegistration::begin()
+        _registration.listen();
+        _modem->send("AT+CREG=2");
+        _readyState = READY_STATE_WAIT_ENABLE_REGISTRATION_REPORTS_RESPONSE;
+        ready = 0;
+        break;
+    }
+
+    case READY_STATE_WAIT_ENABLE_REGISTRATION_REPORTS_RESPONSE: {
+        if (ready > 1) {
+            ready = fail();
+        } else {
+            _modem->send("AT+CGREG=1");
+            _readyState = READY_STATE_WAIT_ENABLE_GPRS_REGISTRATION_REPORTS_RESPONSE;
+            ready = 0;
+        }
+        break;
+    }
+
+    case READY_STATE_WAIT_ENABLE_GPRS_REGISTRATION_REPORTS_RESPONSE: {
+        //an error only means no +CGREG reports
+        ModemProbe& probe = _modem->lastProbe();
+        if (probe.registered()) {
+            //registered at probe time, later changes come as reports
+            _registration.set(REG_CS, (GSMRegistrationStatus)probe.creg);
+            _modem->timers().arm(_requery, REGISTRATION_REQUERY_MS);
+            _readyState = READY_STATE_WAIT_REGISTRATION_REPORT;
+        } else {
+            _readyState = READY_STATE_CHECK_REGISTRATION;
+        }
+        probe.valid = false; //used up, a restart must not take the fast path
+        ready = 0;
+        break;
+    }
+
     case READY_STATE_CHECK_REGISTRATION: {
-        MODEM.setResponseDataStorage(&_response);
-        MODEM.send("AT+CREG?");
+        _modem->setResponseDataStorage(&_response);
+        _modem->send("AT+CREG?");
+        _modem->timers().arm(_requery, REGISTRATION_REQUERY_MS);
         _readyState = READY_STATE_WAIT_CHECK_REGISTRATION_RESPONSE;
         ready = 0;
         break;
@@ -173,26 +257,38 @@ uint8_t GSM::ready()
 
     case READY_STATE_WAIT_CHECK_REGISTRATION_RESPONSE: {
         if (ready > 1) {
-            _state = ERROR;
-            ready = 2;
+            ready = fail();
         } else {
-            int status = _response.charAt(_response.indexOf(',') + 1) - '0';
+            _registration.parse(_response.c_str());
+            _readyState = READY_STATE_WAIT_REGISTRATION_REPORT;
+            ready = 0;
+        }
+        break;
+    }
 
-            if (status == 0 || status == 4) {
-                _readyState = READY_STATE_CHECK_REGISTRATION;
-                ready = 0;
-            } else if (status == 1 || status == 5) {
-                _readyState = READY_STATE_IDLE;
-                _state = GSM_READY;
-                ready = 1;
-            } else if (status == 2) {
-                _readyState = READY_STATE_CHECK_REGISTRATION;
+    case READY_STATE_WAIT_REGISTRATION_REPORT: {
+        //the reports keep _registration current, no polling of AT+CREG?
+        GSMRegistrationStatus status = _registration.status();
+
+        if (_registration.registered()) {
+            _requery.cancel();
+            _readyState = READY_STATE_IDLE;
+            _state = GSM_READY;
+            if (_retry != NULL) {
+                _retry->success();
+            }
+            ready = 1;
+        } else if (status == REG_DENIED) {
+            _requery.cancel();
+            ready = fail();
+        } else {
+            if (status == REG_SEARCHING) {
                 _state = CONNECTING;
-                ready = 0;
-            } else if (status == 3) {
-                _state = ERROR;
-                ready = 2;
             }
+            if (_requery.expired()) {
+                _readyState = READY_STATE_CHECK_REGISTRATION;
+            }
+            ready = 0;
         }
         break;
     }
@@ -201,78 +297,65 @@ uint8_t GSM::ready()
         break;
     }
     }
+    #ifdef GSM_TRACE
+    if (_readyState != previousState) {
+        TRACE(TRACE_GSM, _readyState);
+    }
+    #endif
     return ready;
 }
 
-void GSM::setTimeout(unsigned long timeout)
+void GSM::setRetryPolicy(GSMRetryPolicy* policy)
 {
-    _timeout = timeout;
+    _retry = policy;
 }
 
-unsigned long GSM::getTime() //UTC
+uint8_t GSM::fail()
 {
-    String response;
-
-    MODEM.send(F("AT+CCLK?"));
-    if (MODEM.waitForResponse(100, &response) != 1) {
-        return 0;
+    _state = ERROR;
+    if (_retry != NULL) {
+        _retry->failure();
     }
+    return 2;
+}
 
-    struct tm now;
-
-    if (strptime(response.c_str(), CLOCK_FORMAT, &now) != NULL) {
-        // adjust for timezone offset which is +/- in 15 minute increments
-
-        time_t result = mktime(&now);
-        time_t delta = ((response.charAt(26) - '0') * 10 + (response.charAt(27) - '0')) * (15 * 60);
-
-        if (response.charAt(25) == '-') {
-            result += delta;
-        } else if (response.charAt(25) == '+') {
-            result -= delta;
-        }
-
-        return result;
-    }
+void GSM::setTimeout(unsigned long timeout)
+{
+    _timeout = timeout;
+}
 
-    return 0;
+unsigned long GSM::getTime() //UTC
+{
+    return _clock.now();
 }
 
 unsigned long GSM::getLocalTime()
 {
-    String response;
-
-    MODEM.send(F("AT+CCLK?"));
-    if (MODEM.waitForResponse(100, &response) != 1) {
-        return 0;
-    }
-
-    struct tm now;
-
-    if (strptime(response.c_str(), CLOCK_FORMAT, &now) != NULL) {
-        time_t result = mktime(&now);
-        return result;
-    }
-
-    return 0;
+    return _clock.localNow();
 }
 
 bool GSM::setLocalTime(time_t time, uint8_t quarters_from_utc){ //time is UTC
 
     struct tm * now = localtime(&time);
-    MODEM.sendf("AT+CCLK=\"%.2d/%.2d/%.2d,%.2d:%.2d:%.2d%+.2d\"",
+    _modem->sendf("AT+CCLK=\"%.2d/%.2d/%.2d,%.2d:%.2d:%.2d%+.2d\"",
                 (now->tm_year + 1900) % 100, now->tm_mon + 1, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec % 60, quarters_from_utc);
-    return MODEM.waitForResponse() == 1;
+    _clock.invalidate();
+    return _modem->waitForResponse() == 1;
+}
+
+GSMClock& GSM::clock()
+{
+    return _clock;
 }
 
 void GSM::lowPowerMode()
 {
-    MODEM.lowPowerMode();
+    _modem->lowPowerMode();
 }
 
 void GSM::noLowPowerMode()
 {
-    MODEM.noLowPowerMode();
+    _modem->noLowPowerMode();
 }
 
 NetworkStatus GSM::status()
@@ -280,20 +363,25 @@ NetworkStatus GSM::status()
     return _state;
 }
 
+void GSM::poll()
+{
+    _signal.poll();
+}
+
 int8_t GSM::getSignalQuality(unsigned long timeout)
 {
-    MODEM.send(F("AT+CSQ"));
-    String response;
-    uint8_t result = MODEM.waitForResponse(timeout, &response);
-    if (result != 1) return 99;
-    else{
-        return 2*(atoi(response.c_str() + 6)-2) - 109; //result in dBm
+    if (!_signal.valid()){
+        _signal.sample(timeout);
     }
+    return _signal.rssi();
 }
 
 const char * GSM::signal2String(int8_t signalQuality)
 {
-    if(signalQuality < -100){
+    if(signalQuality == SIGNAL_UNKNOWN){
+        return GSM_U_SIGNAL;
+    }
+    else if(signalQuality < -100){
         return GSM_W_SIGNAL;
     }
     else if(signalQuality <= -90){
@@ -306,16 +394,33 @@ const char * GSM::signal2String(int8_t signalQuality)
         return GSM_E_SIGNAL;
 }
 
+const char * GSM::signal2String()
+{
+    return signal2String(_signal.rssi());
+}
+
+GSMSignal& GSM::signal()
+{
+    return _signal;
+}
+
 bool GSM::waitForNetwork(unsigned long timeout, int8_t * signal)
 {
-    for (unsigned long start = millis(); millis() - start < timeout;) {
-        if (isAccessAlive()){
-            if (signal != NULL){
-                *signal = getSignalQuality();
-            }
-            return true;
+    unsigned long start = millis();
+    while (!isAccessAlive()) {
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= timeout) {
+            return false;
         }
-        delay(250);
+        _registration.waitForChange(_registration.sequence(), timeout - elapsed);
     }
-    return false;
+    if (signal != NULL){
+        *signal = getSignalQuality();
+    }
+    return true;
+}
+
+GSMRegistration& GSM::registration()
+{
+    return _registration;
 }
@@ -4,6 +4,10 @@
 #include <Arduino.h>
 
 #include "modem.h"
+#include "GSMClock.h"
+#include "GSMSignal.h"
+#include "GSMRegistration.h"
+#include "GSMRetry.h"
 
 enum NetworkStatus {ERROR, CONNECTING, GSM_READY, GSM_OFF, GPRS_READY, GPRS_OFF};
 
@@ -12,7 +16,7 @@ class GSM {
 public:
     /** Constructor
     */
-    GSM();
+    GSM(ModemClass& modem = MODEM);
 
     /** Start the GSM/GPRS modem, attaching to the GSM network
       @param pin         SIM PIN number (4 digits in a string, example: "1234"). If
@@ -25,7 +29,7 @@ public:
     */
     NetworkStatus init(const char* pin = 0, bool restart = false, bool synchronous = true);
 
-    /** Check network access status
+    /** Check network access status, from the registration reports once init() enabled them
       @return 1 if Alive, 0 if down
    */
     bool isAccessAlive();
@@ -42,25 +46,53 @@ public:
 
     void setTimeout(unsigned long timeout);
 
+    /** Backoff between AT+CPIN? retries, retry budget and circuit breaker for init().
+        Without a policy (the default) the SIM check is retried at once until the timeout.
+    */
+    void setRetryPolicy(GSMRetryPolicy* policy);
+
+    /** UTC and network local time, extrapolated by clock() between syncs
+    */
     unsigned long getTime();
     unsigned long getLocalTime();
     bool setLocalTime(time_t time, uint8_t quarters_from_utc);
+    GSMClock& clock();
 
     void lowPowerMode();
     void noLowPowerMode();
 
+    /** Run the background services (signal sampling), call it from loop()
+    */
+    void poll();
+
+    /** Smoothed signal quality in dBm from signal(). Only the first call, before any
+        sample was taken, sends AT+CSQ
+      @return dBm, 99 if not known
+    */
     int8_t getSignalQuality(unsigned long timeout = 100);
     static const char * signal2String(int8_t signalQuality);
+    const char * signal2String();
+    GSMSignal& signal();
+    /** Wait for registration reports until registered, without polling AT+CREG?
+    */
     bool waitForNetwork(unsigned long timeout, int8_t * signal = NULL);
+    GSMRegistration& registration();
 
     NetworkStatus status();
 
 private:
+    ModemClass* _modem;
     NetworkStatus _state;
     uint8_t _readyState;
     const char* _pin;
     String _response;
     unsigned long _timeout;
+    GSMClock _clock;
+    GSMSignal _signal;
+    GSMRegistration _registration;
+    GSMTimer _requery;
+    GSMRetryPolicy* _retry;
+    uint8_t fail();
 };
 
 #endif
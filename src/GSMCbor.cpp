@@ -0,0 +1,204 @@
+#include "GSMCbor.h"
+
+enum {
+    CBOR_UINT = 0,
+    CBOR_NEGINT = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7
+};
+
+#define CBOR_INDEFINITE 31
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+#define CBOR_FLOAT32 26
+#define CBOR_FLOAT64 27
+#define CBOR_BREAK 0xFF
+
+CborWriter::CborWriter(uint8_t* buf, uint16_t size):
+    _bufferSink(buf, size),
+    _sink(&_bufferSink),
+    _keys(NULL),
+    _len(0),
+    _ok(true)
+{
+}
+
+CborWriter::CborWriter(ByteSink& sink):
+    _bufferSink(NULL, 0),
+    _sink(&sink),
+    _keys(NULL),
+    _len(0),
+    _ok(true)
+{
+}
+
+void CborWriter::setKeys(const CborKeyTable& keys)
+{
+    _keys = &keys;
+}
+
+void CborWriter::put(const uint8_t* data, uint16_t len)
+{
+    if (!_ok) return;
+    if (_sink->write(data, len) != len){
+        _ok = false;
+        return;
+    }
+    _len += len;
+}
+
+void CborWriter::writeHead(uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    uint8_t n;
+    major <<= 5;
+    if (value < 24){
+        head[0] = major | value;
+        n = 1;
+    }
+    else if (value <= 0xFF){
+        head[0] = major | 24;
+        n = 2;
+    }
+    else if (value <= 0xFFFF){
+        head[0] = major | 25;
+        n = 3;
+    }
+    else if (value <= 0xFFFFFFFFUL){
+        head[0] = major | 26;
+        n = 5;
+    }
+    else{
+        head[0] = major | 27;
+        n = 9;
+    }
+    //big endian argument
+    for (uint8_t i = n - 1; i > 0; i--){
+        head[i] = value & 0xFF;
+        value >>= 8;
+    }
+    put(head, n);
+}
+
+void CborWriter::beginArray(uint16_t count)
+{
+    writeHead(CBOR_ARRAY, count);
+}
+
+void CborWriter::beginMap(uint16_t pairs)
+{
+    writeHead(CBOR_MAP, pairs);
+}
+
+void CborWriter::beginArray()
+{
+    uint8_t b = (CBOR_ARRAY << 5) | CBOR_INDEFINITE;
+    put(&b, 1);
+}
+
+void CborWriter::beginMap()
+{
+    uint8_t b = (CBOR_MAP << 5) | CBOR_INDEFINITE;
+    put(&b, 1);
+}
+
+void CborWriter::end()
+{
+    uint8_t b = CBOR_BREAK;
+    put(&b, 1);
+}
+
+void CborWriter::key(uint8_t id)
+{
+    if (_keys == NULL || _keys->integerKeys || id >= _keys->count){
+        writeUint(id);
+    }
+    else{
+        writeString(_keys->names[id]);
+    }
+}
+
+void CborWriter::key(const char* name)
+{
+    writeString(name);
+}
+
+void CborWriter::writeUint(uint64_t value)
+{
+    writeHead(CBOR_UINT, value);
+}
+
+void CborWriter::writeInt(int64_t value)
+{
+    if (value < 0){
+        writeHead(CBOR_NEGINT, (uint64_t)(-1 - value));
+    }
+    else{
+        writeHead(CBOR_UINT, value);
+    }
+}
+
+void CborWriter::writeBool(bool value)
+{
+    uint8_t b = (CBOR_SIMPLE << 5) | (value ? CBOR_TRUE : CBOR_FALSE);
+    put(&b, 1);
+}
+
+void CborWriter::writeNull()
+{
+    uint8_t b = (CBOR_SIMPLE << 5) | CBOR_NULL;
+    put(&b, 1);
+}
+
+void CborWriter::writeFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t b[5] = {(CBOR_SIMPLE << 5) | CBOR_FLOAT32,
+                    (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits};
+    put(b, sizeof(b));
+}
+
+void CborWriter::writeDouble(double value)
+{
+    if (sizeof(double) != sizeof(uint64_t)){
+        writeFloat(value); //AVR doubles are single precision
+        return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t b[9];
+    b[0] = (CBOR_SIMPLE << 5) | CBOR_FLOAT64;
+    for (uint8_t i = 8; i > 0; i--){
+        b[i] = bits & 0xFF;
+        bits >>= 8;
+    }
+    put(b, sizeof(b));
+}
+
+void CborWriter::writeString(const char* str)
+{
+    writeString(str, strlen(str));
+}
+
+void CborWriter::writeString(const char* str, uint16_t len)
+{
+    writeHead(CBOR_TEXT, len);
+    put(reinterpret_cast<const uint8_t*>(str), len);
+}
+
+void CborWriter::writeBytes(const void* data, uint16_t len)
+{
+    writeHead(CBOR_BYTES, len);
+    put(reinterpret_cast<const uint8_t*>(data), len);
+}
+
+void CborWriter::writeTag(uint32_t tag)
+{
+    writeHead(CBOR_TAG, tag);
+}
@@ -0,0 +1,83 @@
+#ifndef _GSM_CBOR_H_INCLUDED
+#define _GSM_CBOR_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "GSMSink.h"
+
+/* Table mapping key ids to names, meant to be a constant so that it lives in flash.
+    With integerKeys the id itself is encoded (1 byte for ids < 24) and the server uses
+    the same table to restore the names, otherwise the name is encoded as a text string.
+*/
+struct CborKeyTable {
+    template <uint8_t N>
+    constexpr CborKeyTable(const char* const (&keyNames)[N], bool useIntegerKeys = true):
+        names(keyNames),
+        count(N),
+        integerKeys(useIntegerKeys)
+    {
+    }
+
+    const char* const* names;
+    uint8_t count;
+    bool integerKeys;
+};
+
+/* CBOR (RFC 8949) encoder writing straight into a caller buffer or a ByteSink, e.g. a
+    GSMSocketSink. Nothing is allocated; once the destination is full every further write
+    is dropped and ok() returns false.
+*/
+class CborWriter {
+
+public:
+    CborWriter(uint8_t* buf, uint16_t size);
+    CborWriter(ByteSink& sink);
+
+    void setKeys(const CborKeyTable& keys);
+
+    //containers of known size, no end() needed
+    void beginArray(uint16_t count);
+    void beginMap(uint16_t pairs);
+    //containers of unknown length, closed with end()
+    void beginArray();
+    void beginMap();
+    void end();
+
+    void key(uint8_t id);
+    void key(const char* name);
+
+    void writeUint(uint64_t value);
+    void writeInt(int64_t value);
+    void writeBool(bool value);
+    void writeNull();
+    void writeFloat(float value);
+    void writeDouble(double value);
+    void writeString(const char* str);
+    void writeString(const char* str, uint16_t len);
+    void writeBytes(const void* data, uint16_t len);
+    void writeTag(uint32_t tag);
+
+    inline bool ok()
+    {
+        return _ok;
+    }
+
+    /** Bytes written so far
+    */
+    inline uint32_t length()
+    {
+        return _len;
+    }
+
+private:
+    void writeHead(uint8_t major, uint64_t value);
+    void put(const uint8_t* data, uint16_t len);
+
+    BufferSink _bufferSink;
+    ByteSink* _sink;
+    const CborKeyTable* _keys;
+    uint32_t _len;
+    bool _ok;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "GSMClock.h"
+
+static const char CLOCK_CTZV[] PROGMEM = "+CTZV:";
+
+//two digits at s, -1 if they are not digits
+static int8_t twoDigits(const char* s)
+{
+    if (s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') return -1;
+    return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+GSMClock::GSMClock(ModemClass& modem):
+    _modem(&modem),
+    _begin(false),
+    _synced(false),
+    _syncUtc(0),
+    _syncMillis(0),
+    _lastAttempt(millis() - CLOCK_RETRY_INTERVAL_MS), //the first now() queries right away
+    _resyncInterval(CLOCK_RESYNC_INTERVAL_MS),
+    _driftPpm(0),
+    _driftUtc(0),
+    _driftMillis(0),
+    _driftStarted(false),
+    _quarters(0)
+{
+}
+
+GSMClock::~GSMClock()
+{
+    end();
+}
+
+bool GSMClock::begin()
+{
+    if (!_begin){
+        _modem->addUrcHandler(this);
+        _begin = true;
+    }
+    _modem->send(F("AT+CTZR=1"));
+    _modem->waitForResponse(); //not every firmware reports network time, sync() still works
+    return sync();
+}
+
+void GSMClock::end()
+{
+    if (_begin){
+        _modem->removeUrcHandler(this);
+        _begin = false;
+    }
+}
+
+bool GSMClock::sync()
+{
+    String response;
+    _lastAttempt = millis();
+
+    _modem->send(F("AT+CCLK?"));
+    if (_modem->waitForResponse(100, &response) != 1){
+        return false;
+    }
+
+    uint32_t utc;
+    int8_t quarters;
+    if (!parse(response.c_str(), utc, quarters)){
+        return false;
+    }
+    apply(utc, quarters);
+    return true;
+}
+
+void GSMClock::invalidate()
+{
+    _synced = false;
+    _driftStarted = false; //the modem clock may have been set
+    _lastAttempt = millis() - CLOCK_RETRY_INTERVAL_MS;
+}
+
+uint32_t GSMClock::now()
+{
+    unsigned long ms = millis();
+    if ((!_synced || ms - _syncMillis >= _resyncInterval) && ms - _lastAttempt >= CLOCK_RETRY_INTERVAL_MS){
+        sync();
+        ms = millis();
+    }
+    if (!_synced){
+        return 0;
+    }
+    return extrapolate(ms);
+}
+
+uint32_t GSMClock::localNow()
+{
+    uint32_t utc = now();
+    if (utc == 0){
+        return 0;
+    }
+    return utc + (int32_t)_quarters * 15 * 60;
+}
+
+void GSMClock::setResyncInterval(unsigned long interval_ms)
+{
+    _resyncInterval = interval_ms;
+}
+
+bool GSMClock::synced()
+{
+    return _synced;
+}
+
+int32_t GSMClock::drift()
+{
+    return _driftPpm;
+}
+
+uint32_t GSMClock::extrapolate(unsigned long at)
+{
+    int64_t elapsed = (unsigned long)(at - _syncMillis);
+    elapsed += elapsed * _driftPpm / 1000000;
+    return _syncUtc + (uint32_t)(elapsed / 1000);
+}
+
+void GSMClock::apply(uint32_t utc, int8_t quarters)
+{
+    unsigned long ms = millis();
+
+    if (!_driftStarted){
+        _driftUtc = utc;
+        _driftMillis = ms;
+        _driftStarted = true;
+    } else if (ms - _driftMillis >= CLOCK_DRIFT_MIN_INTERVAL_MS){
+        //modem time against millis() since the start of the measurement, in ppm
+        unsigned long elapsed = ms - _driftMillis;
+        int64_t errorMs = ((int64_t)utc - (int64_t)_driftUtc) * 1000 - (int64_t)elapsed;
+        int32_t measured = (int32_t)(errorMs * 1000000 / (int64_t)elapsed);
+        _driftPpm = _driftPpm == 0 ? measured : (_driftPpm + measured) / 2;
+        if (_driftPpm > CLOCK_DRIFT_MAX_PPM) _driftPpm = CLOCK_DRIFT_MAX_PPM;
+        else if (_driftPpm < -CLOCK_DRIFT_MAX_PPM) _driftPpm = -CLOCK_DRIFT_MAX_PPM;
+        _driftUtc = utc;
+        _driftMillis = ms;
+    }
+
+    _syncUtc = utc;
+    _syncMillis = ms;
+    _quarters = quarters;
+    _synced = true;
+}
+
+uint32_t GSMClock::epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+    //days since 1970-01-01 of a proleptic Gregorian date
+    if (month <= 2) year--;
+    uint32_t era = year / 400;
+    uint32_t yoe = year - era * 400;
+    uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = era * 146097 + doe - 719468;
+    return days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+bool GSMClock::parse(const char* s, uint32_t& utc, int8_t& quarters)
+{
+    const char* colon = strchr(s, ':');
+    if (colon != NULL && colon - s < 8 && (s[0] == '+' || s[0] == '*')){
+        s = colon + 1; //skip the +CCLK: prefix
+    }
+    while (*s == ' ' || *s == '"') s++;
+
+    //yy/MM/dd,hh:mm:ss
+    if (s[2] != '/' || s[5] != '/' || s[8] != ',' || s[11] != ':' || s[14] != ':'){
+        return false;
+    }
+    int8_t yy = twoDigits(s);
+    int8_t mo = twoDigits(s + 3);
+    int8_t dd = twoDigits(s + 6);
+    int8_t hh = twoDigits(s + 9);
+    int8_t mi = twoDigits(s + 12);
+    int8_t ss = twoDigits(s + 15);
+    if (yy < 0 || mo < 1 || mo > 12 || dd < 1 || dd > 31 || hh < 0 || hh > 23 || mi < 0 || mi > 59 || ss < 0 || ss > 59){
+        return false;
+    }
+
+    //+-zz, quarters of an hour, optionally after a comma
+    quarters = 0;
+    const char* tz = s + 17;
+    if (*tz == ',') tz++;
+    if ((*tz == '+' || *tz == '-') && tz[1] >= '0' && tz[1] <= '9'){
+        quarters = tz[1] - '0';
+        if (tz[2] >= '0' && tz[2] <= '9') quarters = quarters * 10 + tz[2] - '0';
+        if (*tz == '-') quarters = -quarters;
+    }
+
+    utc = epoch(2000 + yy, mo, dd, hh, mi, ss) - (int32_t)quarters * 15 * 60;
+    return true;
+}
+
+void GSMClock::handleUrc(const void* data, uint16_t len)
+{
+    const char* line = reinterpret_cast<const char*>(data);
+    if (strncmp(line, CLOCK_CTZV, strlen(CLOCK_CTZV)) == 0){
+        uint32_t utc;
+        int8_t quarters;
+        if (parse(line, utc, quarters)){
+            apply(utc, quarters);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef _GSM_CLOCK_H_INCLUDED
+#define _GSM_CLOCK_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+#define CLOCK_RESYNC_INTERVAL_MS (6UL * 3600 * 1000)
+#define CLOCK_RETRY_INTERVAL_MS (60UL * 1000)     //after a failed sync
+#define CLOCK_DRIFT_MIN_INTERVAL_MS (24UL * 3600 * 1000) //CCLK has 1 s resolution, ~12 ppm over a day
+#define CLOCK_DRIFT_MAX_PPM 500
+
+/* Time service: syncs from AT+CCLK? (or +CTZV network time reports) and extrapolates
+    from millis() in between, correcting the drift of the local oscillator measured
+    across syncs. Reading the time is plain arithmetic, AT traffic only happens on the
+    periodic resync. The drift is measured over CLOCK_DRIFT_MIN_INTERVAL_MS at least,
+    spanning several resyncs, so that the 1 s resolution of the readings stays well
+    below the crystal drift it corrects.
+*/
+class GSMClock : public ModemUrcHandler {
+
+public:
+    GSMClock(ModemClass& modem = MODEM);
+    virtual ~GSMClock();
+
+    /** Enable network time reports (AT+CTZR=1) and sync
+    */
+    bool begin();
+    void end();
+
+    /** Read the modem clock now
+    */
+    bool sync();
+
+    /** Force a sync on the next read, e.g. after setting the modem clock
+    */
+    void invalidate();
+
+    /** UTC seconds since 1970, 0 if the clock could not be synced
+    */
+    uint32_t now();
+    /** Local time of the network, seconds since 1970
+    */
+    uint32_t localNow();
+
+    void setResyncInterval(unsigned long interval_ms);
+    bool synced();
+    int32_t drift(); //ppm, positive if millis() runs slow
+
+    /** Seconds since 1970 of a UTC date, for years 2000 onwards
+    */
+    static uint32_t epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+    /** Parse "yy/MM/dd,hh:mm:ss[+-zz]", optionally quoted and preceded by a +XXXX: prefix
+      @param utc      UTC seconds since 1970
+      @param quarters time zone in quarters of an hour
+    */
+    static bool parse(const char* s, uint32_t& utc, int8_t& quarters);
+
+    void handleUrc(const void* data, uint16_t len);
+
+private:
+    ModemClass* _modem;
+    void apply(uint32_t utc, int8_t quarters);
+    uint32_t extrapolate(unsigned long at);
+
+    bool _begin;
+    bool _synced;
+    uint32_t _syncUtc;
+    unsigned long _syncMillis;
+    unsigned long _lastAttempt;
+    unsigned long _resyncInterval;
+    int32_t _driftPpm;
+    uint32_t _driftUtc;         //start of the current drift measurement
+    unsigned long _driftMillis;
+    bool _driftStarted;
+    int8_t _quarters;
+};
+
+#endif
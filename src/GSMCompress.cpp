@@ -0,0 +1,229 @@
+#include "GSMCompress.h"
+
+LzEncoder::LzEncoder():
+    _sink(NULL),
+    _pos(0),
+    _end(0),
+    _bits(0),
+    _bitCount(0),
+    _outLen(0),
+    _ok(false),
+    _in(0),
+    _out(0)
+{
+}
+
+void LzEncoder::begin(ByteSink& sink)
+{
+    _sink = &sink;
+    _pos = 0;
+    _end = 0;
+    _bits = 0;
+    _bitCount = 0;
+    _outLen = 0;
+    _ok = true;
+    _in = 0;
+    _out = 0;
+}
+
+bool LzEncoder::write(const void* data, uint16_t len)
+{
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+    while (len > 0){
+        uint16_t n = sizeof(_buf) - _end;
+        if (n > len) n = len;
+        memcpy(_buf + _end, in, n);
+        _end += n;
+        _in += n;
+        in += n;
+        len -= n;
+
+        encode(false);
+
+        if (_end == sizeof(_buf)){
+            //slide the window, keeping LZ_WINDOW bytes of history
+            memmove(_buf, _buf + LZ_WINDOW, _end - LZ_WINDOW);
+            _pos -= LZ_WINDOW;
+            _end -= LZ_WINDOW;
+        }
+    }
+    return _ok;
+}
+
+bool LzEncoder::finish()
+{
+    encode(true);
+    if (_bitCount > 0){
+        putBits(0, 8 - _bitCount);
+    }
+    flushOut();
+    return _ok;
+}
+
+void LzEncoder::encode(bool flush)
+{
+    //without flush keep a full lookahead, so that matches are not cut short
+    while (_pos < _end && (flush || _end - _pos >= LZ_MAX_MATCH)){
+        uint16_t maxLen = _end - _pos;
+        if (maxLen > LZ_MAX_MATCH) maxLen = LZ_MAX_MATCH;
+
+        uint16_t bestLen = 0;
+        uint16_t bestOffset = 0;
+        uint16_t first = _pos > LZ_WINDOW ? _pos - LZ_WINDOW : 0;
+        for (uint16_t cand = _pos; cand-- > first;){
+            if (_buf[cand] != _buf[_pos]) continue;
+            uint16_t l = 1;
+            while (l < maxLen && _buf[cand + l] == _buf[_pos + l]) l++;
+            if (l > bestLen){
+                bestLen = l;
+                bestOffset = _pos - cand;
+                if (l == maxLen) break;
+            }
+        }
+
+        if (bestLen >= LZ_MIN_MATCH){
+            putBits(0, 1);
+            putBits(bestOffset - 1, LZ_WINDOW_BITS);
+            putBits(bestLen - LZ_MIN_MATCH, LZ_LOOKAHEAD_BITS);
+            _pos += bestLen;
+        }
+        else{
+            putBits(0x100 | _buf[_pos], 9);
+            _pos++;
+        }
+    }
+}
+
+void LzEncoder::putBits(uint16_t value, uint8_t count)
+{
+    _bits = (_bits << count) | value;
+    _bitCount += count;
+    while (_bitCount >= 8){
+        _bitCount -= 8;
+        _outBuf[_outLen++] = _bits >> _bitCount;
+        if (_outLen == sizeof(_outBuf)) flushOut();
+    }
+}
+
+void LzEncoder::flushOut()
+{
+    if (_outLen == 0) return;
+    if (_ok && _sink->write(_outBuf, _outLen) != _outLen){
+        _ok = false;
+    }
+    _out += _outLen;
+    _outLen = 0;
+}
+
+uint16_t LzEncoder::frame(const void* in, uint16_t len, uint8_t* out, uint16_t outMax)
+{
+    if (outMax < LZ_FRAME_HEADER_LEN) return 0;
+    out[0] = LZ_FRAME_MAGIC;
+    out[1] = (LZ_WINDOW_BITS << 4) | LZ_LOOKAHEAD_BITS;
+    out[2] = len & 0xFF;
+    out[3] = len >> 8;
+
+    //the payload is only worth keeping if it is smaller than the input
+    uint16_t room = outMax - LZ_FRAME_HEADER_LEN;
+    BufferSink sink(out + LZ_FRAME_HEADER_LEN, room < len ? room : len - 1);
+    begin(sink);
+    if (len > 0 && write(in, len) && finish()){
+        return LZ_FRAME_HEADER_LEN + sink.length();
+    }
+
+    if (room < len) return 0;
+    out[1] = 0;
+    memcpy(out + LZ_FRAME_HEADER_LEN, in, len);
+    return LZ_FRAME_HEADER_LEN + len;
+}
+
+LzDecoder::LzDecoder():
+    _sink(NULL),
+    _wpos(0),
+    _bits(0),
+    _bitCount(0),
+    _remaining(0),
+    _ok(false)
+{
+}
+
+void LzDecoder::begin(ByteSink& sink, uint32_t len)
+{
+    _sink = &sink;
+    _wpos = 0;
+    _bits = 0;
+    _bitCount = 0;
+    _remaining = len;
+    _ok = true;
+}
+
+bool LzDecoder::write(const void* data, uint16_t len)
+{
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+    for (uint16_t i = 0; i < len && _remaining > 0; i++){
+        _bits = (_bits << 8) | in[i];
+        _bitCount += 8;
+
+        for (;;){
+            if (_bitCount < 1 || _remaining == 0) break;
+            if ((_bits >> (_bitCount - 1)) & 1){
+                //literal
+                if (_bitCount < 9) break;
+                _bitCount -= 9;
+                emit(_bits >> _bitCount);
+            }
+            else{
+                if (_bitCount < 1 + LZ_WINDOW_BITS + LZ_LOOKAHEAD_BITS) break;
+                _bitCount -= 1 + LZ_WINDOW_BITS + LZ_LOOKAHEAD_BITS;
+                uint16_t ref = _bits >> _bitCount;
+                uint16_t offset = ((ref >> LZ_LOOKAHEAD_BITS) & (LZ_WINDOW - 1)) + 1;
+                uint16_t count = (ref & ((1 << LZ_LOOKAHEAD_BITS) - 1)) + LZ_MIN_MATCH;
+                if (offset > _wpos){
+                    _ok = false; //reference before the start of the stream
+                    return false;
+                }
+                while (count-- > 0 && _remaining > 0){
+                    emit(_window[(_wpos - offset) & (LZ_WINDOW - 1)]);
+                }
+            }
+        }
+    }
+    return _ok;
+}
+
+void LzDecoder::emit(uint8_t c)
+{
+    _window[_wpos & (LZ_WINDOW - 1)] = c;
+    //_wpos saturates above the window size, it is only needed to validate offsets
+    _wpos = _wpos < LZ_WINDOW ? _wpos + 1 : LZ_WINDOW + ((_wpos + 1) & (LZ_WINDOW - 1));
+    _remaining--;
+    if (_ok && _sink->write(&c, 1) != 1){
+        _ok = false;
+    }
+}
+
+int32_t LzDecoder::unframe(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t outMax, uint16_t* frameLen)
+{
+    if (len < LZ_FRAME_HEADER_LEN || in[0] != LZ_FRAME_MAGIC) return -1;
+    uint16_t decodedLen = in[2] | (in[3] << 8);
+    if (decodedLen > outMax) return -1;
+
+    if (in[1] == 0){
+        if (len < LZ_FRAME_HEADER_LEN + decodedLen) return -1;
+        memcpy(out, in + LZ_FRAME_HEADER_LEN, decodedLen);
+        if (frameLen != NULL) *frameLen = LZ_FRAME_HEADER_LEN + decodedLen;
+        return decodedLen;
+    }
+    if (in[1] != ((LZ_WINDOW_BITS << 4) | LZ_LOOKAHEAD_BITS)) return -1;
+
+    BufferSink sink(out, outMax);
+    begin(sink, decodedLen);
+    uint16_t used = LZ_FRAME_HEADER_LEN;
+    while (used < len && !done()){
+        if (!write(in + used, 1)) return -1;
+        used++;
+    }
+    if (!done()) return -1;
+    if (frameLen != NULL) *frameLen = used;
+    return decodedLen;
+}
@@ -0,0 +1,111 @@
+#ifndef _GSM_COMPRESS_H_INCLUDED
+#define _GSM_COMPRESS_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "GSMSink.h"
+
+/* Small-window LZSS codec (heatshrink style) with fixed RAM usage.
+
+    The bitstream is MSB first: a 1 tag bit followed by 8 bits is a literal, a 0 tag bit
+    followed by LZ_WINDOW_BITS bits of (offset - 1) and LZ_LOOKAHEAD_BITS bits of
+    (length - LZ_MIN_MATCH) is a back reference into the last LZ_WINDOW decoded bytes.
+
+    Frames (see LzEncoder::frame) are self contained, so a server can decompress each one
+    independently: magic (1 byte), params (1 byte, window bits << 4 | lookahead bits, 0 for
+    stored data), decoded length (2 bytes LE), payload.
+*/
+
+#define LZ_WINDOW_BITS 8
+#define LZ_LOOKAHEAD_BITS 4
+#define LZ_WINDOW (1 << LZ_WINDOW_BITS)
+#define LZ_MIN_MATCH 2
+#define LZ_MAX_MATCH ((1 << LZ_LOOKAHEAD_BITS) + LZ_MIN_MATCH - 1)
+
+#define LZ_FRAME_MAGIC 0x5A
+#define LZ_FRAME_HEADER_LEN 4
+#define LZ_BATCH_MAX 512 //input bytes per frame when compressing socket sends
+#define LZ_FRAME_MAX (LZ_FRAME_HEADER_LEN + LZ_BATCH_MAX)
+
+class LzEncoder {
+
+public:
+    LzEncoder();
+
+    void begin(ByteSink& sink);
+    /** Compress data into the sink
+      @return false if the sink could not take all of the output
+    */
+    bool write(const void* data, uint16_t len);
+    /** Flush pending input and pad the last byte
+    */
+    bool finish();
+
+    inline uint32_t bytesIn()
+    {
+        return _in;
+    }
+
+    inline uint32_t bytesOut()
+    {
+        return _out;
+    }
+
+    /** Build a frame out of len bytes with this encoder, which is reset first. Data is
+      stored as is when it does not compress.
+      @return frame length, 0 if out is too small
+    */
+    uint16_t frame(const void* in, uint16_t len, uint8_t* out, uint16_t outMax);
+
+private:
+    void encode(bool flush);
+    void putBits(uint16_t value, uint8_t count);
+    void flushOut();
+
+    ByteSink* _sink;
+    uint8_t _buf[2 * LZ_WINDOW];
+    uint16_t _pos;
+    uint16_t _end;
+    uint32_t _bits;
+    uint8_t _bitCount;
+    uint8_t _outBuf[16];
+    uint8_t _outLen;
+    bool _ok;
+    uint32_t _in;
+    uint32_t _out;
+};
+
+class LzDecoder {
+
+public:
+    LzDecoder();
+
+    /** Start decoding a stream that expands to len bytes
+    */
+    void begin(ByteSink& sink, uint32_t len);
+    bool write(const void* data, uint16_t len);
+
+    inline bool done()
+    {
+        return _remaining == 0;
+    }
+
+    /** Decode a frame built by LzEncoder::frame with this decoder, which is reset first
+      @param frameLen set to the number of bytes of in used by the frame
+      @return decoded length, -1 if the frame is malformed or out is too small
+    */
+    int32_t unframe(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t outMax, uint16_t* frameLen = NULL);
+
+private:
+    void emit(uint8_t c);
+
+    ByteSink* _sink;
+    uint8_t _window[LZ_WINDOW];
+    uint16_t _wpos;
+    uint32_t _bits;
+    uint8_t _bitCount;
+    uint32_t _remaining;
+    bool _ok;
+};
+
+#endif
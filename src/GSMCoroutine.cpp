@@ -0,0 +1,367 @@
+#include "GSMCoroutine.h"
+
+#ifdef GSM_COROUTINES
+
+ModemTask::ModemTask(std::coroutine_handle<promise_type> handle):
+    _handle(handle)
+{
+}
+
+ModemTask::ModemTask(ModemTask&& other):
+    _handle(other._handle)
+{
+    other._handle = NULL;
+}
+
+ModemTask::~ModemTask()
+{
+    if (_handle) {
+        _handle.destroy();
+    }
+}
+
+bool ModemTask::done()
+{
+    return !_handle || _handle.done();
+}
+
+int ModemTask::result()
+{
+    return _handle ? _handle.promise()._result : 0;
+}
+
+bool ModemTask::await_ready()
+{
+    return done();
+}
+
+std::coroutine_handle<> ModemTask::await_suspend(std::coroutine_handle<> caller)
+{
+    _handle.promise()._continuation = caller;
+    return _handle;
+}
+
+int ModemTask::await_resume()
+{
+    return result();
+}
+
+ModemWait::ModemWait(ModemScheduler& scheduler, Condition condition, void* arg, unsigned long timeout):
+    _scheduler(&scheduler),
+    _condition(condition),
+    _arg(arg),
+    _timeout(timeout),
+    _met(false),
+    _next(NULL)
+{
+}
+
+bool ModemWait::await_ready()
+{
+    _met = _condition != NULL && _condition(_arg);
+    return _met;
+}
+
+void ModemWait::await_suspend(std::coroutine_handle<> handle)
+{
+    _handle = handle;
+    if (_timeout != WAIT_FOREVER) {
+        _scheduler->_modem->timers().arm(_deadline, _timeout);
+    }
+    _scheduler->wait(this);
+}
+
+bool ModemWait::await_resume()
+{
+    return _met;
+}
+
+ModemScheduler::ModemScheduler(ModemClass& modem):
+    _modem(&modem),
+    _locked(false),
+    _waiting(NULL),
+    _last(NULL)
+{
+}
+
+void ModemScheduler::spawn(ModemTask& task)
+{
+    if (!task.done()) {
+        task._handle.resume();
+    }
+}
+
+void ModemScheduler::wait(ModemWait* wait)
+{
+    wait->_next = NULL;
+    if (_last != NULL) {
+        _last->_next = wait;
+    } else {
+        _waiting = wait;
+    }
+    _last = wait;
+}
+
+void ModemScheduler::poll()
+{
+    _modem->poll();
+
+    //tasks resumed here may suspend again: they queue behind the ones still waiting
+    ModemWait* wait = _waiting;
+    ModemWait* kept = NULL;
+    ModemWait* keptLast = NULL;
+    _waiting = NULL;
+    _last = NULL;
+    while (wait != NULL) {
+        ModemWait* next = wait->_next;
+        wait->_met = wait->_condition != NULL && wait->_condition(wait->_arg);
+        if (wait->_met || wait->_deadline.expired()) {
+            wait->_deadline.cancel();
+            wait->_handle.resume();
+        } else {
+            wait->_next = NULL;
+            if (keptLast != NULL) {
+                keptLast->_next = wait;
+            } else {
+                kept = wait;
+            }
+            keptLast = wait;
+        }
+        wait = next;
+    }
+    if (kept != NULL) {
+        keptLast->_next = _waiting;
+        if (_waiting == NULL) {
+            _last = keptLast;
+        }
+        _waiting = kept;
+    }
+}
+
+bool ModemScheduler::idle()
+{
+    return _waiting == NULL;
+}
+
+ModemWait ModemScheduler::sleep(unsigned long ms)
+{
+    return ModemWait(*this, NULL, NULL, ms);
+}
+
+ModemWait ModemScheduler::until(ModemWait::Condition condition, void* arg, unsigned long timeout)
+{
+    return ModemWait(*this, condition, arg, timeout);
+}
+
+ModemScheduler::Claim::Claim(ModemPriority priority):
+    ModemDispatchEntry(priority),
+    granted(false)
+{
+}
+
+bool ModemScheduler::acquire(Claim& claim)
+{
+    //queued claims go first even if the channel is free right now
+    if (!_locked && _queue.empty()) {
+        _queue.dispatched(claim.priority());
+        _locked = true;
+        return true;
+    }
+    _queue.push(claim);
+    return false;
+}
+
+void ModemScheduler::release()
+{
+    //command boundary: hand the channel to the best queued claim, resumed by poll()
+    Claim* claim = static_cast<Claim*>(_queue.pop());
+    if (claim != NULL) {
+        claim->granted = true;
+    } else {
+        _locked = false;
+    }
+}
+
+bool ModemScheduler::granted(void* arg)
+{
+    return static_cast<Claim*>(arg)->granted;
+}
+
+ModemQueueStats ModemScheduler::queueStats(ModemPriority priority)
+{
+    return _queue.stats(priority);
+}
+
+void ModemScheduler::resetQueueStats()
+{
+    _queue.resetStats();
+}
+
+bool ModemScheduler::answered(void* arg)
+{
+    return static_cast<ModemScheduler*>(arg)->_modem->ready() != 0;
+}
+
+bool ModemScheduler::gsmReady(void* arg)
+{
+    return static_cast<GSM*>(arg)->ready() != 0;
+}
+
+bool ModemScheduler::gprsReady(void* arg)
+{
+    return static_cast<GPRS*>(arg)->ready() != 0;
+}
+
+bool ModemScheduler::buffered(void* arg)
+{
+    Read* read = static_cast<Read*>(arg);
+    return read->gprs->available(read->mux) >= read->len;
+}
+
+ModemTask ModemScheduler::reply(unsigned long timeout)
+{
+    //awaited values go through locals, GCC 12 miscompiles co_await in an if condition
+    bool answer = co_await until(answered, this, timeout);
+    if (!answer) {
+        DBG("#DEBUG# response timeout!");
+        _modem->cancel();
+        co_return -1;
+    }
+    co_return _modem->ready();
+}
+
+ModemTask ModemScheduler::command(const char* command, unsigned long timeout, String* response, ModemPriority priority)
+{
+    Claim claim(priority == PRIORITY_AUTO ? ModemDispatchQueue::classify(command) : priority);
+    if (!acquire(claim)) {
+        co_await until(granted, &claim);
+    }
+    _modem->send(command);
+    _modem->setResponseDataStorage(response);
+    int result = co_await reply(timeout);
+    release();
+    co_return result;
+}
+
+ModemTask ModemScheduler::init(GSM& gsm, const char* pin, bool restart, unsigned long timeout)
+{
+    Claim claim(PRIORITY_INTERACTIVE);
+    if (!acquire(claim)) {
+        co_await until(granted, &claim);
+    }
+    NetworkStatus status = ERROR;
+    gsm.init(pin, restart, false);
+    bool ready = co_await until(gsmReady, &gsm, timeout);
+    if (ready) {
+        status = gsm.status();
+    }
+    release();
+    co_return status;
+}
+
+ModemTask ModemScheduler::attachGPRS(GPRS& gprs, const char* apn, const char* user_name, const char* password, unsigned long timeout)
+{
+    Claim claim(PRIORITY_INTERACTIVE);
+    if (!acquire(claim)) {
+        co_await until(granted, &claim);
+    }
+    NetworkStatus status = ERROR;
+    gprs.attachGPRS(apn, user_name, password, false);
+    bool ready = co_await until(gprsReady, &gprs, timeout);
+    if (ready) {
+        status = gprs.status();
+    }
+    release();
+    co_return status;
+}
+
+ModemTask ModemScheduler::connect(GPRS& gprs, const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, GPRS::ConnectionStatus* status)
+{
+    if (_modem->_initSocks >= MAX_SOCKETS){
+        if(status != NULL)
+            *status = GPRS::ConnectionStatus::ERROR;
+        co_return 0;
+    }
+
+    //a query would block: names not cached are resolved by the modem
+    IPAddress ip;
+    char addr[16];
+    if (gprs._dnsCache && !ip.fromString(host) && gprs._resolver.lookup(host, ip)){
+        sprintf(addr, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+        host = addr;
+    }
+
+    GSMRetryPolicy* policy = gprs._connectRetry;
+    if (policy != NULL && !policy->begin()){
+        if(status != NULL)
+            *status = GPRS::ConnectionStatus::ERROR;
+        co_return 0;
+    }
+
+    for (;;) {
+        Claim claim(PRIORITY_DATA);
+        if (!acquire(claim)) {
+            co_await until(granted, &claim);
+        }
+        String response;
+        _modem->sendf("AT+CIPSTART=\"TCP\",\"%s\",%s", host, String(port).c_str());
+        _modem->setResponseDataStorage(&response);
+        int result = co_await reply(timeout_s * 1000);
+        release();
+        bool connected = gprs.connected(result, response, mux, status);
+
+        if (policy == NULL) {
+            co_return connected;
+        }
+        if (connected) {
+            policy->success();
+            co_return 1;
+        }
+        if (!policy->failure()) {
+            co_return 0;
+        }
+        co_await sleep(policy->wait()); //backoff without holding the channel
+    }
+}
+
+ModemTask ModemScheduler::send(GPRS& gprs, uint8_t mux, const void* buff, uint16_t len)
+{
+    Claim claim(PRIORITY_DATA);
+    if (!acquire(claim)) {
+        co_await until(granted, &claim);
+    }
+    uint16_t sent = 0;
+    if (gprs._encoder == NULL){
+        if (gprs.sendStart(mux, buff, len)){
+            int result = co_await reply(60 * 1000L);
+            sent = gprs.sendEnd(mux, result, len);
+        }
+    } else {
+        //the frame buffer of gprs is only used while holding the channel
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(buff);
+        while (sent < len){
+            uint16_t chunk = min(len - sent, LZ_BATCH_MAX);
+            uint16_t frameLen = gprs.frame(in + sent, chunk);
+            if (frameLen == 0 || !gprs.sendStart(mux, gprs._frame, frameLen)){
+                break;
+            }
+            int result = co_await reply(60 * 1000L);
+            if (gprs.sendEnd(mux, result, frameLen) != frameLen){
+                break;
+            }
+            sent += chunk;
+        }
+    }
+    release();
+    co_return sent;
+}
+
+ModemTask ModemScheduler::read(GPRS& gprs, uint8_t mux, void* buf, uint16_t len, unsigned long timeout)
+{
+    Read read = {&gprs, mux, len};
+    co_await until(buffered, &read, timeout);
+    uint16_t available = gprs.available(mux);
+    co_return gprs.read(mux, buf, min(len, available), 0);
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef _GSM_COROUTINE_H_INCLUDED
+#define _GSM_COROUTINE_H_INCLUDED
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#define GSM_COROUTINES
+
+#include <coroutine>
+
+#include <Arduino.h>
+
+#include "modem.h"
+#include "GSM.h"
+#include "GPRS.h"
+#include "GSMPriority.h"
+
+#define WAIT_FOREVER 0xFFFFFFFFUL
+
+/* Awaitable modem operations (C++20).
+
+    Each flow is a coroutine returning ModemTask. It suspends on modem events instead of
+    delay() polling, and ModemScheduler::poll(), called from loop(), resumes it once the
+    event happened. Several flows (upload, location, SMS...) interleave on one MCU; AT
+    commands of different flows are serialized, a flow keeps the command channel from
+    the command until its response. A free channel goes to the waiting command of the
+    highest ModemPriority class, see GSMPriority.h; commands sent outside the scheduler,
+    e.g. by GSMSignal::refresh(), bypass it.
+
+        ModemTask upload(ModemScheduler& s, GPRS& gprs)
+        {
+            uint8_t mux;
+            if (!co_await s.connect(gprs, "example.com", 80, &mux, 30, NULL)) co_return 0;
+            co_return co_await s.send(gprs, mux, "GET / HTTP/1.0\r\n\r\n", 18);
+        }
+
+    init() and attachGPRS() drive the same ready() steps as the asynchronous GSM and GPRS
+    calls. Frames are heap allocated, one per running task.
+*/
+
+class ModemTask {
+
+public:
+    struct promise_type {
+        int _result;
+        std::coroutine_handle<> _continuation;
+
+        promise_type(): _result(0) {}
+        ModemTask get_return_object()
+        {
+            return ModemTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct Final {
+            bool await_ready() noexcept { return false; }
+            //back to the awaiting task, if any
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                std::coroutine_handle<> next = handle.promise()._continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        Final final_suspend() noexcept { return {}; }
+        void return_value(int result) { _result = result; }
+        void unhandled_exception() {}
+    };
+
+    ModemTask(ModemTask&& other);
+    ModemTask(const ModemTask&) = delete;
+    ModemTask& operator=(const ModemTask&) = delete;
+    ~ModemTask();
+
+    bool done();
+    int result();
+
+    //co_await task: run it to completion inside the awaiting task
+    bool await_ready();
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller);
+    int await_resume();
+
+private:
+    friend class ModemScheduler;
+    explicit ModemTask(std::coroutine_handle<promise_type> handle);
+    std::coroutine_handle<promise_type> _handle;
+};
+
+class ModemScheduler;
+
+/* Suspends a task until a condition holds or a timeout passed, checked on each poll()
+*/
+class ModemWait {
+
+public:
+    typedef bool (*Condition)(void* arg);
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    /** @return true if the condition holds, false on timeout
+    */
+    bool await_resume();
+
+private:
+    friend class ModemScheduler;
+    ModemWait(ModemScheduler& scheduler, Condition condition, void* arg, unsigned long timeout);
+    ModemScheduler* _scheduler;
+    Condition _condition;
+    void* _arg;
+    unsigned long _timeout;
+    GSMTimer _deadline;
+    bool _met;
+    std::coroutine_handle<> _handle;
+    ModemWait* _next;
+};
+
+class ModemScheduler {
+
+public:
+    ModemScheduler(ModemClass& modem = MODEM);
+
+    /** Start task, it runs up to its first suspension. The task object has to outlive it.
+    */
+    void spawn(ModemTask& task);
+
+    /** Poll the modem and resume the tasks whose event happened, call it from loop()
+    */
+    void poll();
+
+    /** @return true if no task is suspended
+    */
+    bool idle();
+
+    ModemWait sleep(unsigned long ms);
+    ModemWait until(ModemWait::Condition condition, void* arg, unsigned long timeout = WAIT_FOREVER);
+
+    /** One AT command
+      @param priority    class of the command, by default from its prefix
+      @return 1 ok, >1 error, -1 timeout, like ModemClass::waitForResponse()
+    */
+    ModemTask command(const char* command, unsigned long timeout = 100L, String* response = NULL, ModemPriority priority = PRIORITY_AUTO);
+
+    /** GSM::init() and GPRS::attachGPRS()
+      @return NetworkStatus, ERROR on timeout
+    */
+    ModemTask init(GSM& gsm, const char* pin = 0, bool restart = false, unsigned long timeout = WAIT_FOREVER);
+    ModemTask attachGPRS(GPRS& gprs, const char* apn, const char* user_name, const char* password, unsigned long timeout = WAIT_FOREVER);
+
+    /** GPRS::connect(), the name is used as is unless it is in the DNS cache. Follows the
+        connect policy of gprs, backing off without blocking other tasks.
+      @return 1 if connected
+    */
+    ModemTask connect(GPRS& gprs, const char* host, uint16_t port, uint8_t* mux, unsigned long timeout_s, GPRS::ConnectionStatus* status);
+
+    /** @return bytes sent
+    */
+    ModemTask send(GPRS& gprs, uint8_t mux, const void* buff, uint16_t len);
+
+    /** Wait until len bytes are buffered for mux or timeout passed
+      @return bytes read
+    */
+    ModemTask read(GPRS& gprs, uint8_t mux, void* buf, uint16_t len, unsigned long timeout = 1000L);
+
+    /** How long commands of a class waited for the channel
+    */
+    ModemQueueStats queueStats(ModemPriority priority);
+    void resetQueueStats();
+
+private:
+    friend class ModemWait;
+    void wait(ModemWait* wait);
+    ModemTask reply(unsigned long timeout);
+
+    class Claim : public ModemDispatchEntry {
+    public:
+        Claim(ModemPriority priority);
+        bool granted;
+    };
+    bool acquire(Claim& claim);     //true if the channel was free
+    void release();
+
+    struct Read {
+        GPRS* gprs;
+        uint8_t mux;
+        uint16_t len;
+    };
+    static bool granted(void* arg);
+    static bool answered(void* arg);
+    static bool gsmReady(void* arg);
+    static bool gprsReady(void* arg);
+    static bool buffered(void* arg);
+
+    ModemClass* _modem;
+    bool _locked;       //a task owns the command channel
+    ModemDispatchQueue _queue;
+    ModemWait* _waiting;
+    ModemWait* _last;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+#include "GSMEnergy.h"
+
+//typical figures for an A9G module, measure your own board
+static const GSMCurrentModel ENERGY_DEFAULT_MODEL = {
+    2000,       //sleep_uA
+    30000,      //awake_uA
+    25000,      //gnss_uA
+    2000000,    //connect_uAs: ~2 s at 1 A peaks
+    300000,     //send_uAs
+    150000      //kilobyte_uAs
+};
+
+static const char ENERGY_NAME_GSM[] PROGMEM = "GSM";
+static const char ENERGY_NAME_GPRS[] PROGMEM = "GPRS";
+static const char ENERGY_NAME_LOCATION[] PROGMEM = "LOCATION";
+static const char ENERGY_NAME_SMS[] PROGMEM = "SMS";
+
+static const char* const ENERGY_NAMES[SUBSYSTEMS] = {
+    ENERGY_NAME_GSM,
+    ENERGY_NAME_GPRS,
+    ENERGY_NAME_LOCATION,
+    ENERGY_NAME_SMS
+};
+
+//uA * ms to uAh
+static uint32_t toUah(uint64_t uAms)
+{
+    return uAms / 3600000ULL;
+}
+
+GSMEnergy::GSMEnergy(ModemClass& modem):
+    _modem(&modem),
+    _model(ENERGY_DEFAULT_MODEL),
+    _start(millis())
+{
+}
+
+GSMEnergy::GSMEnergy(const GSMCurrentModel& model, ModemClass& modem):
+    _modem(&modem),
+    _model(model),
+    _start(millis())
+{
+}
+
+void GSMEnergy::setModel(const GSMCurrentModel& model)
+{
+    _model = model;
+}
+
+const GSMCurrentModel& GSMEnergy::model()
+{
+    return _model;
+}
+
+void GSMEnergy::reset()
+{
+    _modem->resetUsage();
+    _start = millis();
+}
+
+uint32_t GSMEnergy::charge(ModemSubsystem subsystem)
+{
+    ModemUsage usage = _modem->usage();
+    unsigned long elapsed = millis() - _start;
+    uint64_t uAms = (uint64_t)usage.awakeMillis[subsystem] * _model.awake_uA;
+
+    if (subsystem == SUBSYSTEM_GSM){
+        unsigned long awake = _modem->awakeTime();
+        unsigned long lowPower = elapsed > awake ? elapsed - awake : 0;
+        uAms += (uint64_t)lowPower * _model.sleep_uA;
+        //outside low power mode the modem is awake all the time
+        unsigned long windows = 0;
+        for (uint8_t i = 0; i < SUBSYSTEMS; i++){
+            windows += usage.awakeMillis[i];
+        }
+        if (awake > windows){
+            uAms += (uint64_t)(awake - windows) * _model.awake_uA;
+        }
+    }
+    else if (subsystem == SUBSYSTEM_GPRS){
+        uint64_t bytes = 0;
+        for (uint8_t i = 0; i < MAX_SOCKETS; i++){
+            bytes += usage.socketSent[i] + usage.socketReceived[i];
+        }
+        uint64_t uAs = (uint64_t)usage.connects * _model.connect_uAs + (uint64_t)usage.cipsends * _model.send_uAs
+                       + bytes * _model.kilobyte_uAs / 1024;
+        uAms += uAs * 1000;
+    }
+    else if (subsystem == SUBSYSTEM_LOCATION){
+        uAms += (uint64_t)usage.gnssMillis * _model.gnss_uA;
+    }
+    return toUah(uAms);
+}
+
+uint32_t GSMEnergy::charge()
+{
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < SUBSYSTEMS; i++){
+        total += charge((ModemSubsystem)i);
+    }
+    return total;
+}
+
+uint32_t GSMEnergy::averageCurrent()
+{
+    unsigned long elapsed = millis() - _start;
+    if (elapsed == 0){
+        return 0;
+    }
+    return (uint64_t)charge() * 3600000ULL / elapsed;
+}
+
+void GSMEnergy::print(Print& out)
+{
+    ModemUsage usage = _modem->usage();
+    for (uint8_t i = 0; i < SUBSYSTEMS; i++){
+        out.print(ENERGY_NAMES[i]);
+        out.print(F(": "));
+        out.print(usage.commands[i]);
+        out.print(F(" commands, "));
+        out.print(usage.bytesOut[i]);
+        out.print(F(" B out, "));
+        out.print(usage.bytesIn[i]);
+        out.print(F(" B in, "));
+        out.print(usage.awakeMillis[i]);
+        out.print(F(" ms awake, "));
+        out.print(charge((ModemSubsystem)i));
+        out.println(F(" uAh"));
+    }
+    for (uint8_t i = 0; i < MAX_SOCKETS; i++){
+        if (usage.socketSent[i] == 0 && usage.socketReceived[i] == 0){
+            continue;
+        }
+        out.print(F("socket "));
+        out.print(i);
+        out.print(F(": "));
+        out.print(usage.socketSent[i]);
+        out.print(F(" B sent, "));
+        out.print(usage.socketReceived[i]);
+        out.println(F(" B received"));
+    }
+    out.print(usage.connects);
+    out.print(F(" connects, "));
+    out.print(usage.cipsends);
+    out.print(F(" sends, GNSS on "));
+    out.print(usage.gnssMillis);
+    out.println(F(" ms"));
+    out.print(F("total: "));
+    out.print(charge());
+    out.print(F(" uAh, average "));
+    out.print(averageCurrent());
+    out.println(F(" uA"));
+}
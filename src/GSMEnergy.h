@@ -0,0 +1,58 @@
+#ifndef _GSM_ENERGY_H_INCLUDED
+#define _GSM_ENERGY_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+/* Current draw of the module, to be measured on the actual board. Charges cover the radio
+    activity on top of the awake current, so that airtime is accounted to whoever caused it.
+*/
+struct GSMCurrentModel {
+    uint32_t sleep_uA;          //low power mode
+    uint32_t awake_uA;          //awake, registered, idle
+    uint32_t gnss_uA;           //on top, while the GNSS receiver is on
+    uint32_t connect_uAs;       //per CIPSTART
+    uint32_t send_uAs;          //per CIPSEND
+    uint32_t kilobyte_uAs;      //per KB of TCP payload, either direction
+};
+
+/* Turns the ModemClass usage counters into an estimated charge per subsystem.
+    Time in low power mode is accounted to SUBSYSTEM_GSM, as is the awake time outside
+    low power mode, since the modem is then simply always on.
+*/
+class GSMEnergy {
+
+public:
+    GSMEnergy(ModemClass& modem = MODEM);
+    GSMEnergy(const GSMCurrentModel& model, ModemClass& modem = MODEM);
+
+    void setModel(const GSMCurrentModel& model);
+    const GSMCurrentModel& model();
+
+    /** Restart the counters and the elapsed time
+    */
+    void reset();
+
+    /** Estimated charge since reset()
+      @return uAh
+    */
+    uint32_t charge(ModemSubsystem subsystem);
+    uint32_t charge();
+
+    /** Average current since reset()
+      @return uA
+    */
+    uint32_t averageCurrent();
+
+    /** Counters and charge of every subsystem
+    */
+    void print(Print& out);
+
+private:
+    ModemClass* _modem;
+    GSMCurrentModel _model;
+    unsigned long _start;
+};
+
+#endif
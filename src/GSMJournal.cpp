@@ -0,0 +1,340 @@
+#include "GSMJournal.h"
+
+#define JOURNAL_MAGIC 0xA9
+#define JOURNAL_FLAG_PENDING 0xFF
+#define JOURNAL_FLAG_CONSUMED 0x00
+#define JOURNAL_HEADER_LEN 6
+
+static uint16_t crc16(uint16_t crc, const uint8_t* data, uint16_t len)
+{
+    while (len--){
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++){
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+RamJournalStorage::RamJournalStorage(uint8_t* buf, uint32_t size):
+    _buf(buf),
+    _size(size)
+{
+    erase(); //whatever the buffer held is not a journal, e.g. zero-filled static storage
+}
+
+uint32_t RamJournalStorage::size()
+{
+    return _size;
+}
+
+bool RamJournalStorage::read(uint32_t addr, void* buf, uint16_t len)
+{
+    if (addr + len > _size) return false;
+    memcpy(buf, _buf + addr, len);
+    return true;
+}
+
+bool RamJournalStorage::write(uint32_t addr, const void* buf, uint16_t len)
+{
+    if (addr + len > _size) return false;
+    memcpy(_buf + addr, buf, len);
+    return true;
+}
+
+bool RamJournalStorage::erase()
+{
+    memset(_buf, 0xFF, _size);
+    return true;
+}
+
+#ifndef ARDUINO
+FileJournalStorage::FileJournalStorage(const char* path, uint32_t size):
+    _size(size)
+{
+    _file = fopen(path, "r+b");
+    if (_file == NULL){
+        _file = fopen(path, "w+b");
+        if (_file != NULL) erase();
+    }
+}
+
+FileJournalStorage::~FileJournalStorage()
+{
+    if (_file != NULL) fclose(_file);
+}
+
+uint32_t FileJournalStorage::size()
+{
+    return _size;
+}
+
+bool FileJournalStorage::read(uint32_t addr, void* buf, uint16_t len)
+{
+    if (_file == NULL || addr + len > _size) return false;
+    if (fseek(_file, addr, SEEK_SET) != 0) return false;
+    return fread(buf, 1, len, _file) == len;
+}
+
+bool FileJournalStorage::write(uint32_t addr, const void* buf, uint16_t len)
+{
+    if (_file == NULL || addr + len > _size) return false;
+    if (fseek(_file, addr, SEEK_SET) != 0) return false;
+    if (fwrite(buf, 1, len, _file) != len) return false;
+    return fflush(_file) == 0;
+}
+
+bool FileJournalStorage::erase()
+{
+    if (_file == NULL || fseek(_file, 0, SEEK_SET) != 0) return false;
+    uint8_t ff[64];
+    memset(ff, 0xFF, sizeof(ff));
+    for (uint32_t left = _size; left > 0;){
+        uint16_t n = left > sizeof(ff) ? sizeof(ff) : left;
+        if (fwrite(ff, 1, n, _file) != n) return false;
+        left -= n;
+    }
+    return fflush(_file) == 0;
+}
+#endif
+
+GSMJournal::GSMJournal(JournalStorage& storage):
+    _storage(&storage),
+    _readPos(0),
+    _writePos(0),
+    _pending(0)
+{
+}
+
+bool GSMJournal::begin()
+{
+    uint32_t size = _storage->size();
+    uint32_t pos = 0;
+    bool readFound = false;
+
+    _readPos = 0;
+    _pending = 0;
+
+    while (pos + JOURNAL_HEADER_LEN <= size){
+        uint8_t header[JOURNAL_HEADER_LEN];
+        if (!_storage->read(pos, header, JOURNAL_HEADER_LEN)) return false;
+
+        uint16_t len = header[2] | (header[3] << 8);
+        if (header[0] == 0xFF && len == 0xFFFF){
+            //append() writes the payload first: programmed bytes past an erased header are
+            //the payload of a record whose header never made it
+            uint8_t tail[JOURNAL_RECORD_MAX];
+            uint32_t tailLen = size - pos - JOURNAL_HEADER_LEN;
+            if (tailLen > JOURNAL_RECORD_MAX) tailLen = JOURNAL_RECORD_MAX;
+            if (!_storage->read(pos + JOURNAL_HEADER_LEN, tail, tailLen)) return false;
+            for (uint32_t i = 0; i < tailLen; i++){
+                if (tail[i] != 0xFF){
+                    DBG("#DEBUG# journal append interrupted at ", pos);
+                    seal(pos, readFound);
+                    return true;
+                }
+            }
+            break; //erased area, end of journal
+        }
+
+        //validate the record
+        bool valid = header[0] == JOURNAL_MAGIC && len <= JOURNAL_RECORD_MAX
+                     && pos + JOURNAL_HEADER_LEN + len <= size;
+        if (valid){
+            uint8_t payload[JOURNAL_RECORD_MAX];
+            if (!_storage->read(pos + JOURNAL_HEADER_LEN, payload, len)) return false;
+            uint16_t crc = crc16(crc16(0xFFFF, header + 2, 2), payload, len);
+            valid = crc == (header[4] | (header[5] << 8));
+        }
+        if (!valid){
+            //torn write
+            DBG("#DEBUG# journal corrupted at ", pos);
+            seal(pos, readFound);
+            return true;
+        }
+
+        if (header[1] == JOURNAL_FLAG_PENDING){
+            if (!readFound){
+                _readPos = pos;
+                readFound = true;
+            }
+            _pending++;
+        }
+        pos += JOURNAL_HEADER_LEN + len;
+    }
+
+    _writePos = pos;
+    if (!readFound) _readPos = pos;
+    return true;
+}
+
+void GSMJournal::seal(uint32_t pos, bool readFound)
+{
+    //the tail cannot be rewritten without an erase: no more appends until the pending
+    //records have been consumed
+    _writePos = _storage->size();
+    if (!readFound) _readPos = pos;
+}
+
+bool GSMJournal::append(const void* data, uint16_t len)
+{
+    if (len > JOURNAL_RECORD_MAX || available() < (uint32_t)len + JOURNAL_HEADER_LEN){
+        return false;
+    }
+
+    uint8_t header[JOURNAL_HEADER_LEN];
+    header[0] = JOURNAL_MAGIC;
+    header[1] = JOURNAL_FLAG_PENDING;
+    header[2] = len & 0xFF;
+    header[3] = len >> 8;
+    uint16_t crc = crc16(crc16(0xFFFF, header + 2, 2), reinterpret_cast<const uint8_t*>(data), len);
+    header[4] = crc & 0xFF;
+    header[5] = crc >> 8;
+
+    //payload first, so that a reset in between leaves an erased header behind
+    if (!_storage->write(_writePos + JOURNAL_HEADER_LEN, data, len)) return false;
+    if (!_storage->write(_writePos, header, JOURNAL_HEADER_LEN)) return false;
+
+    _writePos += JOURNAL_HEADER_LEN + len;
+    _pending++;
+    return true;
+}
+
+uint16_t GSMJournal::readAt(uint32_t& cursor, void* buf, uint16_t maxLen)
+{
+    if (cursor < _readPos) cursor = _readPos;
+    if (cursor + JOURNAL_HEADER_LEN > _writePos) return 0;
+
+    uint8_t header[JOURNAL_HEADER_LEN];
+    if (!_storage->read(cursor, header, JOURNAL_HEADER_LEN) || header[0] != JOURNAL_MAGIC){
+        return 0;
+    }
+    uint16_t len = header[2] | (header[3] << 8);
+    if (len > maxLen) return len;
+    if (!_storage->read(cursor + JOURNAL_HEADER_LEN, buf, len)) return 0;
+    cursor += JOURNAL_HEADER_LEN + len;
+    return len;
+}
+
+bool GSMJournal::consumeUntil(uint32_t cursor)
+{
+    const uint8_t consumed = JOURNAL_FLAG_CONSUMED;
+    while (_readPos < cursor && _readPos + JOURNAL_HEADER_LEN <= _writePos){
+        uint8_t header[JOURNAL_HEADER_LEN];
+        if (!_storage->read(_readPos, header, JOURNAL_HEADER_LEN)) return false;
+        if (header[0] != JOURNAL_MAGIC) break;
+        if (!_storage->write(_readPos + 1, &consumed, 1)) return false;
+        _readPos += JOURNAL_HEADER_LEN + (header[2] | (header[3] << 8));
+        if (_pending > 0) _pending--;
+    }
+
+    if (_pending == 0){
+        //everything has been consumed, reclaim the storage
+        return clear();
+    }
+    return true;
+}
+
+bool GSMJournal::clear()
+{
+    if (!_storage->erase()) return false;
+    _readPos = 0;
+    _writePos = 0;
+    _pending = 0;
+    return true;
+}
+
+uint32_t GSMJournal::cursor()
+{
+    return _readPos;
+}
+
+uint16_t GSMJournal::pending()
+{
+    return _pending;
+}
+
+uint32_t GSMJournal::used()
+{
+    return _writePos;
+}
+
+uint32_t GSMJournal::available()
+{
+    return _storage->size() - _writePos;
+}
+
+GSMJournalUploader::GSMJournalUploader(GSMJournal& journal, GPRS& gprs):
+    _journal(&journal),
+    _gprs(&gprs),
+    _host(NULL),
+    _port(0),
+    _connected(false),
+    _mux(0)
+{
+}
+
+void GSMJournalUploader::setServer(const char* host, uint16_t port)
+{
+    _host = host;
+    _port = port;
+}
+
+void GSMJournalUploader::disconnect()
+{
+    if (_connected){
+        if (!_gprs->close(_mux, 1000)){
+            _gprs->release(_mux); //the modem may have dropped it already, free the slot anyway
+        }
+        _connected = false;
+    }
+}
+
+uint16_t GSMJournalUploader::poll()
+{
+    uint16_t uploaded = 0;
+
+    if (_journal->pending() == 0 || _host == NULL){
+        return 0;
+    }
+    if (_gprs->status() != GPRS_READY){
+        if (_connected){
+            _gprs->release(_mux); //the socket is gone along with the PDP context
+            _connected = false;
+        }
+        return 0;
+    }
+    if (!_connected){
+        _connected = _gprs->connect(_host, _port, &_mux, 30, NULL);
+        if (!_connected) return 0;
+    }
+
+    while (_journal->pending() > 0){
+        uint32_t cursor = _journal->cursor();
+        uint16_t batchLen = 0;
+        uint16_t records = 0;
+
+        //pack as many records as possible into one CIPSEND
+        while (batchLen + 2 < JOURNAL_BATCH_MAX){
+            uint32_t next = cursor;
+            uint16_t len = _journal->readAt(next, _batch + batchLen + 2, JOURNAL_BATCH_MAX - batchLen - 2);
+            if (len == 0 || next == cursor) break;
+            _batch[batchLen] = len & 0xFF;
+            _batch[batchLen + 1] = len >> 8;
+            batchLen += 2 + len;
+            cursor = next;
+            records++;
+        }
+
+        if (records == 0) break;
+
+        if (_gprs->send(_mux, _batch, batchLen) != batchLen){
+            DBG("#DEBUG# journal upload failed");
+            disconnect();
+            break;
+        }
+        _journal->consumeUntil(cursor);
+        uploaded += records;
+    }
+    return uploaded;
+}
@@ -0,0 +1,134 @@
+#ifndef _GSM_JOURNAL_H_INCLUDED
+#define _GSM_JOURNAL_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "GPRS.h"
+
+#define JOURNAL_RECORD_MAX 256 //largest payload accepted by append()
+#define JOURNAL_BATCH_MAX 512  //bytes sent with a single CIPSEND by the uploader
+
+/* Storage backend of the journal. Implementations only need to behave like a NOR flash:
+    erase() sets the whole area to 0xFF, write() is only ever called on erased bytes, with
+    the single exception of the record flags byte which is cleared from 0xFF to 0x00.
+*/
+class JournalStorage {
+    public:
+    virtual uint32_t size() = 0;
+    virtual bool read(uint32_t addr, void* buf, uint16_t len) = 0;
+    virtual bool write(uint32_t addr, const void* buf, uint16_t len) = 0;
+    virtual bool erase() = 0;
+};
+
+/* Journal kept in a caller supplied RAM buffer; useful as a cache in front of a slow link
+    when no flash is available, data is lost on reset. The constructor erases the buffer.
+*/
+class RamJournalStorage : public JournalStorage {
+    public:
+    RamJournalStorage(uint8_t* buf, uint32_t size);
+    uint32_t size();
+    bool read(uint32_t addr, void* buf, uint16_t len);
+    bool write(uint32_t addr, const void* buf, uint16_t len);
+    bool erase();
+
+    private:
+    uint8_t* _buf;
+    uint32_t _size;
+};
+
+#ifndef ARDUINO
+/* Journal kept in a regular file, for host builds.
+*/
+class FileJournalStorage : public JournalStorage {
+    public:
+    FileJournalStorage(const char* path, uint32_t size);
+    ~FileJournalStorage();
+    uint32_t size();
+    bool read(uint32_t addr, void* buf, uint16_t len);
+    bool write(uint32_t addr, const void* buf, uint16_t len);
+    bool erase();
+
+    private:
+    FILE* _file;
+    uint32_t _size;
+};
+#endif
+
+/* Bounded, append-only record journal.
+
+    Every record is framed as: magic (1 byte), flags (1 byte), payload length (2 bytes LE),
+    CRC-16/CCITT of length and payload (2 bytes LE), payload.
+    Consumed records get their flags byte cleared, so that begin() can recover the read cursor
+    after a reset. When every record has been consumed the storage is erased and reused.
+*/
+class GSMJournal {
+
+public:
+    GSMJournal(JournalStorage& storage);
+
+    /** Scan the storage and recover read and write cursors. A torn record, or the payload
+      of an append interrupted before its header, seals the journal until the pending
+      records have been consumed
+      @return false if the storage could not be read
+    */
+    bool begin();
+
+    /** Append a record
+      @return false if the record does not fit or is larger than JOURNAL_RECORD_MAX
+    */
+    bool append(const void* data, uint16_t len);
+
+    /** Read the record at cursor, advancing cursor past it
+      @param cursor  position of the record, start from cursor()
+      @return length of the record, 0 if there are no more records. If the record is
+              larger than maxLen nothing is copied and cursor is not advanced.
+    */
+    uint16_t readAt(uint32_t& cursor, void* buf, uint16_t maxLen);
+
+    /** Mark every record before cursor as consumed
+    */
+    bool consumeUntil(uint32_t cursor);
+
+    bool clear();
+    uint32_t cursor();
+    uint16_t pending();
+    uint32_t used();
+    uint32_t available();
+
+private:
+    void seal(uint32_t pos, bool readFound);
+
+    JournalStorage* _storage;
+    uint32_t _readPos;
+    uint32_t _writePos;
+    uint16_t _pending;
+};
+
+/* Drains a journal through a TCP socket as soon as GPRS is ready. Records are packed
+    as 2 bytes LE length + payload into batches of up to JOURNAL_BATCH_MAX bytes, and the
+    connection is kept open across batches.
+*/
+class GSMJournalUploader {
+
+public:
+    GSMJournalUploader(GSMJournal& journal, GPRS& gprs);
+
+    void setServer(const char* host, uint16_t port);
+
+    /** Upload pending records if the link is up
+      @return number of records uploaded
+    */
+    uint16_t poll();
+    void disconnect();
+
+private:
+    GSMJournal* _journal;
+    GPRS* _gprs;
+    const char* _host;
+    uint16_t _port;
+    bool _connected;
+    uint8_t _mux;
+    uint8_t _batch[JOURNAL_BATCH_MAX];
+};
+
+#endif
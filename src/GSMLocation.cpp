@@ -1,75 +1,93 @@
 #include "GSMLocation.h"
 
-#define GSM_LOCATION_UPDATE_INTERVAL_MIN 1000*60
-#define GSM_LOCATION_UPDATE_INTERVAL_HOUR 1000*3600
+static const char GPSRD_URC[] PROGMEM = "+GPSRD:";
 
-GSMLocation::GSMLocation() :
-    _commandSent(false),
+GSMLocation::GSMLocation(ModemClass& modem):
+    _modem(&modem),
+    _registration(NULL),
+    _cellReports(false),
     _locationAvailable(false),
+    _on(false),
+    _source(LOCATION_NONE),
     _latitude(0),
     _longitude(0),
     _altitude(0),
-    _on(false),
-    _uncertainty(0)
+    _accuracy(0),
+    _gnssStart(0),
+    _gnssTtff(0),
+    _cellTtff(0),
+    _lastGnssFix(0),
+    _fallbackAfter(0),
+    _lastFallback(0)
 {
-    MODEM.addUrcHandler(this);
+    for (int i = 0; i < CELL_CACHE_SIZE; i++) {
+        _cells[i].valid = false;
+    }
 }
 
 GSMLocation::~GSMLocation()
 {
-    MODEM.removeUrcHandler(this);
+    set(false);
 }
 
-bool GSMLocation::set(bool on)
+bool GSMLocation::set(bool on, uint8_t reportInterval_s)
 {
-    if(!_on && on){
-        MODEM.send("AT+AGPS=1"); //TODO THIS ACTUALLY RESPONDS WITH THREE REPLIES
-        if(MODEM.waitForResponse() == 1){
+    if(on){
+        if(!_on){
+            //AT+AGPS=1 would also download assistance data, answering with three replies;
+            //plain AT+GPS=1 answers with a single OK
+            _modem->send("AT+GPS=1");
+            if(_modem->waitForResponse(10000) != 1){
+                return false;
+            }
+            _modem->addUrcHandler(this);
             _on = true;
-            return true;
+            _gnssStart = millis();
+            _gnssTtff = 0;
         }
+        _modem->sendf("AT+GPSRD=%d", reportInterval_s);
+        return _modem->waitForResponse() == 1;
     }
-    else if(_on && !on){
-        MODEM.send("AT+AGPS=0");
-        if(MODEM.waitForResponse() == 1){
-            _on = false;
-            return true;
-        }
+    else if(_on){
+        _modem->removeUrcHandler(this);
+        _on = false;
+        _modem->send("AT+GPSRD=0");
+        _modem->waitForResponse();
+        _modem->send("AT+GPS=0");
+        return _modem->waitForResponse(1000) == 1;
     }
-    else if( (_on && on) || (!_on && !on) )
-        return true;
-    return false;
+    return true;
 }
 
 bool GSMLocation::available()
 {
-    if (!_commandSent) {
-        _commandSent = true;
-        _locationAvailable = false;
-
-        MODEM.send("AT+LOCATION=2");
-        MODEM.waitForResponse();
-    }
-
-    MODEM.poll();
+    _modem->poll();
 
     if (_locationAvailable) {
-        _commandSent = false;
         _locationAvailable = false;
         return true;
     }
 
+    if (_fallbackAfter) {
+        unsigned long now = millis();
+        unsigned long lastGnss = _source == LOCATION_GNSS ? _lastGnssFix : _gnssStart;
+        if (now - lastGnss >= _fallbackAfter && now - _lastFallback >= _fallbackAfter) {
+            _lastFallback = now;
+            return locateCell();
+        }
+    }
+
     return false;
 }
 
 float GSMLocation::latitude()
 {
-    return _latitude;
+    return _latitude / 1e7;
 }
 
 float GSMLocation::longitude()
 {
-    return _longitude;
+    return _longitude / 1e7;
 }
 
 long GSMLocation::altitude()
@@ -79,16 +97,172 @@ long GSMLocation::altitude()
 
 long GSMLocation::accuracy()
 {
-    return _uncertainty;
+    return _accuracy;
 }
 
-void GSMLocation::handleUrc(const String& urc)
+GSMLocationSource GSMLocation::source()
 {
-    if (urc.startsWith("????")) { //TODO
-        
+    return _source;
+}
 
-        _locationAvailable = true;
+bool GSMLocation::locateCell(unsigned long timeout)
+{
+    unsigned long start = millis();
+    uint16_t lac;
+    uint32_t ci;
+    if (!servingCell(lac, ci)) {
+        return false;
+    }
+
+    CellEntry* entry = NULL;
+    for (int i = 0; i < CELL_CACHE_SIZE; i++) {
+        if (_cells[i].valid && _cells[i].lac == lac && _cells[i].ci == ci) {
+            if ((long)(millis() - _cells[i].expires) < 0) {
+                entry = &_cells[i];
+            } else {
+                _cells[i].valid = false;
+            }
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        String response;
+        _modem->send("AT+LOCATION=1");
+        if (_modem->waitForResponse(timeout, &response) != 1) {
+            return false;
+        }
+        //<lat>,<lon> followed by the result code
+        const char* p = response.c_str();
+        while (*p != '\0' && *p != '-' && (*p < '0' || *p > '9')) p++;
+        const char* comma = strchr(p, ',');
+        if (*p == '\0' || comma == NULL) {
+            return false;
+        }
+
+        //take a free slot, or evict the entry closest to expiry
+        entry = &_cells[0];
+        for (int i = 0; i < CELL_CACHE_SIZE; i++) {
+            if (!_cells[i].valid) {
+                entry = &_cells[i];
+                break;
+            }
+            if ((long)(_cells[i].expires - entry->expires) < 0) {
+                entry = &_cells[i];
+            }
+        }
+        entry->lac = lac;
+        entry->ci = ci;
+        entry->latitude = NmeaParser::parseDecimal(p, 7);
+        entry->longitude = NmeaParser::parseDecimal(comma + 1, 7);
+        entry->expires = millis() + CELL_CACHE_TTL_MS;
+        entry->valid = true;
+    }
+
+    _latitude = entry->latitude;
+    _longitude = entry->longitude;
+    _altitude = 0;
+    _accuracy = GSM_LOCATION_CELL_ACCURACY_M;
+    _source = LOCATION_CELL;
+    _cellTtff = max(millis() - start, 1UL);
+    return true;
+}
+
+void GSMLocation::setRegistration(GSMRegistration* registration)
+{
+    _registration = registration;
+}
+
+bool GSMLocation::servingCell(uint16_t& lac, uint32_t& ci)
+{
+    if (_registration != NULL && _registration->enabled()) {
+        lac = _registration->lac();
+        ci = _registration->ci();
+        return _registration->registered() && ci != 0;
+    }
+
+    //+CREG: 2,<stat>,"<lac>","<ci>" once the location info is enabled
+    String response;
+    if (!_cellReports) {
+        _modem->send("AT+CREG=2");
+        if (_modem->waitForResponse() != 1) {
+            return false;
+        }
+        _cellReports = true;
+    }
+    _modem->send("AT+CREG?");
+    if (_modem->waitForResponse(100, &response) != 1) {
+        return false;
+    }
+    int first = response.indexOf(',');
+    int second = first == -1 ? -1 : response.indexOf(',', first + 1);
+    int third = second == -1 ? -1 : response.indexOf(',', second + 1);
+    if (third == -1) {
+        //not registered, or the modem restarted and forgot AT+CREG=2
+        _cellReports = response.indexOf("+CREG: 2,") != -1;
+        return false;
+    }
+    const char* s = response.c_str();
+    lac = strtoul(s + second + (s[second + 1] == '"' ? 2 : 1), NULL, 16);
+    ci = strtoul(s + third + (s[third + 1] == '"' ? 2 : 1), NULL, 16);
+    return true;
+}
+
+void GSMLocation::setCellFallback(unsigned long after_ms)
+{
+    _fallbackAfter = after_ms;
+}
+
+unsigned long GSMLocation::timeToFirstFix(GSMLocationSource source)
+{
+    if (source == LOCATION_GNSS) {
+        return _gnssTtff;
+    } else if (source == LOCATION_CELL) {
+        return _cellTtff;
+    }
+    return 0;
+}
+
+const NmeaFix& GSMLocation::fix()
+{
+    return _parser.fix();
+}
 
+NmeaParser& GSMLocation::parser()
+{
+    return _parser;
+}
 
+void GSMLocation::handleUrc(const void* data, uint16_t len)
+{
+    //the first sentence of a report is prefixed by +GPSRD:, the others come as plain lines
+    const char* line = reinterpret_cast<const char*>(data);
+    if (strncmp(line, GPSRD_URC, strlen(GPSRD_URC)) == 0) {
+        line += strlen(GPSRD_URC);
+        len -= strlen(GPSRD_URC);
+    }
+    if (len == 0 || line[0] != '$') {
+        return;
+    }
+
+    NmeaSentence sentence = NMEA_NONE;
+    for (uint16_t i = 0; i < len; i++) {
+        NmeaSentence s = _parser.feed(line[i]);
+        if (s != NMEA_NONE) sentence = s;
+    }
+    _parser.feed('\n');
+
+    const NmeaFix& fix = _parser.fix();
+    if ((sentence == NMEA_GGA && fix.quality > 0) || (sentence == NMEA_RMC && fix.valid)) {
+        _locationAvailable = true;
+        _source = LOCATION_GNSS;
+        _latitude = fix.latitude;
+        _longitude = fix.longitude;
+        _altitude = fix.altitude / 100;
+        _accuracy = (long)fix.hdop * GSM_LOCATION_UERE_CM / 10000;
+        _lastGnssFix = millis();
+        if (_gnssTtff == 0) {
+            _gnssTtff = max(_lastGnssFix - _gnssStart, 1UL);
+        }
     }
 }
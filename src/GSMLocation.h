@@ -3,32 +3,101 @@
 
 #include <Arduino.h>
 
-#include "Modem.h"
+#include "modem.h"
+#include "GSMNmea.h"
+#include "GSMRegistration.h"
+
+#define GSM_LOCATION_UERE_CM 500 //user equivalent range error used to turn HDOP into meters
+#define GSM_LOCATION_CELL_ACCURACY_M 1000
+#define CELL_CACHE_SIZE 4
+#define CELL_CACHE_TTL_MS (30UL * 60 * 1000)
+
+enum GSMLocationSource {LOCATION_NONE, LOCATION_GNSS, LOCATION_CELL};
 
 class GSMLocation : public ModemUrcHandler {
 
 public:
-    GSMLocation();
+    GSMLocation(ModemClass& modem = MODEM);
     virtual ~GSMLocation();
 
-    bool set(bool on = true);
+    /** Power the GNSS receiver and subscribe to its NMEA output (AT+GPSRD)
+      @param on               turn on or off
+      @param reportInterval_s seconds between NMEA reports
+    */
+    bool set(bool on = true, uint8_t reportInterval_s = 1);
+
+    /** Check for a new location since the last call. GNSS fixes cost no AT traffic;
+      if a cell fallback is set, a cell based location is reported after the
+      receiver has been without fix for the configured time.
+    */
     bool available();
     float latitude();
     float longitude();
     long altitude();
     long accuracy();
+    GSMLocationSource source();
+
+    /** Locate with AT+LOCATION=1 from the serving cell (GPRS must be attached).
+      Results are cached by cell id for CELL_CACHE_TTL_MS, so repeated calls within the
+      same cell only cost an AT+CREG? round trip, or nothing with setRegistration().
+      @return true if a location is available
+    */
+    bool locateCell(unsigned long timeout = 30000L);
+
+    /** Take the serving cell from registration, kept current by its +CREG reports, instead
+      of asking the modem, e.g. setRegistration(&gsm.registration()). NULL to query again.
+    */
+    void setRegistration(GSMRegistration* registration);
+
+    /** Fall back to locateCell() from available() after after_ms without a GNSS fix,
+      at most once every after_ms. 0 disables the fallback.
+    */
+    void setCellFallback(unsigned long after_ms);
+
+    /** Milliseconds from the request to the first fix: from set(true) for GNSS, duration
+      of the last locateCell() for cells. 0 if there is no fix yet.
+    */
+    unsigned long timeToFirstFix(GSMLocationSource source);
 
-    void handleUrc(const String& urc);
+    /** Last GNSS fix in fixed point
+    */
+    const NmeaFix& fix();
+    NmeaParser& parser();
+
+    void handleUrc(const void* data, uint16_t len);
 
 private:
-    bool _commandSent;
+    ModemClass* _modem;
+    bool servingCell(uint16_t& lac, uint32_t& ci);
+
+    struct CellEntry {
+        uint16_t lac;
+        uint32_t ci;
+        int32_t latitude;
+        int32_t longitude;
+        unsigned long expires;
+        bool valid;
+    };
+
+    GSMRegistration* _registration;
+    bool _cellReports; //AT+CREG=2 sent, +CREG? carries the cell
     bool _locationAvailable;
+    bool _on;
+    NmeaParser _parser;
 
-    float _latitude;
-    float _longitude;
+    GSMLocationSource _source;
+    int32_t _latitude;  //1e-7 degrees
+    int32_t _longitude; //1e-7 degrees
     long _altitude;
-    bool _on;
-    long _uncertainty;
+    long _accuracy;
+
+    unsigned long _gnssStart;
+    unsigned long _gnssTtff;
+    unsigned long _cellTtff;
+    unsigned long _lastGnssFix;
+    unsigned long _fallbackAfter;
+    unsigned long _lastFallback;
+    CellEntry _cells[CELL_CACHE_SIZE];
 };
 
 #endif
@@ -0,0 +1,187 @@
+#include "GSMNmea.h"
+#include "GSMClock.h"
+
+int32_t NmeaParser::parseDecimal(const char* s, uint8_t decimals)
+{
+    bool negative = *s == '-';
+    if (negative) s++;
+
+    int32_t value = 0;
+    while (*s >= '0' && *s <= '9'){
+        value = value * 10 + (*s++ - '0');
+    }
+    if (*s == '.') s++;
+    for (uint8_t i = 0; i < decimals; i++){
+        value *= 10;
+        if (*s >= '0' && *s <= '9') value += *s++ - '0';
+    }
+    return negative ? -value : value;
+}
+
+//ddmm.mmmmm (or dddmm.mmmmm) to 1e-7 degrees
+static int32_t parseCoordinate(const char* s)
+{
+    int32_t minutes = NmeaParser::parseDecimal(s, 5); //ddmm scaled by 1e5
+    int32_t degrees = minutes / 10000000L;
+    minutes -= degrees * 10000000L;
+    return degrees * 10000000L + minutes * 10 / 6;
+}
+
+static int8_t hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+uint32_t NmeaParser::epoch()
+{
+    if (_fix.date == 0) return 0;
+    uint32_t d = _fix.date;
+    uint32_t t = _fix.time;
+    return GSMClock::epoch(2000 + d % 100, (d / 100) % 100, d / 10000, t / 10000, (t / 100) % 100, t % 100);
+}
+
+NmeaParser::NmeaParser():
+    _state(NMEA_STATE_IDLE),
+    _type(NMEA_NONE),
+    _fieldLen(0),
+    _fieldIndex(0),
+    _checksum(0),
+    _received(0),
+    _sentences(0),
+    _errors(0)
+{
+    memset(&_fix, 0, sizeof(_fix));
+    _pending = _fix;
+}
+
+NmeaSentence NmeaParser::feed(char c)
+{
+    if (c == '$'){
+        //a new sentence always restarts the parser
+        _state = NMEA_STATE_DATA;
+        _pending = _fix;
+        _type = NMEA_NONE;
+        _fieldLen = 0;
+        _fieldIndex = 0;
+        _checksum = 0;
+        return NMEA_NONE;
+    }
+
+    switch (_state){
+    case NMEA_STATE_IDLE:
+    default:
+        break;
+
+    case NMEA_STATE_DATA: {
+        if (c == '*'){
+            endField();
+            _state = NMEA_STATE_CHECKSUM_HI;
+        }
+        else if (c == '\r' || c == '\n'){
+            _errors++; //checksum is mandatory
+            _state = NMEA_STATE_IDLE;
+        }
+        else{
+            _checksum ^= c;
+            if (c == ','){
+                endField();
+            }
+            else if (_fieldLen < NMEA_FIELD_MAX){
+                _field[_fieldLen++] = c;
+            }
+        }
+        break;
+    }
+
+    case NMEA_STATE_CHECKSUM_HI: {
+        int8_t v = hexValue(c);
+        if (v < 0){
+            _errors++;
+            _state = NMEA_STATE_IDLE;
+        }
+        else{
+            _received = v << 4;
+            _state = NMEA_STATE_CHECKSUM_LO;
+        }
+        break;
+    }
+
+    case NMEA_STATE_CHECKSUM_LO: {
+        int8_t v = hexValue(c);
+        _state = NMEA_STATE_IDLE;
+        if (v < 0 || (_received | v) != _checksum){
+            _errors++;
+            return NMEA_NONE;
+        }
+        _sentences++;
+        if (_type != NMEA_OTHER){
+            _fix = _pending;
+        }
+        return _type;
+    }
+    }
+    return NMEA_NONE;
+}
+
+void NmeaParser::endField()
+{
+    _field[_fieldLen] = '\0';
+    const char* f = _field;
+    bool empty = _fieldLen == 0;
+    uint8_t index = _fieldIndex++;
+    _fieldLen = 0;
+
+    if (index == 0){
+        //talker (GP, GN, GL, BD...) is ignored, only the sentence formatter matters
+        uint8_t len = strlen(f);
+        const char* formatter = len >= 3 ? f + len - 3 : f;
+        if (strcmp(formatter, "GGA") == 0) _type = NMEA_GGA;
+        else if (strcmp(formatter, "RMC") == 0) _type = NMEA_RMC;
+        else if (strcmp(formatter, "GSA") == 0) _type = NMEA_GSA;
+        else _type = NMEA_OTHER;
+        return;
+    }
+
+    switch (_type){
+    case NMEA_GGA: {
+        switch (index){
+        case 1: _pending.time = parseDecimal(f, 0); break;
+        case 2: _pending.latitude = empty ? 0 : parseCoordinate(f); break;
+        case 3: if (*f == 'S') _pending.latitude = -_pending.latitude; break;
+        case 4: _pending.longitude = empty ? 0 : parseCoordinate(f); break;
+        case 5: if (*f == 'W') _pending.longitude = -_pending.longitude; break;
+        case 6: _pending.quality = parseDecimal(f, 0); break;
+        case 7: _pending.satellites = parseDecimal(f, 0); break;
+        case 8: _pending.hdop = parseDecimal(f, 2); break;
+        case 9: _pending.altitude = parseDecimal(f, 2); break;
+        default: break;
+        }
+        break;
+    }
+    case NMEA_RMC: {
+        switch (index){
+        case 1: _pending.time = parseDecimal(f, 0); break;
+        case 2: _pending.valid = *f == 'A'; break;
+        case 3: if (!empty) _pending.latitude = parseCoordinate(f); break;
+        case 4: if (*f == 'S') _pending.latitude = -_pending.latitude; break;
+        case 5: if (!empty) _pending.longitude = parseCoordinate(f); break;
+        case 6: if (*f == 'W') _pending.longitude = -_pending.longitude; break;
+        case 7: _pending.speed = (int64_t)parseDecimal(f, 2) * 514444L / 1000000L; break; //knots x100 to cm/s, 32 bits overflow above 41 kn
+        case 8: _pending.course = parseDecimal(f, 2); break;
+        case 9: _pending.date = parseDecimal(f, 0); break;
+        default: break;
+        }
+        break;
+    }
+    case NMEA_GSA: {
+        if (index == 2) _pending.fixType = parseDecimal(f, 0);
+        else if (index == 16) _pending.hdop = parseDecimal(f, 2);
+        break;
+    }
+    default:
+        break;
+    }
+}
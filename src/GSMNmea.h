@@ -0,0 +1,86 @@
+#ifndef _GSM_NMEA_H_INCLUDED
+#define _GSM_NMEA_H_INCLUDED
+
+#include <Arduino.h>
+
+#define NMEA_FIELD_MAX 16
+
+enum NmeaSentence {NMEA_NONE, NMEA_GGA, NMEA_RMC, NMEA_GSA, NMEA_OTHER};
+
+/* Navigation data in fixed point.
+*/
+struct NmeaFix {
+    int32_t latitude;   //1e-7 degrees, north positive
+    int32_t longitude;  //1e-7 degrees, east positive
+    int32_t altitude;   //cm above mean sea level
+    uint16_t hdop;      //x100
+    uint16_t speed;     //cm/s
+    uint16_t course;    //x100 degrees from true north
+    uint32_t time;      //hhmmss UTC
+    uint32_t date;      //ddmmyy
+    uint8_t satellites;
+    uint8_t quality;    //GGA fix quality, 0 = no fix
+    uint8_t fixType;    //GSA fix type, 1 = no fix, 2 = 2D, 3 = 3D
+    bool valid;         //RMC status A
+};
+
+/* Incremental NMEA 0183 parser for GGA, RMC and GSA sentences of any talker.
+    Characters are fed one at a time, nothing is buffered but the current field, and
+    the fix is only updated once the sentence checksum has been verified.
+*/
+class NmeaParser {
+
+public:
+    NmeaParser();
+
+    /** Feed one character
+      @return the sentence just completed with a valid checksum, NMEA_NONE otherwise
+    */
+    NmeaSentence feed(char c);
+
+    inline const NmeaFix& fix()
+    {
+        return _fix;
+    }
+
+    /** Parse a decimal number as an integer scaled by 10^decimals, extra digits are truncated
+    */
+    static int32_t parseDecimal(const char* s, uint8_t decimals);
+
+    /** UTC seconds since 1970 of the last fix, 0 if RMC has not reported the date yet
+    */
+    uint32_t epoch();
+
+    inline uint32_t sentences()
+    {
+        return _sentences;
+    }
+
+    inline uint32_t errors()
+    {
+        return _errors;
+    }
+
+private:
+    void endField();
+
+    enum {
+        NMEA_STATE_IDLE,
+        NMEA_STATE_DATA,
+        NMEA_STATE_CHECKSUM_HI,
+        NMEA_STATE_CHECKSUM_LO
+    } _state;
+
+    NmeaFix _fix;
+    NmeaFix _pending;
+    NmeaSentence _type;
+    char _field[NMEA_FIELD_MAX + 1];
+    uint8_t _fieldLen;
+    uint8_t _fieldIndex;
+    uint8_t _checksum;
+    uint8_t _received;
+    uint32_t _sentences;
+    uint32_t _errors;
+};
+
+#endif
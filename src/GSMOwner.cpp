@@ -0,0 +1,259 @@
+#include "GSMOwner.h"
+
+#if !defined(ARDUINO) || defined(GSM_CONCURRENT)
+
+#define OWNER_CHUNK 64 //socket bytes moved per read
+
+ModemRequest::ModemRequest():
+    _handler(NULL),
+    _arg(NULL),
+    _result(0),
+    _submitted(0),
+    _done(true),
+    _next(NULL)
+{
+}
+
+ModemRequest::ModemRequest(Handler handler, void* arg, ModemPriority priority):
+    ModemDispatchEntry(priority),
+    _handler(handler),
+    _arg(arg),
+    _result(0),
+    _submitted(0),
+    _done(true),
+    _next(NULL)
+{
+}
+
+void ModemRequest::set(Handler handler, void* arg)
+{
+    _handler = handler;
+    _arg = arg;
+}
+
+bool ModemRequest::done()
+{
+    return _done.load(std::memory_order_acquire);
+}
+
+bool ModemRequest::wait(unsigned long timeout)
+{
+    for (unsigned long start = millis(); !done();) {
+        if (millis() - start >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+int ModemRequest::result()
+{
+    return _result;
+}
+
+ModemCommand::ModemCommand(const char* command, unsigned long timeout):
+    ModemRequest(execute, this, ModemDispatchQueue::classify(command)),
+    _command(command),
+    _timeout(timeout)
+{
+}
+
+String& ModemCommand::response()
+{
+    return _response;
+}
+
+int ModemCommand::execute(ModemClass& modem, void* arg)
+{
+    ModemCommand* command = static_cast<ModemCommand*>(arg);
+    command->_response = "";
+    modem.send(command->_command);
+    return modem.waitForResponse(command->_timeout, &command->_response);
+}
+
+SpscByteQueue::SpscByteQueue(uint8_t* buf, uint16_t size):
+    _buf(buf),
+    _size(size),
+    _head(0),
+    _tail(0)
+{
+}
+
+uint16_t SpscByteQueue::push(const uint8_t* data, uint16_t len)
+{
+    uint16_t tail = _tail.load(std::memory_order_relaxed);
+    uint16_t head = _head.load(std::memory_order_acquire);
+    uint16_t room = (head + _size - tail - 1) % _size;
+    if (len > room) len = room;
+    for (uint16_t i = 0; i < len; i++) {
+        _buf[(tail + i) % _size] = data[i];
+    }
+    _tail.store((tail + len) % _size, std::memory_order_release);
+    return len;
+}
+
+uint16_t SpscByteQueue::pop(uint8_t* data, uint16_t len)
+{
+    uint16_t head = _head.load(std::memory_order_relaxed);
+    uint16_t tail = _tail.load(std::memory_order_acquire);
+    uint16_t used = (tail + _size - head) % _size;
+    if (len > used) len = used;
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = _buf[(head + i) % _size];
+    }
+    _head.store((head + len) % _size, std::memory_order_release);
+    return len;
+}
+
+uint16_t SpscByteQueue::available()
+{
+    uint16_t head = _head.load(std::memory_order_relaxed);
+    uint16_t tail = _tail.load(std::memory_order_acquire);
+    return (tail + _size - head) % _size;
+}
+
+uint16_t SpscByteQueue::free()
+{
+    uint16_t tail = _tail.load(std::memory_order_relaxed);
+    uint16_t head = _head.load(std::memory_order_acquire);
+    return (head + _size - tail - 1) % _size;
+}
+
+ModemOwner::ModemOwner(ModemClass& modem):
+    _modem(&modem),
+    _tail(&_stub),
+    _head(&_stub),
+    _gprs(NULL)
+{
+    for (uint8_t i = 0; i < MAX_SOCKETS; i++) {
+        _queues[i] = NULL;
+    }
+}
+
+bool ModemOwner::submit(ModemRequest& request)
+{
+    bool idle = true;
+    if (!request._done.compare_exchange_strong(idle, false, std::memory_order_acq_rel)) {
+        return false; //still pending
+    }
+    request._submitted = millis();
+    request._next.store(NULL, std::memory_order_relaxed);
+    ModemRequest* previous = _tail.exchange(&request, std::memory_order_acq_rel);
+    previous->_next.store(&request, std::memory_order_release);
+    return true;
+}
+
+ModemRequest* ModemOwner::pop()
+{
+    ModemRequest* head = _head;
+    ModemRequest* next = head->_next.load(std::memory_order_acquire);
+    if (head == &_stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        _head = next;
+        head = next;
+        next = next->_next.load(std::memory_order_acquire);
+    }
+    if (next != NULL) {
+        _head = next;
+        return head;
+    }
+    if (head != _tail.load(std::memory_order_acquire)) {
+        return NULL; //a producer is between exchange and link, retry on the next run()
+    }
+    //last element: put the stub back behind it so it can be taken
+    _stub._next.store(NULL, std::memory_order_relaxed);
+    ModemRequest* previous = _tail.exchange(&_stub, std::memory_order_acq_rel);
+    previous->_next.store(&_stub, std::memory_order_release);
+    next = head->_next.load(std::memory_order_acquire);
+    if (next != NULL) {
+        _head = next;
+        return head;
+    }
+    return NULL;
+}
+
+ModemQueueStats ModemOwner::queueStats(ModemPriority priority)
+{
+    return _queue.stats(priority);
+}
+
+void ModemOwner::resetQueueStats()
+{
+    _queue.resetStats();
+}
+
+bool ModemOwner::attachSocket(GPRS& gprs, uint8_t mux, SpscByteQueue& queue)
+{
+    if (mux >= MAX_SOCKETS) {
+        return false;
+    }
+    bindSocket(&gprs, mux, &queue);
+    return true;
+}
+
+void ModemOwner::detachSocket(uint8_t mux)
+{
+    if (mux < MAX_SOCKETS) {
+        bindSocket(NULL, mux, NULL);
+    }
+}
+
+void ModemOwner::bindSocket(GPRS* gprs, uint8_t mux, SpscByteQueue* queue)
+{
+    //the socket table is only touched by the owner, like everything else
+    SocketBinding binding = {this, gprs, mux, queue};
+    ModemRequest request(bindSocket, &binding);
+    submit(request);
+    while (!request.wait(1000)) {
+        //request and binding live on this stack, they must not go out of scope pending
+    }
+}
+
+int ModemOwner::bindSocket(ModemClass& modem, void* arg)
+{
+    SocketBinding* binding = reinterpret_cast<SocketBinding*>(arg);
+    if (binding->gprs != NULL) {
+        binding->owner->_gprs = binding->gprs;
+    }
+    binding->owner->_queues[binding->mux] = binding->queue;
+    return 1;
+}
+
+uint16_t ModemOwner::run()
+{
+    uint16_t count = 0;
+    for (;;) {
+        //requests submitted while the last one ran compete with the ones already waiting
+        for (ModemRequest* request = pop(); request != NULL; request = pop()) {
+            _queue.push(*request, request->_submitted);
+        }
+        ModemRequest* request = static_cast<ModemRequest*>(_queue.pop());
+        if (request == NULL) {
+            break;
+        }
+        request->_result = request->_handler != NULL ? request->_handler(*_modem, request->_arg) : 0;
+        request->_done.store(true, std::memory_order_release);
+        count++;
+    }
+
+    _modem->poll();
+
+    for (uint8_t mux = 0; mux < MAX_SOCKETS; mux++) {
+        SpscByteQueue* queue = _queues[mux];
+        if (queue == NULL) {
+            continue;
+        }
+        uint8_t chunk[OWNER_CHUNK];
+        uint16_t len = min(min(_gprs->available(mux), queue->free()), (uint16_t)OWNER_CHUNK);
+        if (len > 0) {
+            len = _gprs->read(mux, chunk, len, 0);
+            queue->push(chunk, len);
+        }
+    }
+    return count;
+}
+
+#endif
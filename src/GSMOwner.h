@@ -0,0 +1,143 @@
+#ifndef _GSM_OWNER_H_INCLUDED
+#define _GSM_OWNER_H_INCLUDED
+
+#if !defined(ARDUINO) || defined(GSM_CONCURRENT)
+
+#include <atomic>
+
+#include <Arduino.h>
+
+#include "modem.h"
+#include "GPRS.h"
+#include "GSMPriority.h"
+
+/* Sharing a modem between tasks or threads.
+
+    ModemClass and everything built on it is single threaded. One task owns the modem and
+    calls ModemOwner::run() in its loop; the others submit ModemRequests, which the owner
+    runs one at a time, and wait on them like futures. Submission is lock-free (intrusive
+    MPSC queue, no allocation). Between two requests the owner runs the pending one of the
+    highest ModemPriority class, see GSMPriority.h; background services only take part
+    when their calls are submitted as requests too. Socket data reaches consumer threads
+    through SpscByteQueues filled by the owner.
+*/
+
+class ModemRequest : public ModemDispatchEntry {
+
+public:
+    /** Runs on the owner task, with exclusive use of modem
+      @return the result handed to the waiting task
+    */
+    typedef int (*Handler)(ModemClass& modem, void* arg);
+
+    ModemRequest();
+    ModemRequest(Handler handler, void* arg, ModemPriority priority = PRIORITY_INTERACTIVE);
+
+    /** Set the work, only while the request is not submitted
+    */
+    void set(Handler handler, void* arg);
+
+    bool done();
+    /** Wait for completion, polling every ms
+      @return false on timeout, the request is still pending then
+    */
+    bool wait(unsigned long timeout);
+    int result();
+
+private:
+    friend class ModemOwner;
+    Handler _handler;
+    void* _arg;
+    int _result;
+    unsigned long _submitted;
+    std::atomic<bool> _done;
+    std::atomic<ModemRequest*> _next;
+};
+
+/* A single AT command, with the result of waitForResponse() and its response. The
+    priority class follows the command prefix.
+*/
+class ModemCommand : public ModemRequest {
+
+public:
+    ModemCommand(const char* command, unsigned long timeout = 100L);
+    String& response();
+
+private:
+    static int execute(ModemClass& modem, void* arg);
+    const char* _command;
+    unsigned long _timeout;
+    String _response;
+};
+
+/* Byte queue with one producer and one consumer thread, over a caller supplied buffer.
+    Holds size - 1 bytes.
+*/
+class SpscByteQueue {
+
+public:
+    SpscByteQueue(uint8_t* buf, uint16_t size);
+    uint16_t push(const uint8_t* data, uint16_t len);  //producer, returns bytes queued
+    uint16_t pop(uint8_t* data, uint16_t len);         //consumer, returns bytes taken
+    uint16_t available();                               //consumer side
+    uint16_t free();                                    //producer side
+
+private:
+    uint8_t* _buf;
+    uint16_t _size;
+    std::atomic<uint16_t> _head; //next to pop
+    std::atomic<uint16_t> _tail; //next to push
+};
+
+class ModemOwner {
+
+public:
+    ModemOwner(ModemClass& modem = MODEM);
+
+    /** Queue request for the owner task, from any task or thread
+      @return false if the request is already pending
+    */
+    bool submit(ModemRequest& request);
+
+    /** Deliver the data of mux to queue from run(); data stays in the socket buffer while
+        the queue is full. From any task but the owner: both block until run() has made
+        the change, so the queue is no longer touched once detachSocket() returns.
+    */
+    bool attachSocket(GPRS& gprs, uint8_t mux, SpscByteQueue& queue);
+    void detachSocket(uint8_t mux);
+
+    /** Owner task only: run the pending requests, poll the modem, fill the socket queues
+      @return number of requests run
+    */
+    uint16_t run();
+
+    /** Owner task only: how long requests of a class waited, from submit() to run
+    */
+    ModemQueueStats queueStats(ModemPriority priority);
+    void resetQueueStats();
+
+private:
+    struct SocketBinding {
+        ModemOwner* owner;
+        GPRS* gprs;
+        uint8_t mux;
+        SpscByteQueue* queue;
+    };
+
+    ModemRequest* pop();
+    void bindSocket(GPRS* gprs, uint8_t mux, SpscByteQueue* queue);
+    static int bindSocket(ModemClass& modem, void* arg);
+
+    ModemClass* _modem;
+    //Vyukov MPSC queue, _stub keeps it non-empty
+    ModemRequest _stub;
+    std::atomic<ModemRequest*> _tail;
+    ModemRequest* _head;
+    ModemDispatchQueue _queue;
+    GPRS* _gprs;
+    SpscByteQueue* _queues[MAX_SOCKETS];
+};
+
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include "GSMPower.h"
+
+GSMPower::GSMPower(ModemClass& modem):
+    _modem(&modem),
+    _count(0),
+    _windows(0)
+{
+}
+
+bool GSMPower::add(GSMPowerCallback callback, void* arg, unsigned long interval_ms)
+{
+    if (_count >= POWER_TASKS_MAX){
+        return false;
+    }
+    Task& task = _tasks[_count++];
+    task.callback = callback;
+    task.arg = arg;
+    task.interval = interval_ms;
+    task.last = millis() - interval_ms; //due on the first poll
+    return true;
+}
+
+void GSMPower::remove(GSMPowerCallback callback, void* arg)
+{
+    for (uint8_t i = 0; i < _count; i++){
+        if (_tasks[i].callback == callback && _tasks[i].arg == arg){
+            _tasks[i] = _tasks[--_count];
+            return;
+        }
+    }
+}
+
+unsigned long GSMPower::nextDue()
+{
+    unsigned long next = (unsigned long)-1;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < _count; i++){
+        unsigned long elapsed = now - _tasks[i].last;
+        unsigned long left = elapsed >= _tasks[i].interval ? 0 : _tasks[i].interval - elapsed;
+        if (left < next) next = left;
+    }
+    return next;
+}
+
+unsigned long GSMPower::nextWakeup()
+{
+    unsigned long task = nextDue();
+    unsigned long timer = _modem->timers().nextExpiry();
+    return task < timer ? task : timer;
+}
+
+uint8_t GSMPower::poll()
+{
+    if (_count == 0 || nextDue() > 0){
+        return 0;
+    }
+    return run(POWER_COALESCE_MS);
+}
+
+uint8_t GSMPower::runAll()
+{
+    return run((unsigned long)-1);
+}
+
+uint8_t GSMPower::run(unsigned long horizon)
+{
+    uint8_t ran = 0;
+    _modem->holdAwake();
+    for (uint8_t i = 0; i < _count; i++){
+        unsigned long elapsed = millis() - _tasks[i].last;
+        if (horizon == (unsigned long)-1 || elapsed + horizon >= _tasks[i].interval){
+            _tasks[i].last = millis();
+            _tasks[i].callback(_tasks[i].arg);
+            ran++;
+        }
+    }
+    _modem->releaseAwake();
+    _windows++;
+    return ran;
+}
+
+uint32_t GSMPower::windows()
+{
+    return _windows;
+}
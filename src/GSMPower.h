@@ -0,0 +1,66 @@
+#ifndef _GSM_POWER_H_INCLUDED
+#define _GSM_POWER_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+#define POWER_TASKS_MAX 6
+#define POWER_COALESCE_MS 2000UL //tasks due this soon run in the current window
+
+typedef void (*GSMPowerCallback)(void* arg);
+
+/* Runs periodic modem work (signal sampling, location polling, uploads...) in shared awake
+    windows: when a task is due, every task due within POWER_COALESCE_MS runs with it while
+    the modem is held awake, so N tasks cost one wake up instead of N.
+    Callbacks should do their work unconditionally (GSMSignal::sample() rather than poll()),
+    scheduling is done here.
+*/
+class GSMPower {
+
+public:
+    GSMPower(ModemClass& modem = MODEM);
+
+    /** Add a task run every interval_ms
+      @return false if POWER_TASKS_MAX tasks are already registered
+    */
+    bool add(GSMPowerCallback callback, void* arg, unsigned long interval_ms);
+    void remove(GSMPowerCallback callback, void* arg);
+
+    /** Run the window if a task is due, call it from loop()
+      @return number of tasks run
+    */
+    uint8_t poll();
+
+    /** Run every task now, in one window
+    */
+    uint8_t runAll();
+
+    /** ms until the next task is due
+    */
+    unsigned long nextDue();
+
+    /** ms the MCU can sleep: until the next task or the next modem timer, whichever
+        comes first
+    */
+    unsigned long nextWakeup();
+
+    uint32_t windows();
+
+private:
+    ModemClass* _modem;
+    struct Task {
+        GSMPowerCallback callback;
+        void* arg;
+        unsigned long interval;
+        unsigned long last;
+    };
+
+    uint8_t run(unsigned long horizon);
+
+    Task _tasks[POWER_TASKS_MAX];
+    uint8_t _count;
+    uint32_t _windows;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "GSMPriority.h"
+
+struct PriorityPrefix {
+    const char* prefix;
+    ModemPriority priority;
+};
+
+static const char PRIORITY_CIPSEND[] PROGMEM = "AT+CIPSEND";
+static const char PRIORITY_CIPSTART[] PROGMEM = "AT+CIPSTART";
+static const char PRIORITY_CIPCLOSE[] PROGMEM = "AT+CIPCLOSE";
+static const char PRIORITY_CSQ[] PROGMEM = "AT+CSQ";
+static const char PRIORITY_CREG[] PROGMEM = "AT+CREG?";
+static const char PRIORITY_CGREG[] PROGMEM = "AT+CGREG?";
+static const char PRIORITY_CCLK[] PROGMEM = "AT+CCLK?";
+static const char PRIORITY_LOCATION[] PROGMEM = "AT+LOCATION";
+static const char PRIORITY_GPSRD[] PROGMEM = "AT+GPSRD";
+static const char PRIORITY_CBC[] PROGMEM = "AT+CBC";
+
+//everything else is interactive
+static const PriorityPrefix PRIORITY_PREFIXES[] = {
+    {PRIORITY_CIPSEND, PRIORITY_DATA},
+    {PRIORITY_CIPSTART, PRIORITY_DATA},
+    {PRIORITY_CIPCLOSE, PRIORITY_DATA},
+    {PRIORITY_CSQ, PRIORITY_BACKGROUND},
+    {PRIORITY_CREG, PRIORITY_BACKGROUND},
+    {PRIORITY_CGREG, PRIORITY_BACKGROUND},
+    {PRIORITY_CCLK, PRIORITY_BACKGROUND},
+    {PRIORITY_LOCATION, PRIORITY_BACKGROUND},
+    {PRIORITY_GPSRD, PRIORITY_BACKGROUND},
+    {PRIORITY_CBC, PRIORITY_BACKGROUND}
+};
+
+unsigned long ModemQueueStats::averageDelay()
+{
+    return commands == 0 ? 0 : totalDelay / commands;
+}
+
+ModemDispatchEntry::ModemDispatchEntry(ModemPriority priority):
+    _priority(priority),
+    _queued(0),
+    _nextEntry(NULL)
+{
+}
+
+ModemPriority ModemDispatchEntry::priority()
+{
+    return _priority;
+}
+
+void ModemDispatchEntry::setPriority(ModemPriority priority)
+{
+    _priority = priority;
+}
+
+ModemDispatchQueue::ModemDispatchQueue():
+    _head(NULL),
+    _tail(NULL)
+{
+    resetStats();
+}
+
+void ModemDispatchQueue::push(ModemDispatchEntry& entry)
+{
+    push(entry, millis());
+}
+
+void ModemDispatchQueue::push(ModemDispatchEntry& entry, unsigned long queued)
+{
+    entry._queued = queued;
+    entry._nextEntry = NULL;
+    if (_tail != NULL){
+        _tail->_nextEntry = &entry;
+    } else {
+        _head = &entry;
+    }
+    _tail = &entry;
+}
+
+ModemDispatchEntry* ModemDispatchQueue::pop()
+{
+    //entries are in arrival order: the first one with the best aged class wins
+    unsigned long now = millis();
+    ModemDispatchEntry* best = NULL;
+    ModemDispatchEntry* bestPrev = NULL;
+    int bestClass = PRIORITY_CLASSES;
+    for (ModemDispatchEntry* prev = NULL, *entry = _head; entry != NULL; prev = entry, entry = entry->_nextEntry){
+        unsigned long promoted = (now - entry->_queued) / PRIORITY_AGING_MS;
+        int effective = promoted >= (unsigned long)entry->_priority ? 0 : entry->_priority - promoted;
+        if (effective < bestClass){
+            best = entry;
+            bestPrev = prev;
+            bestClass = effective;
+        }
+    }
+    if (best == NULL){
+        return NULL;
+    }
+
+    if (bestPrev != NULL){
+        bestPrev->_nextEntry = best->_nextEntry;
+    } else {
+        _head = best->_nextEntry;
+    }
+    if (_tail == best){
+        _tail = bestPrev;
+    }
+    best->_nextEntry = NULL;
+    record(best->_priority, now - best->_queued);
+    return best;
+}
+
+bool ModemDispatchQueue::empty()
+{
+    return _head == NULL;
+}
+
+void ModemDispatchQueue::dispatched(ModemPriority priority)
+{
+    record(priority, 0);
+}
+
+void ModemDispatchQueue::record(ModemPriority priority, unsigned long delay)
+{
+    ModemQueueStats& stats = _stats[priority < PRIORITY_CLASSES ? priority : PRIORITY_INTERACTIVE];
+    stats.commands++;
+    stats.totalDelay += delay;
+    if (delay > stats.maxDelay){
+        stats.maxDelay = delay;
+    }
+}
+
+ModemQueueStats ModemDispatchQueue::stats(ModemPriority priority)
+{
+    return _stats[priority < PRIORITY_CLASSES ? priority : PRIORITY_INTERACTIVE];
+}
+
+void ModemDispatchQueue::resetStats()
+{
+    memset(_stats, 0, sizeof(_stats));
+}
+
+ModemPriority ModemDispatchQueue::classify(const char* command)
+{
+    for (uint8_t i = 0; i < sizeof(PRIORITY_PREFIXES) / sizeof(PRIORITY_PREFIXES[0]); i++){
+        const char* prefix = PRIORITY_PREFIXES[i].prefix;
+        if (strncmp(command, prefix, strlen(prefix)) == 0){
+            return PRIORITY_PREFIXES[i].priority;
+        }
+    }
+    return PRIORITY_INTERACTIVE;
+}
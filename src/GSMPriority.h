@@ -0,0 +1,77 @@
+#ifndef _GSM_PRIORITY_H_INCLUDED
+#define _GSM_PRIORITY_H_INCLUDED
+
+#include <Arduino.h>
+
+#define PRIORITY_CLASSES 3
+#define PRIORITY_AGING_MS 2000UL //a waiting command moves up one class every PRIORITY_AGING_MS
+
+enum ModemPriority {
+    PRIORITY_INTERACTIVE,   //user facing: init, attach, SMS, explicit commands
+    PRIORITY_DATA,          //socket connect, send, close
+    PRIORITY_BACKGROUND,    //housekeeping queries: signal, registration, clock, location
+    PRIORITY_AUTO           //classify() the command
+};
+
+struct ModemQueueStats {
+    uint32_t commands;
+    uint32_t totalDelay;    //ms from queued to dispatched
+    uint32_t maxDelay;
+
+    unsigned long averageDelay();
+};
+
+/* A command waiting for the command channel
+*/
+class ModemDispatchEntry {
+
+public:
+    ModemDispatchEntry(ModemPriority priority = PRIORITY_INTERACTIVE);
+    ModemPriority priority();
+    void setPriority(ModemPriority priority);
+
+private:
+    friend class ModemDispatchQueue;
+    ModemPriority _priority;
+    unsigned long _queued;
+    ModemDispatchEntry* _nextEntry;
+};
+
+/* Picks the next command for the channel when it frees up: highest class first, first
+    come first served within a class. Aging keeps background queries from starving, and
+    the delay each class waited is recorded per class.
+
+    Only ModemScheduler (C++20) and ModemOwner (host, GSM_CONCURRENT) dispatch through
+    it. In the default synchronous build GSMSignal, GSMRegistration, GSMClock and
+    GSMLocation send their queries directly when called, so their class has no effect
+    there: call them when the channel is idle, or submit them through one of the two.
+*/
+class ModemDispatchQueue {
+
+public:
+    ModemDispatchQueue();
+
+    void push(ModemDispatchEntry& entry);
+    void push(ModemDispatchEntry& entry, unsigned long queued); //millis() it was issued
+    /** @return the entry to dispatch now, NULL if empty
+    */
+    ModemDispatchEntry* pop();
+    bool empty();
+
+    /** Count a command dispatched without queueing
+    */
+    void dispatched(ModemPriority priority);
+
+    ModemQueueStats stats(ModemPriority priority);
+    void resetStats();
+
+    static ModemPriority classify(const char* command);
+
+private:
+    void record(ModemPriority priority, unsigned long delay);
+    ModemDispatchEntry* _head;
+    ModemDispatchEntry* _tail;
+    ModemQueueStats _stats[PRIORITY_CLASSES];
+};
+
+#endif
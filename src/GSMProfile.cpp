@@ -0,0 +1,45 @@
+#include "GSMProfile.h"
+
+#define PROFILE_MAGIC 0x50473941UL //"A9GP"
+
+static void putLe32(uint8_t* p, uint32_t v)
+{
+    for (uint8_t i = 0; i < 4; i++){
+        p[i] = v >> (8 * i);
+    }
+}
+
+static uint32_t getLe32(const uint8_t* p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+StorageProfileStore::StorageProfileStore(JournalStorage& storage):
+    _storage(&storage)
+{
+}
+
+bool StorageProfileStore::load(uint32_t& hash)
+{
+    uint8_t record[8];
+    if (_storage->size() < sizeof(record) || !_storage->read(0, record, sizeof(record))){
+        return false;
+    }
+    if (getLe32(record) != PROFILE_MAGIC){
+        return false; //erased or never written
+    }
+    hash = getLe32(record + 4);
+    return true;
+}
+
+bool StorageProfileStore::save(uint32_t hash)
+{
+    uint32_t stored;
+    if (load(stored) && stored == hash){
+        return true; //spare the flash an erase cycle
+    }
+    uint8_t record[8];
+    putLe32(record, PROFILE_MAGIC);
+    putLe32(record + 4, hash);
+    return _storage->erase() && _storage->write(0, record, sizeof(record));
+}
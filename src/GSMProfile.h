@@ -0,0 +1,22 @@
+#ifndef _GSM_PROFILE_H_INCLUDED
+#define _GSM_PROFILE_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+#include "GSMJournal.h"
+
+/* Profile hash kept in a JournalStorage area of its own (flash page, file on the host):
+    magic (4 bytes LE) and hash (4 bytes LE) at address 0.
+*/
+class StorageProfileStore : public ModemProfileStore {
+    public:
+    StorageProfileStore(JournalStorage& storage);
+    bool load(uint32_t& hash);
+    bool save(uint32_t hash);
+
+    private:
+    JournalStorage* _storage;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "GSMRegistration.h"
+
+static const char CREG_PREFIX[] PROGMEM = "+CREG:";
+static const char CGREG_PREFIX[] PROGMEM = "+CGREG:";
+
+GSMRegistration::GSMRegistration(ModemClass& modem):
+    _modem(&modem),
+    _begin(false),
+    _lac(0),
+    _ci(0),
+    _sequence(0),
+    _callback(NULL)
+{
+    _status[REG_CS] = REG_UNKNOWN;
+    _status[REG_PS] = REG_UNKNOWN;
+}
+
+GSMRegistration::~GSMRegistration()
+{
+    end();
+}
+
+bool GSMRegistration::begin()
+{
+    listen();
+    //n=2 also reports the serving cell, GSMLocation relies on it
+    _modem->send("AT+CREG=2");
+    if (_modem->waitForResponse() != 1){
+        return false;
+    }
+    _modem->send("AT+CGREG=1");
+    _modem->waitForResponse(); //only CS tracking is available if the firmware refuses it
+    return refresh();
+}
+
+void GSMRegistration::listen()
+{
+    if (!_begin){
+        _modem->addUrcHandler(this);
+        _begin = true;
+    }
+}
+
+void GSMRegistration::end()
+{
+    if (_begin){
+        _modem->removeUrcHandler(this);
+        _begin = false;
+    }
+}
+
+bool GSMRegistration::enabled()
+{
+    return _begin;
+}
+
+bool GSMRegistration::refresh(unsigned long timeout)
+{
+    String response;
+    _modem->send("AT+CREG?");
+    if (_modem->waitForResponse(timeout, &response) != 1 || !parse(response.c_str())){
+        return false;
+    }
+    _modem->send("AT+CGREG?");
+    if (_modem->waitForResponse(timeout, &response) == 1){
+        parse(response.c_str());
+    }
+    return true;
+}
+
+bool GSMRegistration::parse(const char* line)
+{
+    GSMRegistrationDomain domain;
+    if (strncmp(line, CREG_PREFIX, strlen(CREG_PREFIX)) == 0){
+        domain = REG_CS;
+        line += strlen(CREG_PREFIX);
+    }
+    else if (strncmp(line, CGREG_PREFIX, strlen(CGREG_PREFIX)) == 0){
+        domain = REG_PS;
+        line += strlen(CGREG_PREFIX);
+    }
+    else{
+        return false;
+    }
+
+    //report: <stat>[,"<lac>","<ci>"], query response: <n>,<stat>[,"<lac>","<ci>"]
+    char* end;
+    long first = strtol(line, &end, 10);
+    if (end == line){
+        return false;
+    }
+    long stat = first;
+    const char* cell = NULL;
+    if (*end == ','){
+        const char* next = end + 1;
+        while (*next == ' ') next++;
+        if (*next >= '0' && *next <= '9'){
+            stat = strtol(next, &end, 10);
+            cell = *end == ',' ? end + 1 : NULL;
+        }
+        else{
+            cell = next;
+        }
+    }
+    if (stat < REG_NOT_SEARCHING || stat > REG_ROAMING){
+        return false;
+    }
+
+    if (domain == REG_CS && cell != NULL){
+        if (*cell == '"') cell++;
+        _lac = strtoul(cell, &end, 16);
+        const char* ci = strchr(end, ',');
+        if (ci != NULL){
+            if (*++ci == '"') ci++;
+            _ci = strtoul(ci, NULL, 16);
+        }
+    }
+    update(domain, (GSMRegistrationStatus)stat);
+    return true;
+}
+
+void GSMRegistration::set(GSMRegistrationDomain domain, GSMRegistrationStatus status)
+{
+    update(domain, status);
+}
+
+void GSMRegistration::update(GSMRegistrationDomain domain, GSMRegistrationStatus status)
+{
+    if (_status[domain] == status){
+        return;
+    }
+    _status[domain] = status;
+    if (domain == REG_CS && status != REG_HOME && status != REG_ROAMING){
+        _lac = 0;
+        _ci = 0;
+    }
+    _sequence++;
+    if (_callback != NULL){
+        _callback(domain, status);
+    }
+}
+
+GSMRegistrationStatus GSMRegistration::status(GSMRegistrationDomain domain)
+{
+    return _status[domain];
+}
+
+bool GSMRegistration::registered()
+{
+    return _status[REG_CS] == REG_HOME || _status[REG_CS] == REG_ROAMING;
+}
+
+bool GSMRegistration::attached()
+{
+    return _status[REG_PS] == REG_HOME || _status[REG_PS] == REG_ROAMING;
+}
+
+uint16_t GSMRegistration::lac()
+{
+    return _lac;
+}
+
+uint32_t GSMRegistration::ci()
+{
+    return _ci;
+}
+
+uint16_t GSMRegistration::sequence()
+{
+    return _sequence;
+}
+
+bool GSMRegistration::waitForChange(uint16_t sequence, unsigned long timeout)
+{
+    GSMTimer deadline;
+    for (_modem->timers().arm(deadline, timeout); !deadline.expired();) {
+        _modem->poll();
+        if (_sequence != sequence){
+            return true;
+        }
+    }
+    return false;
+}
+
+void GSMRegistration::setCallback(GSMRegistrationCallback callback)
+{
+    _callback = callback;
+}
+
+void GSMRegistration::handleUrc(const void* data, uint16_t len)
+{
+    parse(reinterpret_cast<const char*>(data));
+}
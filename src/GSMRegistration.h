@@ -0,0 +1,84 @@
+#ifndef _GSM_REGISTRATION_H_INCLUDED
+#define _GSM_REGISTRATION_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+//<stat> of +CREG/+CGREG, 27.007 7.2
+enum GSMRegistrationStatus {
+    REG_NOT_SEARCHING = 0,
+    REG_HOME = 1,
+    REG_SEARCHING = 2,
+    REG_DENIED = 3,
+    REG_UNKNOWN = 4,
+    REG_ROAMING = 5
+};
+
+enum GSMRegistrationDomain {REG_CS, REG_PS}; //+CREG, +CGREG
+
+typedef void (*GSMRegistrationCallback)(GSMRegistrationDomain domain, GSMRegistrationStatus status);
+
+/* Keeps the circuit switched (+CREG) and packet switched (+CGREG) registration state
+    current from unsolicited reports, so reading it costs no AT traffic.
+*/
+class GSMRegistration : public ModemUrcHandler {
+
+public:
+    GSMRegistration(ModemClass& modem = MODEM);
+    virtual ~GSMRegistration();
+
+    /** Enable the unsolicited reports (AT+CREG=2, AT+CGREG=1) and read the current state
+    */
+    bool begin();
+    /** Only listen, for callers enabling the reports themselves like GSM::ready()
+    */
+    void listen();
+    void end();
+    bool enabled();
+
+    /** Query the current state, only needed when a report could have been lost
+    */
+    bool refresh(unsigned long timeout = 100);
+
+    /** Update the state from a +CREG/+CGREG line, either a report or a query response
+      @return true if the line was recognized
+    */
+    bool parse(const char* line);
+
+    /** Set the state known from elsewhere, e.g. ModemClass::probe()
+    */
+    void set(GSMRegistrationDomain domain, GSMRegistrationStatus status);
+
+    GSMRegistrationStatus status(GSMRegistrationDomain domain = REG_CS);
+    bool registered();  //home or roaming on the CS domain
+    bool attached();    //home or roaming on the PS domain
+    uint16_t lac();
+    uint32_t ci();      //0 when unknown
+
+    /** Incremented on every state change, pass it to waitForChange()
+    */
+    uint16_t sequence();
+
+    /** Poll the modem until the state changes after sequence
+      @return true if it changed, false on timeout
+    */
+    bool waitForChange(uint16_t sequence, unsigned long timeout);
+
+    void setCallback(GSMRegistrationCallback callback);
+
+    void handleUrc(const void* data, uint16_t len);
+
+private:
+    ModemClass* _modem;
+    void update(GSMRegistrationDomain domain, GSMRegistrationStatus status);
+
+    bool _begin;
+    GSMRegistrationStatus _status[2];
+    uint16_t _lac;
+    uint32_t _ci;
+    uint16_t _sequence;
+    GSMRegistrationCallback _callback;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "GSMResolver.h"
+#include "GSMTrace.h"
+
+static const char DNS_RESULT[] PROGMEM = "+CDNSGIP:";
+
+GSMResolver::GSMResolver(ModemClass& modem):
+    _modem(&modem),
+    _ttl(DNS_DEFAULT_TTL_MS),
+    _urcResult(-1)
+{
+    clear();
+}
+
+bool GSMResolver::resolve(const char* host, IPAddress& ip, unsigned long timeout)
+{
+    if (lookup(host, ip)){
+        return true;
+    }
+    return query(host, ip, timeout);
+}
+
+bool GSMResolver::lookup(const char* host, IPAddress& ip)
+{
+    Entry* entry = find(host);
+    if (entry == NULL){
+        return false;
+    }
+    if ((long)(millis() - entry->expires) >= 0){
+        entry->valid = false; //expired
+        return false;
+    }
+    ip = entry->ip;
+    return true;
+}
+
+bool GSMResolver::query(const char* host, IPAddress& ip, unsigned long timeout)
+{
+    String response;
+    GSMTimer deadline;
+    _modem->timers().arm(deadline, timeout);
+
+    //some firmwares answer before OK, others with an URC after it
+    _urcResult = -1;
+    TRACE(TRACE_DNS, 0);
+    _modem->addUrcHandler(this);
+    _modem->sendf("AT+CDNSGIP=\"%s\"", host);
+    int8_t result = -1;
+    if (_modem->waitForResponse(timeout, &response) == 1){
+        result = parse(response.c_str(), ip);
+        while (result == -1 && !deadline.expired()){
+            _modem->poll();
+            if (_urcResult != -1){
+                result = _urcResult;
+                ip = _urcIp;
+            }
+        }
+    }
+    _modem->removeUrcHandler(this);
+    TRACE(TRACE_DNS, result == 1 ? 1 : 2);
+
+    if (result != 1){
+        DBG("#DEBUG# DNS query failed for ", host);
+        return false;
+    }
+    store(host, ip);
+    return true;
+}
+
+void GSMResolver::invalidate(const char* host)
+{
+    Entry* entry = find(host);
+    if (entry != NULL){
+        entry->valid = false;
+    }
+}
+
+void GSMResolver::clear()
+{
+    for (int i = 0; i < DNS_CACHE_SIZE; i++){
+        _cache[i].valid = false;
+    }
+}
+
+void GSMResolver::setTtl(unsigned long ttl_ms)
+{
+    _ttl = ttl_ms;
+}
+
+void GSMResolver::handleUrc(const void* data, uint16_t len)
+{
+    const char* line = reinterpret_cast<const char*>(data);
+    if (strncmp(line, DNS_RESULT, strlen(DNS_RESULT)) == 0){
+        _urcResult = parse(line, _urcIp);
+    }
+}
+
+GSMResolver::Entry* GSMResolver::find(const char* host)
+{
+    for (int i = 0; i < DNS_CACHE_SIZE; i++){
+        if (_cache[i].valid && strcmp(_cache[i].host, host) == 0){
+            return &_cache[i];
+        }
+    }
+    return NULL;
+}
+
+void GSMResolver::store(const char* host, const IPAddress& ip)
+{
+    if (strlen(host) >= DNS_HOST_MAX) return;
+
+    Entry* entry = find(host);
+    if (entry == NULL){
+        //take a free slot, or evict the entry closest to expiry
+        entry = &_cache[0];
+        for (int i = 0; i < DNS_CACHE_SIZE; i++){
+            if (!_cache[i].valid){
+                entry = &_cache[i];
+                break;
+            }
+            if ((long)(_cache[i].expires - entry->expires) < 0){
+                entry = &_cache[i];
+            }
+        }
+    }
+    strcpy(entry->host, host);
+    entry->ip = ip;
+    entry->expires = millis() + _ttl;
+    entry->valid = true;
+}
+
+//+CDNSGIP: 1,"host","ip1"[,"ip2"] on success, +CDNSGIP: 0,<error> on failure
+//returns 1 on success, 0 on failure, -1 if line does not contain a result
+int8_t GSMResolver::parse(const char* line, IPAddress& ip)
+{
+    const char* p = strstr(line, DNS_RESULT);
+    if (p == NULL) return -1;
+    p += strlen(DNS_RESULT);
+    while (*p == ' ') p++;
+    if (*p != '1') return 0;
+
+    //skip the quoted host name, the address is the next quoted field
+    p = strchr(p, '"');
+    if (p != NULL) p = strchr(p + 1, '"');
+    if (p != NULL) p = strchr(p + 1, '"');
+    if (p == NULL) return 0;
+    p++;
+
+    char addr[16];
+    uint8_t n = 0;
+    while (*p != '"' && *p != '\0' && n < sizeof(addr) - 1){
+        addr[n++] = *p++;
+    }
+    addr[n] = '\0';
+    return ip.fromString(addr) ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef _GSM_RESOLVER_H_INCLUDED
+#define _GSM_RESOLVER_H_INCLUDED
+
+#include <IPAddress.h>
+
+#include "modem.h"
+
+#define DNS_CACHE_SIZE 4
+#define DNS_HOST_MAX 40 //longer host names are resolved but never cached
+#define DNS_DEFAULT_TTL_MS (10UL * 60 * 1000)
+
+/* Resolves host names with AT+CDNSGIP and keeps the results in a small cache.
+    The modem does not report the record TTL, so every entry lives for the configured TTL.
+*/
+class GSMResolver : public ModemUrcHandler {
+
+public:
+    GSMResolver(ModemClass& modem = MODEM);
+
+    /** Resolve host, from the cache if possible
+      @return true if ip is valid
+    */
+    bool resolve(const char* host, IPAddress& ip, unsigned long timeout = 10000L);
+
+    /** Look host up in the cache only
+    */
+    bool lookup(const char* host, IPAddress& ip);
+
+    /** Ask the modem, bypassing the cache, and cache the result
+    */
+    bool query(const char* host, IPAddress& ip, unsigned long timeout = 10000L);
+
+    void invalidate(const char* host);
+    void clear();
+    void setTtl(unsigned long ttl_ms);
+
+    void handleUrc(const void* data, uint16_t len);
+
+private:
+    ModemClass* _modem;
+    struct Entry {
+        char host[DNS_HOST_MAX];
+        IPAddress ip;
+        unsigned long expires;
+        bool valid;
+    };
+
+    Entry* find(const char* host);
+    void store(const char* host, const IPAddress& ip);
+    static int8_t parse(const char* line, IPAddress& ip);
+
+    Entry _cache[DNS_CACHE_SIZE];
+    unsigned long _ttl;
+    int8_t _urcResult;
+    IPAddress _urcIp;
+};
+
+#endif
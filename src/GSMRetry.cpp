@@ -0,0 +1,130 @@
+#include "GSMRetry.h"
+
+GSMRetryPolicy::GSMRetryPolicy(unsigned long baseDelay, unsigned long maxDelay, uint8_t budget, uint8_t threshold, unsigned long openTime):
+    _baseDelay(baseDelay),
+    _maxDelay(maxDelay),
+    _jitter(RETRY_JITTER_PERCENT),
+    _budget(budget),
+    _threshold(threshold),
+    _openTime(openTime),
+    _seed(0)
+{
+    reset();
+    resetCounters();
+}
+
+void GSMRetryPolicy::setJitter(uint8_t percent)
+{
+    _jitter = min(percent, (uint8_t)100);
+}
+
+void GSMRetryPolicy::reset()
+{
+    _state = BREAKER_CLOSED;
+    _consecutive = 0;
+    _callFailures = 0;
+    _failedAt = 0;
+    _delay = 0;
+}
+
+bool GSMRetryPolicy::begin()
+{
+    if (!allow()){
+        _counters.rejected++;
+        return false;
+    }
+    _callFailures = 0;
+    _counters.calls++;
+    return true;
+}
+
+bool GSMRetryPolicy::allow()
+{
+    unsigned long elapsed = millis() - _failedAt;
+    if (_state == BREAKER_OPEN){
+        if (elapsed < _openTime){
+            return false;
+        }
+        _state = BREAKER_HALF_OPEN; //one trial attempt
+    }
+    return _consecutive == 0 || elapsed >= _delay;
+}
+
+unsigned long GSMRetryPolicy::wait()
+{
+    if (allow()){
+        return 0;
+    }
+    unsigned long elapsed = millis() - _failedAt;
+    unsigned long until = _state == BREAKER_OPEN ? _openTime : _delay;
+    return until - elapsed;
+}
+
+void GSMRetryPolicy::success()
+{
+    _counters.attempts++;
+    _counters.successes++;
+    _state = BREAKER_CLOSED;
+    _consecutive = 0;
+    _delay = 0;
+}
+
+bool GSMRetryPolicy::failure()
+{
+    _counters.attempts++;
+    _counters.failures++;
+    _failedAt = millis();
+    if (_consecutive < 255) _consecutive++;
+    _callFailures++;
+
+    if (_state == BREAKER_HALF_OPEN || (_threshold != 0 && _consecutive >= _threshold)){
+        _state = BREAKER_OPEN;
+        _counters.opened++;
+        _delay = 0;
+        return false;
+    }
+
+    _delay = backoff();
+    _counters.backoffMillis += _delay;
+    if (_budget != 0 && _callFailures >= _budget){
+        _counters.exhausted++;
+        return false;
+    }
+    return true;
+}
+
+unsigned long GSMRetryPolicy::backoff()
+{
+    //exponential in the consecutive failures, with part of it cut at random so that
+    //devices failing together do not retry together
+    uint8_t shift = min(_consecutive - 1, 16);
+    unsigned long delay = _baseDelay << shift;
+    if (delay > _maxDelay || (delay >> shift) != _baseDelay){
+        delay = _maxDelay;
+    }
+
+    if (_seed == 0){
+        _seed = micros() | 1;
+    }
+    _seed ^= _seed << 13; //xorshift32
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    unsigned long range = delay / 100 * _jitter;
+    return range == 0 ? delay : delay - _seed % (range + 1);
+}
+
+GSMBreakerState GSMRetryPolicy::state()
+{
+    allow(); //open -> half open once the open time passed
+    return _state;
+}
+
+const GSMRetryCounters& GSMRetryPolicy::counters()
+{
+    return _counters;
+}
+
+void GSMRetryPolicy::resetCounters()
+{
+    memset(&_counters, 0, sizeof(_counters));
+}
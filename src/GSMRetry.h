@@ -0,0 +1,88 @@
+#ifndef _GSM_RETRY_H_INCLUDED
+#define _GSM_RETRY_H_INCLUDED
+
+#include <Arduino.h>
+
+#define RETRY_BASE_MS 1000UL
+#define RETRY_MAX_MS 60000UL
+#define RETRY_JITTER_PERCENT 50     //up to this share of each backoff is randomly cut
+#define RETRY_BUDGET 3              //failed attempts per call, 0 for no limit
+#define BREAKER_THRESHOLD 6         //consecutive failures that open the breaker
+#define BREAKER_OPEN_MS 300000UL
+
+enum GSMBreakerState {BREAKER_CLOSED, BREAKER_OPEN, BREAKER_HALF_OPEN};
+
+struct GSMRetryCounters {
+    uint32_t calls;         //begin() accepted
+    uint32_t rejected;      //begin() refused: backing off or breaker open
+    uint32_t attempts;
+    uint32_t successes;
+    uint32_t failures;
+    uint32_t exhausted;     //calls given up with the budget used
+    uint32_t opened;        //breaker trips
+    uint32_t backoffMillis; //backoff imposed after failures
+};
+
+/* Retry policy for one class of operation (init, attach, connect...), shared by every call
+    of that class:
+    - after a failure the next attempt waits a jittered exponential backoff, and calls made
+      meanwhile are refused without touching the modem
+    - a call gives up after RETRY_BUDGET failed attempts
+    - BREAKER_THRESHOLD consecutive failures open the breaker: calls are refused for
+      BREAKER_OPEN_MS, then one trial attempt (half open) closes it again or reopens it
+    See GSM::setRetryPolicy(), GPRS::setAttachPolicy() and GPRS::setConnectPolicy().
+*/
+class GSMRetryPolicy {
+
+public:
+    GSMRetryPolicy(unsigned long baseDelay = RETRY_BASE_MS, unsigned long maxDelay = RETRY_MAX_MS,
+                   uint8_t budget = RETRY_BUDGET, uint8_t threshold = BREAKER_THRESHOLD,
+                   unsigned long openTime = BREAKER_OPEN_MS);
+
+    void setJitter(uint8_t percent);
+
+    /** Start a call of the operation
+      @return false if it has to be refused (backing off or breaker open)
+    */
+    bool begin();
+
+    /** @return true if the next attempt of the current call may go out now
+    */
+    bool allow();
+
+    /** ms until allow(), 0 if it already does
+    */
+    unsigned long wait();
+
+    void success();
+    /** Record a failed attempt and schedule the backoff
+      @return true if the call may retry, false if it has to give up
+    */
+    bool failure();
+
+    GSMBreakerState state();
+    const GSMRetryCounters& counters();
+    void resetCounters();
+    /** Close the breaker and forget past failures
+    */
+    void reset();
+
+private:
+    unsigned long backoff();
+    unsigned long _baseDelay;
+    unsigned long _maxDelay;
+    uint8_t _jitter;
+    uint8_t _budget;
+    uint8_t _threshold;
+    unsigned long _openTime;
+
+    GSMBreakerState _state;
+    uint8_t _consecutive;       //failures since the last success
+    uint8_t _callFailures;
+    unsigned long _failedAt;    //last failure, or breaker trip while open
+    unsigned long _delay;       //backoff after _failedAt
+    uint32_t _seed;
+    GSMRetryCounters _counters;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "GSMSignal.h"
+
+//default levels match GSM::signal2String()
+static const int8_t SIGNAL_DEFAULT_THRESHOLDS[] = {-100, -89, -59};
+
+GSMSignal::GSMSignal(ModemClass& modem):
+    _modem(&modem),
+    _interval(SIGNAL_SAMPLE_INTERVAL_MS),
+    _lastSample(0),
+    _rssi16(0),
+    _ber16(-1),
+    _last(SIGNAL_UNKNOWN),
+    _min(SIGNAL_UNKNOWN),
+    _max(SIGNAL_UNKNOWN),
+    _valid(false),
+    _thresholdCount(0),
+    _level(0),
+    _callback(NULL)
+{
+    setThresholds(SIGNAL_DEFAULT_THRESHOLDS, sizeof(SIGNAL_DEFAULT_THRESHOLDS), NULL);
+}
+
+bool GSMSignal::poll()
+{
+    if (_lastSample != 0 && millis() - _lastSample < _interval){
+        return false;
+    }
+    if (!_modem->idle()){
+        return false; //someone else's command is in flight, try on the next poll
+    }
+    return sample();
+}
+
+bool GSMSignal::sample(unsigned long timeout)
+{
+    String response;
+    _lastSample = millis();
+
+    _modem->send(F("AT+CSQ"));
+    if (_modem->waitForResponse(timeout, &response) != 1){
+        return false;
+    }
+    uint8_t ber;
+    int8_t dbm = parse(response.c_str(), &ber);
+    if (dbm == SIGNAL_UNKNOWN){
+        return false; //not detectable yet, keep the history
+    }
+    update(dbm, ber);
+    return true;
+}
+
+int8_t GSMSignal::parse(const char* response, uint8_t* ber)
+{
+    const char* p = strstr(response, "+CSQ:");
+    if (p == NULL){
+        return SIGNAL_UNKNOWN;
+    }
+    int csq = atoi(p + 5);
+    const char* comma = strchr(p, ',');
+    if (ber != NULL){
+        *ber = comma != NULL ? atoi(comma + 1) : SIGNAL_UNKNOWN;
+    }
+    if (csq < 0 || csq > 31){
+        return SIGNAL_UNKNOWN;
+    }
+    return 2 * csq - 113; //27.007: 0 is -113 dBm or less, 31 is -51 dBm or more
+}
+
+void GSMSignal::update(int8_t dbm, uint8_t ber)
+{
+    if (!_valid){
+        _rssi16 = dbm * 16;
+        _min = _max = dbm;
+        _valid = true;
+    }
+    else{
+        _rssi16 += (dbm * 16 - _rssi16) >> SIGNAL_EMA_SHIFT;
+        if (dbm < _min) _min = dbm;
+        if (dbm > _max) _max = dbm;
+    }
+    _last = dbm;
+
+    if (ber <= 7){
+        if (_ber16 < 0) _ber16 = ber * 16;
+        else _ber16 += (ber * 16 - _ber16) >> SIGNAL_EMA_SHIFT;
+    }
+
+    uint8_t level = levelOf(_rssi16);
+    if (level != _level){
+        _level = level;
+        if (_callback != NULL){
+            _callback(rssi(), _level);
+        }
+    }
+}
+
+uint8_t GSMSignal::levelOf(int16_t rssi16)
+{
+    //stay at the current level unless past the hysteresis band of its thresholds
+    uint8_t level = _level;
+    while (level < _thresholdCount && rssi16 >= (_thresholds[level] + SIGNAL_HYSTERESIS_DB) * 16){
+        level++;
+    }
+    while (level > 0 && rssi16 < (_thresholds[level - 1] - SIGNAL_HYSTERESIS_DB) * 16){
+        level--;
+    }
+    return level;
+}
+
+void GSMSignal::setInterval(unsigned long interval_ms)
+{
+    _interval = interval_ms;
+}
+
+void GSMSignal::setThresholds(const int8_t* thresholds, uint8_t count, GSMSignalCallback callback)
+{
+    if (count > SIGNAL_THRESHOLDS_MAX) count = SIGNAL_THRESHOLDS_MAX;
+    memcpy(_thresholds, thresholds, count);
+    _thresholdCount = count;
+    _callback = callback;
+    _level = 0;
+    if (_valid){
+        //place the current value without hysteresis, no callback for the new setup
+        while (_level < _thresholdCount && _rssi16 >= _thresholds[_level] * 16) _level++;
+    }
+}
+
+int8_t GSMSignal::rssi()
+{
+    if (!_valid) return SIGNAL_UNKNOWN;
+    return (_rssi16 - 8) / 16; //round to nearest, values are negative
+}
+
+int8_t GSMSignal::last()
+{
+    return _last;
+}
+
+int8_t GSMSignal::minimum()
+{
+    return _min;
+}
+
+int8_t GSMSignal::maximum()
+{
+    return _max;
+}
+
+uint8_t GSMSignal::ber()
+{
+    if (_ber16 < 0) return SIGNAL_UNKNOWN;
+    return (_ber16 + 8) / 16;
+}
+
+uint8_t GSMSignal::level()
+{
+    return _level;
+}
+
+bool GSMSignal::valid()
+{
+    return _valid;
+}
+
+unsigned long GSMSignal::age()
+{
+    return millis() - _lastSample;
+}
+
+void GSMSignal::reset()
+{
+    _valid = false;
+    _ber16 = -1;
+    _last = _min = _max = SIGNAL_UNKNOWN;
+    _level = 0;
+}
@@ -0,0 +1,81 @@
+#ifndef _GSM_SIGNAL_H_INCLUDED
+#define _GSM_SIGNAL_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+#define SIGNAL_UNKNOWN 99
+#define SIGNAL_SAMPLE_INTERVAL_MS 10000UL
+#define SIGNAL_SAMPLE_TIMEOUT_MS 100
+#define SIGNAL_EMA_SHIFT 2       //weight of a new sample is 1/4
+#define SIGNAL_THRESHOLDS_MAX 4
+#define SIGNAL_HYSTERESIS_DB 2
+
+/** Called with the smoothed RSSI (dBm) and the new level, the number of thresholds it is above
+*/
+typedef void (*GSMSignalCallback)(int8_t rssi, uint8_t level);
+
+/* Samples AT+CSQ in the background, only when the modem has no command in flight, and
+    keeps an exponentially smoothed RSSI/BER with min/max since the last reset.
+    Readers get the cached values without any AT traffic.
+*/
+class GSMSignal {
+
+public:
+    GSMSignal(ModemClass& modem = MODEM);
+
+    /** Take a sample if the interval elapsed and the modem is idle, call it from loop()
+      @return true if a sample was taken
+    */
+    bool poll();
+
+    /** Take a sample now
+    */
+    bool sample(unsigned long timeout = SIGNAL_SAMPLE_TIMEOUT_MS);
+
+    void setInterval(unsigned long interval_ms);
+
+    /** Thresholds in dBm, ascending. The callback fires when the level changes,
+        with SIGNAL_HYSTERESIS_DB of hysteresis around each threshold
+    */
+    void setThresholds(const int8_t* thresholds, uint8_t count, GSMSignalCallback callback);
+
+    /** Smoothed RSSI in dBm, SIGNAL_UNKNOWN if there is no sample yet
+    */
+    int8_t rssi();
+    int8_t last();
+    int8_t minimum();
+    int8_t maximum();
+    /** Smoothed bit error rate class 0..7, SIGNAL_UNKNOWN if not reported
+    */
+    uint8_t ber();
+    uint8_t level();
+    bool valid();
+    unsigned long age();
+    void reset();
+
+    /** RSSI in dBm of a "+CSQ: rssi,ber" response, SIGNAL_UNKNOWN if not known
+    */
+    static int8_t parse(const char* response, uint8_t* ber = NULL);
+
+private:
+    ModemClass* _modem;
+    void update(int8_t dbm, uint8_t ber);
+    uint8_t levelOf(int16_t dbm);
+
+    unsigned long _interval;
+    unsigned long _lastSample;
+    int16_t _rssi16;   //smoothed dBm * 16
+    int16_t _ber16;    //smoothed class * 16, -1 unknown
+    int8_t _last;
+    int8_t _min;
+    int8_t _max;
+    bool _valid;
+    int8_t _thresholds[SIGNAL_THRESHOLDS_MAX];
+    uint8_t _thresholdCount;
+    uint8_t _level;
+    GSMSignalCallback _callback;
+};
+
+#endif
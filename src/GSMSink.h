@@ -0,0 +1,49 @@
+#ifndef _GSM_SINK_H_INCLUDED
+#define _GSM_SINK_H_INCLUDED
+
+#include <Arduino.h>
+
+/* Destination of encoded bytes (compressed frames, serialized records...).
+    write() returns the number of bytes accepted, less than len means the sink is full.
+*/
+class ByteSink {
+    public:
+    virtual uint16_t write(const uint8_t* buf, uint16_t len) = 0;
+};
+
+/* Sink writing into a caller supplied buffer.
+*/
+class BufferSink : public ByteSink {
+    public:
+    BufferSink(uint8_t* buf, uint16_t size):
+        _buf(buf),
+        _size(size),
+        _len(0)
+    {
+    }
+
+    uint16_t write(const uint8_t* buf, uint16_t len)
+    {
+        if (len > _size - _len) len = _size - _len;
+        memcpy(_buf + _len, buf, len);
+        _len += len;
+        return len;
+    }
+
+    inline uint16_t length()
+    {
+        return _len;
+    }
+
+    inline void reset()
+    {
+        _len = 0;
+    }
+
+    private:
+    uint8_t* _buf;
+    uint16_t _size;
+    uint16_t _len;
+};
+
+#endif
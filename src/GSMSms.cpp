@@ -0,0 +1,515 @@
+#include "GSMSms.h"
+
+#define SMS_SEGMENT_SEPTETS 160
+#define SMS_CONCAT_SEPTETS 153
+#define SMS_UDH_CONCAT_LEN 6
+#define GSM7_ESC 0x1B
+
+static const char SMS_CMTI[] PROGMEM = "+CMTI:";
+static const char SMS_CMGL[] PROGMEM = "+CMGL:";
+static const char HEX_DIGITS[] PROGMEM = "0123456789ABCDEF";
+
+//ASCII characters that are not at the same position in the GSM 7 bit default alphabet
+static const char GSM7_EXT_ASCII[] PROGMEM = "^{}\\[~]|";
+static const uint8_t GSM7_EXT_CODE[] PROGMEM = {0x14, 0x28, 0x29, 0x2F, 0x3C, 0x3D, 0x3E, 0x40};
+
+//encode c as GSM 7 bit, return the number of septets (2 for extension table characters)
+static uint8_t gsm7Encode(char c, uint8_t* septets)
+{
+    const char* ext = strchr(GSM7_EXT_ASCII, c);
+    if (c != '\0' && ext != NULL){
+        septets[0] = GSM7_ESC;
+        septets[1] = GSM7_EXT_CODE[ext - GSM7_EXT_ASCII];
+        return 2;
+    }
+    switch (c){
+    case '@': septets[0] = 0x00; break;
+    case '$': septets[0] = 0x02; break;
+    case '_': septets[0] = 0x11; break;
+    case '\n':
+    case '\r': septets[0] = c; break;
+    default:
+        septets[0] = (c >= 0x20 && c < 0x7F && c != '`') ? c : '?';
+        break;
+    }
+    return 1;
+}
+
+static char gsm7Decode(uint8_t septet, bool escaped)
+{
+    if (escaped){
+        for (uint8_t i = 0; i < sizeof(GSM7_EXT_CODE); i++){
+            if (GSM7_EXT_CODE[i] == septet) return GSM7_EXT_ASCII[i];
+        }
+        return '?';
+    }
+    switch (septet){
+    case 0x00: return '@';
+    case 0x02: return '$';
+    case 0x11: return '_';
+    case '\n':
+    case '\r': return septet;
+    default:
+        break;
+    }
+    //letters, digits and most punctuation share the ASCII code
+    if ((septet >= 0x20 && septet <= 0x23) || (septet >= 0x25 && septet <= 0x3F)
+        || (septet >= 'A' && septet <= 'Z') || (septet >= 'a' && septet <= 'z')){
+        return septet;
+    }
+    return '?';
+}
+
+//pack septets into out, starting bitOffset bits in
+static void packSeptets(const uint8_t* septets, uint8_t count, uint8_t* out, uint16_t bitOffset)
+{
+    for (uint8_t i = 0; i < count; i++, bitOffset += 7){
+        uint16_t octet = bitOffset / 8;
+        uint8_t shift = bitOffset % 8;
+        out[octet] |= septets[i] << shift;
+        if (shift > 1){
+            out[octet + 1] |= septets[i] >> (8 - shift);
+        }
+    }
+}
+
+static uint8_t unpackSeptet(const uint8_t* in, uint16_t bitOffset)
+{
+    uint16_t octet = bitOffset / 8;
+    uint8_t shift = bitOffset % 8;
+    uint8_t septet = in[octet] >> shift;
+    if (shift > 1){
+        septet |= in[octet + 1] << (8 - shift);
+    }
+    return septet & 0x7F;
+}
+
+static int8_t hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+//semi-octet (swapped BCD) digits to text
+static void decodeNumber(const uint8_t* in, uint8_t digits, uint8_t type, char* out)
+{
+    uint8_t n = 0;
+    if ((type & 0x70) == 0x50){
+        //alphanumeric sender, GSM 7 bit packed
+        uint8_t chars = digits * 4 / 7;
+        for (uint8_t i = 0; i < chars && n < SMS_NUMBER_MAX; i++){
+            out[n++] = gsm7Decode(unpackSeptet(in, i * 7), false);
+        }
+    }
+    else{
+        if ((type & 0x70) == 0x10) out[n++] = '+';
+        for (uint8_t i = 0; i < digits && n < SMS_NUMBER_MAX; i++){
+            uint8_t d = (i & 1) ? in[i / 2] >> 4 : in[i / 2] & 0x0F;
+            out[n++] = d < 10 ? '0' + d : '?';
+        }
+    }
+    out[n] = '\0';
+}
+
+struct SmsSegment {
+    uint16_t offset; //position of the PDU in the CMGL response
+    uint8_t index;
+    uint16_t ref;
+    uint8_t total;
+    uint8_t seq;
+    bool used;
+};
+
+/* Parse an SMS-DELIVER TPDU, optionally decoding the text.
+    Returns false if the PDU is not a valid SMS-DELIVER. The PDU comes from the network, so
+    every length field is checked against len before it is used.
+*/
+static bool parseDeliver(const uint8_t* pdu, uint8_t len, SmsSegment* segment, GSMSmsMessage* message, uint16_t textPos)
+{
+    if (len == 0) return false;
+    uint16_t p = pdu[0] + 1; //skip service centre address
+    if (p + 3 > len || (pdu[p] & 0x03) != 0x00) return false;
+    bool udhi = pdu[p] & 0x40;
+    p++;
+
+    uint8_t digits = pdu[p];
+    uint8_t type = pdu[p + 1];
+    p += 2;
+    if (p + (digits + 1) / 2 > len) return false;
+    if (message != NULL) decodeNumber(pdu + p, digits, type, message->sender);
+    p += (digits + 1) / 2;
+
+    if (p + 10 > len) return false;
+    uint8_t dcs = pdu[p + 1];
+    p += 2;
+    if (message != NULL){
+        //service centre time stamp, swapped BCD yy MM dd hh mm ss tz
+        char* t = message->timestamp;
+        for (uint8_t i = 0; i < 6; i++){
+            *t++ = '0' + (pdu[p + i] & 0x0F);
+            *t++ = '0' + (pdu[p + i] >> 4);
+            *t++ = i < 2 ? '/' : (i == 2 ? ',' : (i < 5 ? ':' : '\0'));
+        }
+    }
+    p += 7;
+
+    uint8_t udl = pdu[p++];
+    const uint8_t* ud = pdu + p;
+    uint8_t alphabet = dcs & 0x0C;
+    //udl counts septets with the default alphabet, octets otherwise
+    uint16_t udOctets = alphabet == 0x00 ? (udl * 7 + 7) / 8 : udl;
+    if (p + udOctets > len) return false;
+
+    uint16_t udhLen = 0;
+    segment->ref = 0;
+    segment->total = 1;
+    segment->seq = 1;
+    if (udhi){
+        if (udOctets == 0) return false;
+        udhLen = ud[0] + 1;
+        if (udhLen > udOctets) return false;
+        for (uint16_t i = 1; i + 1 < udhLen;){
+            uint8_t iei = ud[i];
+            uint8_t iel = ud[i + 1];
+            if (i + 2 + iel > udhLen) return false;
+            if (iei == 0x00 && iel == 3){
+                segment->ref = ud[i + 2];
+                segment->total = ud[i + 3];
+                segment->seq = ud[i + 4];
+            }
+            else if (iei == 0x08 && iel == 4){
+                segment->ref = (ud[i + 2] << 8) | ud[i + 3];
+                segment->total = ud[i + 4];
+                segment->seq = ud[i + 5];
+            }
+            i += 2 + iel;
+        }
+        if (segment->total == 0 || segment->seq == 0) return false;
+    }
+    if (message == NULL) return true;
+
+    char* text = message->text;
+    if (alphabet == 0x00){
+        //udl counts septets, header included
+        uint16_t skip = (udhLen * 8 + 6) / 7;
+        bool escaped = false;
+        for (uint16_t i = skip; i < udl && textPos < SMS_TEXT_MAX; i++){
+            uint8_t septet = unpackSeptet(ud, i * 7);
+            if (septet == GSM7_ESC && !escaped){
+                escaped = true;
+                continue;
+            }
+            text[textPos++] = gsm7Decode(septet, escaped);
+            escaped = false;
+        }
+    }
+    else if (alphabet == 0x08){
+        //UCS2, only the ASCII range is kept
+        for (uint16_t i = udhLen; i + 1 < udl && textPos < SMS_TEXT_MAX; i += 2){
+            uint16_t c = (ud[i] << 8) | ud[i + 1];
+            text[textPos++] = c < 0x80 ? c : '?';
+        }
+    }
+    else{
+        for (uint16_t i = udhLen; i < udl && textPos < SMS_TEXT_MAX; i++){
+            text[textPos++] = ud[i];
+        }
+    }
+    text[textPos] = '\0';
+    return true;
+}
+
+static uint8_t hexToPdu(const char* hex, uint8_t* pdu)
+{
+    uint8_t len = 0;
+    while (len < SMS_PDU_MAX){
+        int8_t hi = hexValue(hex[0]);
+        int8_t lo = hi < 0 ? -1 : hexValue(hex[1]);
+        if (lo < 0) break;
+        pdu[len++] = (hi << 4) | lo;
+        hex += 2;
+    }
+    return len;
+}
+
+GSMSms::GSMSms(ModemClass& modem):
+    _modem(&modem),
+    _begin(false),
+    _unread(0),
+    _ref(0)
+{
+}
+
+GSMSms::~GSMSms()
+{
+    end();
+}
+
+bool GSMSms::begin()
+{
+    _modem->send(F("AT+CMGF=0"));
+    if (_modem->waitForResponse() != 1) return false;
+
+    //store on the SIM and signal new messages with +CMTI
+    _modem->send(F("AT+CNMI=2,1,0,0,0"));
+    if (_modem->waitForResponse() != 1) return false;
+
+    if (!_begin){
+        _modem->addUrcHandler(this);
+        _begin = true;
+    }
+    _ref = millis();
+    return true;
+}
+
+void GSMSms::end()
+{
+    if (_begin){
+        _modem->removeUrcHandler(this);
+        _begin = false;
+    }
+}
+
+bool GSMSms::send(const char* number, const char* text)
+{
+    return send(&number, 1, text) == 1;
+}
+
+uint8_t GSMSms::send(const char* const* numbers, uint8_t count, const char* text)
+{
+    //the PDU must not be echoed back, see GSM_Socket::send
+    if (!_modem->turnEcho(false)) return 0;
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < count; i++){
+        if (sendMessage(numbers[i], text)) sent++;
+    }
+    _modem->turnEcho(true);
+    return sent;
+}
+
+bool GSMSms::sendMessage(const char* number, const char* text)
+{
+    uint8_t septets[SMS_SEGMENT_SEPTETS];
+    uint8_t pdu[SMS_PDU_MAX];
+
+    //count septets to decide whether the text needs concatenation
+    uint16_t total = 0;
+    for (const char* c = text; *c != '\0'; c++){
+        total += gsm7Encode(*c, septets);
+    }
+
+    uint8_t segments = 1;
+    uint8_t capacity = SMS_SEGMENT_SEPTETS;
+    if (total > SMS_SEGMENT_SEPTETS){
+        capacity = SMS_CONCAT_SEPTETS;
+        segments = 0;
+        //an escape sequence is never split, so count segments the same way they are built
+        uint8_t used = capacity;
+        for (const char* c = text; *c != '\0'; c++){
+            uint8_t n = gsm7Encode(*c, septets);
+            if (used + n > capacity){
+                segments++;
+                used = 0;
+            }
+            used += n;
+        }
+        if (segments > SMS_MAX_PARTS){
+            DBG("#DEBUG# SMS text too long");
+            return false;
+        }
+        _ref++;
+    }
+
+    const char* c = text;
+    for (uint8_t seq = 1; seq <= segments; seq++){
+        uint8_t count = 0;
+        while (*c != '\0'){
+            uint8_t encoded[2];
+            uint8_t n = gsm7Encode(*c, encoded);
+            if (count + n > capacity) break;
+            memcpy(septets + count, encoded, n);
+            count += n;
+            c++;
+        }
+        uint8_t len = buildPdu(pdu, number, septets, count, segments, seq);
+        if (len == 0 || !sendPdu(pdu, len)) return false;
+    }
+    return true;
+}
+
+uint8_t GSMSms::buildPdu(uint8_t* pdu, const char* number, const uint8_t* septets, uint8_t count,
+                         uint8_t total, uint8_t seq)
+{
+    uint8_t n = 0;
+    bool concat = total > 1;
+
+    pdu[n++] = 0x00; //use the service centre stored on the SIM
+    pdu[n++] = concat ? 0x41 : 0x01; //SMS-SUBMIT, UDHI if concatenated
+    pdu[n++] = 0x00; //message reference, set by the modem
+
+    bool international = number[0] == '+';
+    if (international) number++;
+    uint8_t digits = strlen(number);
+    if (digits > SMS_NUMBER_MAX) return 0;
+    pdu[n++] = digits;
+    pdu[n++] = international ? 0x91 : 0x81;
+    for (uint8_t i = 0; i < digits; i += 2){
+        uint8_t lo = number[i] - '0';
+        uint8_t hi = i + 1 < digits ? number[i + 1] - '0' : 0x0F;
+        pdu[n++] = (hi << 4) | (lo & 0x0F);
+    }
+
+    pdu[n++] = 0x00; //protocol identifier
+    pdu[n++] = 0x00; //GSM 7 bit default alphabet
+
+    uint8_t headerSeptets = concat ? (SMS_UDH_CONCAT_LEN * 8 + 6) / 7 : 0;
+    uint8_t udl = headerSeptets + count;
+    uint8_t udOctets = (udl * 7 + 7) / 8;
+    if (n + 1 + udOctets > SMS_PDU_MAX) return 0;
+
+    pdu[n++] = udl;
+    uint8_t* ud = pdu + n;
+    memset(ud, 0, udOctets);
+    if (concat){
+        ud[0] = SMS_UDH_CONCAT_LEN - 1;
+        ud[1] = 0x00; //concatenated message, 8 bit reference
+        ud[2] = 3;
+        ud[3] = _ref;
+        ud[4] = total;
+        ud[5] = seq;
+    }
+    packSeptets(septets, count, ud, headerSeptets * 7);
+    return n + udOctets;
+}
+
+bool GSMSms::sendPdu(const uint8_t* pdu, uint8_t len)
+{
+    //the length excludes the service centre address
+    _modem->sendf("AT+CMGS=%d", len - 1 - pdu[0]);
+    _modem->_atCommandState = ModemClass::AT_RECV_RESP;
+    if (!_modem->streamSkipUntil('>', NULL, 5000)){
+        DBG("#DEBUG# SMS prompt not received");
+        _modem->write(0x1B); //abort
+        _modem->waitForResponse();
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++){
+        _modem->write(HEX_DIGITS[pdu[i] >> 4]);
+        _modem->write(HEX_DIGITS[pdu[i] & 0x0F]);
+    }
+    _modem->write(0x1A); //tell modem to send
+    _modem->flush();
+    return _modem->waitForResponse(60 * 1000) == 1;
+}
+
+uint8_t GSMSms::available()
+{
+    _modem->poll();
+    return _unread;
+}
+
+int8_t GSMSms::readAll(GSMSmsMessage* messages, uint8_t max, bool remove)
+{
+    String response;
+    _modem->send(F("AT+CMGL=4")); //all messages, PDU mode
+    if (_modem->waitForResponse(5000, &response) != 1){
+        return -1;
+    }
+    _unread = 0;
+
+    //first pass: index every stored segment
+    SmsSegment segments[SMS_LIST_MAX];
+    uint8_t pdu[SMS_PDU_MAX];
+    uint8_t found = 0;
+    uint8_t listed = 0;
+    bool more = false;
+    for (int pos = response.indexOf(SMS_CMGL); pos != -1; pos = response.indexOf(SMS_CMGL, pos + 1)){
+        if (found == SMS_LIST_MAX){
+            more = true;
+            break;
+        }
+        listed++;
+        int line = response.indexOf('\n', pos);
+        if (line == -1) break;
+        SmsSegment& s = segments[found];
+        s.index = atoi(response.c_str() + pos + strlen(SMS_CMGL));
+        s.offset = line + 1;
+        s.used = false;
+        uint8_t len = hexToPdu(response.c_str() + s.offset, pdu);
+        if (len > 0 && parseDeliver(pdu, len, &s, NULL, 0)){
+            found++;
+        }
+    }
+
+    //second pass: assemble complete messages, segments in sequence order
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < found; i++){
+        if (segments[i].used) continue;
+
+        uint8_t parts[SMS_MAX_PARTS];
+        uint8_t have = 0;
+        uint8_t total = segments[i].total;
+        for (uint8_t seq = 1; seq <= total && total <= SMS_MAX_PARTS; seq++){
+            for (uint8_t j = i; j < found; j++){
+                if (!segments[j].used && segments[j].ref == segments[i].ref
+                    && segments[j].total == total && segments[j].seq == seq){
+                    parts[have++] = j;
+                    break;
+                }
+            }
+        }
+        if (have != total || count >= max){
+            continue; //wait for the missing segments
+        }
+
+        GSMSmsMessage& m = messages[count++];
+        m.text[0] = '\0';
+        m.parts = total;
+        for (uint8_t k = 0; k < have; k++){
+            SmsSegment& s = segments[parts[k]];
+            uint8_t len = hexToPdu(response.c_str() + s.offset, pdu);
+            parseDeliver(pdu, len, &s, &m, strlen(m.text));
+            s.used = true;
+        }
+    }
+
+    if (remove){
+        uint8_t used = 0;
+        for (uint8_t i = 0; i < found; i++){
+            if (segments[i].used) used++;
+        }
+        if (!more && used == listed){
+            //everything listed was returned: one delete of the read messages, anything
+            //received since the list is still unread and stays stored
+            _modem->send(F("AT+CMGD=1,1"));
+            _modem->waitForResponse(5000);
+        }
+        else{
+            //only what was returned: PDUs that failed to parse, are not SMS-DELIVER, or
+            //wait for segments, stay stored
+            for (uint8_t i = 0; i < found; i++){
+                if (segments[i].used){
+                    _modem->sendf("AT+CMGD=%d", segments[i].index);
+                    _modem->waitForResponse(1000);
+                }
+            }
+        }
+    }
+    return count;
+}
+
+bool GSMSms::removeAll()
+{
+    _modem->send(F("AT+CMGD=1,4"));
+    return _modem->waitForResponse(5000) == 1;
+}
+
+void GSMSms::handleUrc(const void* data, uint16_t len)
+{
+    const char* line = reinterpret_cast<const char*>(data);
+    if (strncmp(line, SMS_CMTI, strlen(SMS_CMTI)) == 0){
+        if (_unread < 0xFF) _unread++;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef _GSM_SMS_H_INCLUDED
+#define _GSM_SMS_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+#define SMS_MAX_PARTS 3 //concatenated segments per message
+#define SMS_TEXT_MAX (SMS_MAX_PARTS * 153)
+#define SMS_NUMBER_MAX 20
+#define SMS_LIST_MAX 16 //stored segments handled by a single readAll()
+#define SMS_PDU_MAX 176
+
+struct GSMSmsMessage {
+    char sender[SMS_NUMBER_MAX + 1];
+    char timestamp[18]; //"yy/MM/dd,hh:mm:ss", service centre local time
+    char text[SMS_TEXT_MAX + 1];
+    uint8_t parts;
+};
+
+/* SMS in PDU mode. Text is packed in the GSM 7 bit default alphabet (characters without
+    an equivalent are sent as '?'); longer texts are split into concatenated segments.
+    New messages are signalled by +CMTI, so available() costs no AT traffic.
+*/
+class GSMSms : public ModemUrcHandler {
+
+public:
+    GSMSms(ModemClass& modem = MODEM);
+    virtual ~GSMSms();
+
+    /** Select PDU mode, route +CMTI indications to this object
+      @return true if successful
+    */
+    bool begin();
+    void end();
+
+    /** Send text, split into concatenated segments if needed
+      @return true if every segment was accepted by the network
+    */
+    bool send(const char* number, const char* text);
+
+    /** Send the same text to several numbers, with a single echo off/on round trip
+      @return number of recipients the text was sent to
+    */
+    uint8_t send(const char* const* numbers, uint8_t count, const char* text);
+
+    /** Number of +CMTI indications received since the last readAll()
+    */
+    uint8_t available();
+
+    /** Read every stored message with a single AT+CMGL, reassembling concatenated ones.
+      Messages still missing some segment are neither returned nor removed.
+      @param remove delete the returned messages from the SIM, with a single AT+CMGD=1,1
+        when everything listed was returned
+      @return number of messages, -1 on error
+    */
+    int8_t readAll(GSMSmsMessage* messages, uint8_t max, bool remove = true);
+
+    /** Delete every stored message with a single AT+CMGD
+    */
+    bool removeAll();
+
+    void handleUrc(const void* data, uint16_t len);
+
+private:
+    ModemClass* _modem;
+    bool sendMessage(const char* number, const char* text);
+    bool sendPdu(const uint8_t* pdu, uint8_t len);
+    uint8_t buildPdu(uint8_t* pdu, const char* number, const uint8_t* septets, uint8_t count,
+                     uint8_t total, uint8_t seq);
+
+    bool _begin;
+    uint8_t _unread;
+    uint8_t _ref;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "GSMTimer.h"
+
+GSMTimer::GSMTimer(GSMTimerCallback callback, void* arg):
+    _state(TIMER_IDLE),
+    _callback(callback),
+    _arg(arg),
+    _expires(0),
+    _wheel(NULL),
+    _prev(NULL),
+    _next(NULL)
+{
+}
+
+GSMTimer::~GSMTimer()
+{
+    cancel();
+}
+
+bool GSMTimer::armed()
+{
+    return _state == TIMER_ARMED;
+}
+
+bool GSMTimer::expired()
+{
+    if (_state == TIMER_ARMED){
+        _wheel->poll(); //callers may loop without polling the modem
+    }
+    return _state == TIMER_EXPIRED;
+}
+
+void GSMTimer::cancel()
+{
+    if (_state == TIMER_ARMED){
+        _wheel->cancel(*this);
+    }
+    _state = TIMER_IDLE;
+}
+
+GSMTimerWheel::GSMTimerWheel():
+    _tick(0),
+    _tickMillis(0),
+    _count(0)
+{
+    for (uint8_t i = 0; i < TIMER_WHEEL_SLOTS; i++){
+        _slots[i] = NULL;
+    }
+}
+
+void GSMTimerWheel::arm(GSMTimer& timer, unsigned long ms)
+{
+    timer.cancel(); //from whichever wheel it is on
+    if (ms == 0){
+        timer._state = GSMTimer::TIMER_EXPIRED;
+        return;
+    }
+    if (_count == 0){
+        //idle wheel: restart the tick here instead of catching up
+        _tickMillis = millis();
+    }
+
+    //count from the start of the current tick, so the deadline is never early
+    unsigned long span = millis() - _tickMillis + ms;
+    timer._expires = _tick + (span + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    timer._wheel = this;
+    timer._state = GSMTimer::TIMER_ARMED;
+
+    GSMTimer** slot = &_slots[timer._expires % TIMER_WHEEL_SLOTS];
+    timer._prev = NULL;
+    timer._next = *slot;
+    if (*slot != NULL){
+        (*slot)->_prev = &timer;
+    }
+    *slot = &timer;
+    _count++;
+}
+
+void GSMTimerWheel::cancel(GSMTimer& timer)
+{
+    if (timer._state != GSMTimer::TIMER_ARMED || timer._wheel != this){
+        return;
+    }
+    if (timer._prev != NULL){
+        timer._prev->_next = timer._next;
+    } else {
+        _slots[timer._expires % TIMER_WHEEL_SLOTS] = timer._next;
+    }
+    if (timer._next != NULL){
+        timer._next->_prev = timer._prev;
+    }
+    timer._prev = NULL;
+    timer._next = NULL;
+    timer._state = GSMTimer::TIMER_IDLE;
+    _count--;
+}
+
+uint8_t GSMTimerWheel::poll()
+{
+    unsigned long elapsed = millis() - _tickMillis;
+    if (elapsed < TIMER_TICK_MS){
+        return 0;
+    }
+    uint32_t ticks = elapsed / TIMER_TICK_MS;
+    uint32_t first = _tick + 1;
+    _tick += ticks;
+    _tickMillis += ticks * TIMER_TICK_MS;
+
+    //every timer due by now is in one of the next min(ticks, slots) slots
+    uint8_t fired = 0;
+    uint32_t visits = min(ticks, (uint32_t)TIMER_WHEEL_SLOTS);
+    for (uint32_t i = 0; i < visits && _count > 0; i++){
+        GSMTimer** slot = &_slots[(first + i) % TIMER_WHEEL_SLOTS];
+        GSMTimer* timer = *slot;
+        while (timer != NULL){
+            if ((int32_t)(timer->_expires - _tick) > 0){
+                timer = timer->_next;
+                continue;
+            }
+            GSMTimer* next = timer->_next;
+            cancel(*timer);
+            timer->_state = GSMTimer::TIMER_EXPIRED;
+            fired++;
+            if (timer->_callback != NULL){
+                //may arm or cancel timers, armed ones land after _tick: walk the slot again
+                timer->_callback(timer->_arg);
+                next = *slot;
+            }
+            timer = next;
+        }
+    }
+    return fired;
+}
+
+unsigned long GSMTimerWheel::nextExpiry()
+{
+    if (_count == 0){
+        return (unsigned long)-1;
+    }
+    uint32_t next = 0xFFFFFFFFUL;
+    for (uint8_t i = 0; i < TIMER_WHEEL_SLOTS; i++){
+        for (GSMTimer* timer = _slots[i]; timer != NULL; timer = timer->_next){
+            uint32_t ticks = timer->_expires - _tick;
+            if ((int32_t)ticks <= 0){
+                return 0;
+            }
+            if (ticks < next) next = ticks;
+        }
+    }
+    unsigned long elapsed = millis() - _tickMillis;
+    unsigned long left = next * TIMER_TICK_MS;
+    return elapsed >= left ? 0 : left - elapsed;
+}
+
+uint8_t GSMTimerWheel::count()
+{
+    return _count;
+}
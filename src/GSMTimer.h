@@ -0,0 +1,74 @@
+#ifndef _GSM_TIMER_H_INCLUDED
+#define _GSM_TIMER_H_INCLUDED
+
+#include <Arduino.h>
+
+#define TIMER_WHEEL_SLOTS 32 //power of two
+#define TIMER_TICK_MS 10UL
+
+typedef void (*GSMTimerCallback)(void* arg);
+
+class GSMTimerWheel;
+
+/* A deadline on a GSMTimerWheel. Timers are intrusive list nodes: arming and cancelling
+    allocate nothing, and a timer destroyed while armed cancels itself.
+*/
+class GSMTimer {
+
+public:
+    GSMTimer(GSMTimerCallback callback = NULL, void* arg = NULL);
+    GSMTimer(const GSMTimer&) = delete;
+    GSMTimer& operator=(const GSMTimer&) = delete;
+    ~GSMTimer();
+
+    bool armed();
+    /** Advances the wheel if needed, so timers due by now expire, callbacks included
+      @return true once the deadline passed, until armed again
+    */
+    bool expired();
+    void cancel();
+
+private:
+    friend class GSMTimerWheel;
+    enum { TIMER_IDLE, TIMER_ARMED, TIMER_EXPIRED } _state;
+    GSMTimerCallback _callback;
+    void* _arg;
+    uint32_t _expires;  //tick
+    GSMTimerWheel* _wheel;
+    GSMTimer* _prev;
+    GSMTimer* _next;
+};
+
+/* Hashed timer wheel, one per modem, advanced by ModemClass::poll(). A timer goes in slot
+    expires % TIMER_WHEEL_SLOTS, so arm and cancel are O(1) and a tick only visits one slot.
+    Deadlines are rounded up to TIMER_TICK_MS and never expire early.
+*/
+class GSMTimerWheel {
+
+public:
+    GSMTimerWheel();
+
+    /** (Re)arm timer to expire in ms, 0 expires it at once
+    */
+    void arm(GSMTimer& timer, unsigned long ms);
+    void cancel(GSMTimer& timer);
+
+    /** Expire the timers that are due and run their callbacks
+      @return number of timers expired
+    */
+    uint8_t poll();
+
+    /** ms until the earliest armed timer expires, (unsigned long)-1 if none is armed,
+        to sleep the MCU meanwhile
+    */
+    unsigned long nextExpiry();
+    uint8_t count();
+
+private:
+    GSMTimer* _slots[TIMER_WHEEL_SLOTS];
+    uint32_t _tick;
+    unsigned long _tickMillis;  //start of _tick
+    uint8_t _count;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "GSMTrace.h"
+
+#ifdef GSM_TRACE
+
+static const char TRACE_NAME_MODEM_INIT[] PROGMEM = "INIT";
+static const char TRACE_NAME_AUTOSENSE[] PROGMEM = "AUTOSENSE";
+static const char TRACE_NAME_GSM[] PROGMEM = "GSM";
+static const char TRACE_NAME_GPRS[] PROGMEM = "GPRS";
+static const char TRACE_NAME_DNS[] PROGMEM = "DNS";
+static const char TRACE_NAME_CONNECT[] PROGMEM = "CONNECT";
+
+static const char* const TRACE_NAMES[TRACE_PHASES] = {
+    TRACE_NAME_MODEM_INIT,
+    TRACE_NAME_AUTOSENSE,
+    TRACE_NAME_GSM,
+    TRACE_NAME_GPRS,
+    TRACE_NAME_DNS,
+    TRACE_NAME_CONNECT
+};
+
+GSMTraceEvent GSMTrace::_events[TRACE_EVENTS_MAX];
+uint16_t GSMTrace::_count = 0;
+uint16_t GSMTrace::_dropped = 0;
+
+void GSMTrace::mark(GSMTracePhase phase, uint8_t step)
+{
+    if (_count >= TRACE_EVENTS_MAX){
+        _dropped++;
+        return;
+    }
+    _events[_count].millis = millis();
+    _events[_count].phase = phase;
+    _events[_count].step = step;
+    _count++;
+}
+
+void GSMTrace::clear()
+{
+    _count = 0;
+    _dropped = 0;
+}
+
+uint16_t GSMTrace::count()
+{
+    return _count;
+}
+
+uint16_t GSMTrace::dropped()
+{
+    return _dropped;
+}
+
+const GSMTraceEvent& GSMTrace::event(uint16_t i)
+{
+    return _events[i];
+}
+
+uint32_t GSMTrace::duration(GSMTracePhase phase)
+{
+    uint32_t total = 0;
+    for (uint16_t i = 0; i + 1 < _count; i++){
+        if (_events[i].phase == phase){
+            total += _events[i + 1].millis - _events[i].millis;
+        }
+    }
+    return total;
+}
+
+void GSMTrace::print(Print& out)
+{
+    if (_count == 0){
+        return;
+    }
+    uint32_t start = _events[0].millis;
+
+    //timeline: offset from the first event, phase, step
+    for (uint16_t i = 0; i < _count; i++){
+        out.print(_events[i].millis - start);
+        out.print(F(" ms "));
+        out.print(TRACE_NAMES[_events[i].phase]);
+        out.print(' ');
+        out.println(_events[i].step);
+    }
+    if (_dropped > 0){
+        out.print(_dropped);
+        out.println(F(" events dropped"));
+    }
+
+    //summary: time and number of events of every phase
+    for (uint8_t p = 0; p < TRACE_PHASES; p++){
+        uint16_t events = 0;
+        for (uint16_t i = 0; i < _count; i++){
+            if (_events[i].phase == p) events++;
+        }
+        if (events == 0){
+            continue;
+        }
+        out.print(TRACE_NAMES[p]);
+        out.print(F(": "));
+        out.print(duration((GSMTracePhase)p));
+        out.print(F(" ms, "));
+        out.print(events);
+        out.println(F(" events"));
+    }
+    out.print(F("total: "));
+    out.print(_events[_count - 1].millis - start);
+    out.println(F(" ms"));
+}
+
+#endif
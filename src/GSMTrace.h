@@ -0,0 +1,64 @@
+#ifndef _GSM_TRACE_H_INCLUDED
+#define _GSM_TRACE_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "modem.h"
+
+/* Startup tracing, enabled by defining GSM_TRACE in modem.h.
+
+    Every phase of the init -> attach -> connect path records a timestamped event:
+    the phase, and a step within it (state machine state, retry number, start/end).
+    print() writes the timeline and a per-phase summary, where each interval between two
+    events is accounted to the phase of the earlier one. Without GSM_TRACE the TRACE()
+    calls compile to nothing.
+*/
+
+enum GSMTracePhase {
+    TRACE_MODEM_INIT,   //step 0 start, 1 done, 2 failed
+    TRACE_AUTOSENSE,    //step: attempt
+    TRACE_GSM,          //step: GSM::ready() state entered
+    TRACE_GPRS,         //step: GPRS::ready() state entered
+    TRACE_DNS,          //step 0 query, 1 resolved, 2 failed
+    TRACE_CONNECT,      //step 0 CIPSTART, 1 connected, 2 failed
+    TRACE_PHASES
+};
+
+#ifdef GSM_TRACE
+
+#define TRACE_EVENTS_MAX 64 //later events are counted but dropped
+
+struct GSMTraceEvent {
+    uint32_t millis;
+    uint8_t phase;
+    uint8_t step;
+};
+
+class GSMTrace {
+
+public:
+    static void mark(GSMTracePhase phase, uint8_t step);
+    static void clear();
+
+    static uint16_t count();
+    static uint16_t dropped();
+    static const GSMTraceEvent& event(uint16_t i);
+
+    /** Time accounted to phase, in ms
+    */
+    static uint32_t duration(GSMTracePhase phase);
+
+    static void print(Print& out);
+
+private:
+    static GSMTraceEvent _events[TRACE_EVENTS_MAX];
+    static uint16_t _count;
+    static uint16_t _dropped;
+};
+
+#define TRACE(phase, step) GSMTrace::mark(phase, step)
+#else
+#define TRACE(phase, step)
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+#include <math.h>
+
+#include "GSMTrack.h"
+
+#define TRACK_CM_PER_E7_DEG 1.1131949f //1e-7 degrees of latitude in cm
+
+static uint16_t putVarint(uint8_t* out, uint32_t value)
+{
+    uint16_t n = 0;
+    while (value >= 0x80){
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+GSMTrack::GSMTrack(GSMLocation& location, uint16_t tolerance_m):
+    _location(&location),
+    _tolerance(tolerance_m),
+    _interval(TRACK_INTERVAL_FAST_S),
+    _lastCourse(0),
+    _windowLen(0),
+    _keptLen(0)
+{
+}
+
+bool GSMTrack::poll()
+{
+    //a cell fallback location leaves fix() at the last, stale, GNSS fix
+    if (!_location->available() || _location->source() != LOCATION_GNSS){
+        return false;
+    }
+    const NmeaFix& fix = _location->fix();
+    adapt(fix);
+
+    TrackPoint point;
+    point.latitude = fix.latitude;
+    point.longitude = fix.longitude;
+    point.time = _location->parser().epoch();
+    return add(point);
+}
+
+void GSMTrack::adapt(const NmeaFix& fix)
+{
+    uint16_t turn = fix.course > _lastCourse ? fix.course - _lastCourse : _lastCourse - fix.course;
+    if (turn > 18000) turn = 36000 - turn;
+    _lastCourse = fix.course;
+
+    uint8_t interval;
+    if (fix.speed >= TRACK_SPEED_FAST_CMS || (fix.speed >= TRACK_SPEED_PARKED_CMS && turn >= TRACK_TURN_CDEG)){
+        interval = TRACK_INTERVAL_FAST_S;
+    }
+    else if (fix.speed >= TRACK_SPEED_PARKED_CMS){
+        interval = TRACK_INTERVAL_SLOW_S;
+    }
+    else{
+        interval = TRACK_INTERVAL_PARKED_S;
+    }
+
+    if (interval != _interval && _location->set(true, interval)){
+        DBG("#DEBUG# GNSS report interval ", interval, " s");
+        _interval = interval;
+    }
+}
+
+bool GSMTrack::add(const TrackPoint& point)
+{
+    if (_windowLen == 0){
+        _window[0] = point;
+        _windowLen = 1;
+        return keep(point);
+    }
+
+    //would the segment anchor -> point still describe the buffered fixes?
+    for (uint8_t i = 1; i < _windowLen; i++){
+        if (deviation(_window[0], point, _window[i]) > _tolerance){
+            //no: the last buffered fix becomes the new anchor
+            bool kept = keep(_window[_windowLen - 1]);
+            _window[0] = _window[_windowLen - 1];
+            _window[1] = point;
+            _windowLen = 2;
+            return kept;
+        }
+    }
+
+    _window[_windowLen++] = point;
+    if (_windowLen == TRACK_WINDOW){
+        return flush();
+    }
+    return false;
+}
+
+bool GSMTrack::flush()
+{
+    if (_windowLen < 2){
+        return false;
+    }
+    bool kept = keep(_window[_windowLen - 1]);
+    _window[0] = _window[_windowLen - 1];
+    _windowLen = 1;
+    return kept;
+}
+
+bool GSMTrack::keep(const TrackPoint& point)
+{
+    if (_keptLen == TRACK_KEPT_MAX){
+        DBG("#DEBUG# track full, point dropped");
+        return false;
+    }
+    _kept[_keptLen++] = point;
+    return true;
+}
+
+//distance in meters of p from the segment a-b, on a local flat projection
+float GSMTrack::deviation(const TrackPoint& a, const TrackPoint& b, const TrackPoint& p)
+{
+    float scale = cosf(a.latitude * (float)(M_PI / 180e7));
+    float bx = (b.longitude - a.longitude) * scale * TRACK_CM_PER_E7_DEG / 100;
+    float by = (b.latitude - a.latitude) * TRACK_CM_PER_E7_DEG / 100;
+    float px = (p.longitude - a.longitude) * scale * TRACK_CM_PER_E7_DEG / 100;
+    float py = (p.latitude - a.latitude) * TRACK_CM_PER_E7_DEG / 100;
+
+    float len2 = bx * bx + by * by;
+    float t = len2 > 0 ? (px * bx + py * by) / len2 : 0;
+    if (t < 0) t = 0;
+    else if (t > 1) t = 1;
+    float dx = px - t * bx;
+    float dy = py - t * by;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+uint8_t GSMTrack::count()
+{
+    return _keptLen;
+}
+
+const TrackPoint& GSMTrack::point(uint8_t i)
+{
+    return _kept[i];
+}
+
+void GSMTrack::clear()
+{
+    _keptLen = 0;
+}
+
+uint8_t GSMTrack::reportInterval()
+{
+    return _interval;
+}
+
+uint16_t GSMTrack::encode(ByteSink& sink)
+{
+    //count, then lat/lon/time of the first point and zigzag deltas of the others
+    uint8_t buf[16];
+    uint16_t total = 0;
+    uint16_t n = putVarint(buf, _keptLen);
+    if (sink.write(buf, n) != n) return 0;
+    total += n;
+
+    TrackPoint last = {0, 0, 0};
+    for (uint8_t i = 0; i < _keptLen; i++){
+        const TrackPoint& p = _kept[i];
+        n = putVarint(buf, zigzag(p.latitude - last.latitude));
+        n += putVarint(buf + n, zigzag(p.longitude - last.longitude));
+        n += putVarint(buf + n, i == 0 ? p.time : p.time - last.time);
+        if (sink.write(buf, n) != n) return 0;
+        total += n;
+        last = p;
+    }
+    return total;
+}
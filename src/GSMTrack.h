@@ -0,0 +1,85 @@
+#ifndef _GSM_TRACK_H_INCLUDED
+#define _GSM_TRACK_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "GSMLocation.h"
+#include "GSMSink.h"
+
+#define TRACK_WINDOW 16 //fixes buffered by the simplification filter
+#define TRACK_KEPT_MAX 32 //points kept until encode() and clear()
+
+#define TRACK_INTERVAL_PARKED_S 30
+#define TRACK_INTERVAL_SLOW_S 5
+#define TRACK_INTERVAL_FAST_S 1
+#define TRACK_SPEED_PARKED_CMS 50   //below this the asset is considered parked
+#define TRACK_SPEED_FAST_CMS 800    //above this, or when turning, report every second
+#define TRACK_TURN_CDEG 1500        //course change (x100 degrees) considered a turn
+
+struct TrackPoint {
+    int32_t latitude;   //1e-7 degrees
+    int32_t longitude;  //1e-7 degrees
+    uint32_t time;      //UTC seconds since 1970
+};
+
+/* Motion aware GNSS sampler.
+
+    Every fix read from GSMLocation adjusts the AT+GPSRD report interval: slow when parked,
+    fast when moving quickly or turning. Fixes go through a bounded window line
+    simplification filter (Douglas-Peucker style): a point is kept only when dropping it
+    would move the track by more than the tolerance, or when the window is full.
+    Kept points are delta encoded (zigzag varints) so that an upload costs a few bytes per
+    point instead of a full fix.
+*/
+class GSMTrack {
+
+public:
+    GSMTrack(GSMLocation& location, uint16_t tolerance_m = 10);
+
+    /** Read a new GNSS fix from location if available, adapt the report interval and filter
+        it; cell based locations are skipped
+      @return true if a point has been kept
+    */
+    bool poll();
+
+    /** Add a fix by hand
+      @return true if a point has been kept. Once TRACK_KEPT_MAX points are kept,
+              new ones are dropped until clear()
+    */
+    bool add(const TrackPoint& point);
+
+    /** Emit the last buffered point, e.g. before an upload
+    */
+    bool flush();
+
+    /** Points kept so far, oldest first
+    */
+    uint8_t count();
+    const TrackPoint& point(uint8_t i);
+    void clear();
+
+    /** Delta encode the kept points: first point absolute, then differences
+      @return bytes written, 0 if the sink is full
+    */
+    uint16_t encode(ByteSink& sink);
+
+    uint8_t reportInterval();
+
+private:
+    void adapt(const NmeaFix& fix);
+    bool keep(const TrackPoint& point);
+    static float deviation(const TrackPoint& a, const TrackPoint& b, const TrackPoint& p);
+
+    GSMLocation* _location;
+    uint16_t _tolerance;
+    uint8_t _interval;
+    uint16_t _lastCourse;
+
+    TrackPoint _window[TRACK_WINDOW]; //_window[0] is the anchor, the last kept point
+    uint8_t _windowLen;
+
+    TrackPoint _kept[TRACK_KEPT_MAX];
+    uint8_t _keptLen;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef ARDUINO
+
+#include <atomic>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+static HostPinHook pinHook = NULL;
+
+static uint64_t monotonicMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static uint64_t startMicros = monotonicMicros();
+static std::atomic<uint64_t> skippedMicros(0);
+
+unsigned long millis()
+{
+    return (monotonicMicros() - startMicros + skippedMicros) / 1000;
+}
+
+unsigned long micros()
+{
+    return monotonicMicros() - startMicros + skippedMicros;
+}
+
+void advanceHostMillis(unsigned long ms)
+{
+    skippedMicros += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    struct timespec ts = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void delay(unsigned long ms)
+{
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void yield()
+{
+}
+
+void setHostPinHook(HostPinHook hook)
+{
+    pinHook = hook;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pinHook != NULL) {
+        pinHook(pin, value);
+    }
+}
+
+size_t Print::printf(const char* fmt, ...)
+{
+    char buf[32];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return len > 0 ? write(reinterpret_cast<const uint8_t*>(buf), strlen(buf)) : 0;
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buf, size_t len)
+{
+    size_t n = 0;
+    while (n < len) {
+        int c = timedRead();
+        if (c < 0) break;
+        buf[n++] = c;
+    }
+    return n;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buf, size_t len)
+{
+    size_t n = 0;
+    while (n < len) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) break;
+        buf[n++] = c;
+    }
+    return n;
+}
+
+static speed_t toSpeed(unsigned long baud)
+{
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B115200;
+    }
+}
+
+Uart::Uart(const char* device):
+    _device(device),
+    _fd(-1),
+    _flowControl(false),
+    _head(0),
+    _tail(0)
+{
+}
+
+Uart::~Uart()
+{
+    end();
+}
+
+void Uart::setDevice(const char* device)
+{
+    _device = device;
+}
+
+void Uart::setFlowControl(bool on)
+{
+    _flowControl = on;
+}
+
+void Uart::begin(unsigned long baud)
+{
+    end();
+    _fd = open(_device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0) {
+        perror(_device);
+        return;
+    }
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        if (_flowControl) tio.c_cflag |= CRTSCTS;
+        else tio.c_cflag &= ~CRTSCTS;
+        cfsetispeed(&tio, toSpeed(baud));
+        cfsetospeed(&tio, toSpeed(baud));
+        tcsetattr(_fd, TCSANOW, &tio);
+    }
+    tcflush(_fd, TCIOFLUSH);
+    _head = _tail = 0;
+}
+
+void Uart::end()
+{
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _head = _tail = 0;
+}
+
+bool Uart::fill()
+{
+    if (_head != _tail || _fd < 0) {
+        return _head != _tail;
+    }
+    ssize_t n = ::read(_fd, _rx, sizeof(_rx));
+    if (n <= 0) {
+        return false; //EAGAIN: nothing yet
+    }
+    _head = 0;
+    _tail = n;
+    return true;
+}
+
+int Uart::available()
+{
+    fill();
+    return _tail - _head;
+}
+
+int Uart::read()
+{
+    return fill() ? _rx[_head++] : -1;
+}
+
+int Uart::peek()
+{
+    return fill() ? _rx[_head] : -1;
+}
+
+size_t Uart::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t Uart::write(const uint8_t* buf, size_t len)
+{
+    size_t done = 0;
+    while (_fd >= 0 && done < len) {
+        ssize_t n = ::write(_fd, buf + done, len - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            break;
+        } else {
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            ::poll(&pfd, 1, 100); //output buffer full, wait for room
+        }
+    }
+    return done;
+}
+
+void Uart::flush()
+{
+    if (_fd >= 0) {
+        tcdrain(_fd);
+    }
+}
+
+int Uart::fd()
+{
+    return _fd;
+}
+
+int Uart::buffered()
+{
+    return _tail - _head;
+}
+
+size_t HostConsole::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stderr);
+}
+
+size_t HostConsole::write(const uint8_t* buf, size_t len)
+{
+    return fwrite(buf, 1, len, stderr);
+}
+
+static const char* defaultDevice()
+{
+    const char* device = getenv("A9G_SERIAL");
+    return device != NULL ? device : "/dev/ttyUSB0";
+}
+
+HostConsole SerialUSB;
+Uart Serial1(defaultDevice());
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef _HOST_ARDUINO_H_INCLUDED
+#define _HOST_ARDUINO_H_INCLUDED
+
+/* Arduino API subset for building the library on POSIX hosts (Linux gateways, tests).
+    Put this directory first on the include path (the top-level CMakeLists.txt does); Arduino
+    builds never see it.
+    Serial ports are termios file descriptors, time comes from CLOCK_MONOTONIC.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+#define PROGMEM
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+unsigned long millis();
+unsigned long micros();
+//tests only: move millis() and micros() forward without waiting
+void advanceHostMillis(unsigned long ms);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+//no GPIO on the host: pin changes go to the hook, if any, e.g. a USB relay or a simulator
+typedef void (*HostPinHook)(uint8_t pin, uint8_t value);
+void setHostPinHook(HostPinHook hook);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class String {
+
+public:
+    String(const char* s = "") : _s(s != NULL ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(double v, unsigned char decimals = 2) { char buf[32]; snprintf(buf, sizeof(buf), "%.*f", decimals, v); _s = buf; }
+
+    void reserve(unsigned int size) { _s.reserve(size); }
+    unsigned int length() const { return _s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(long v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator!=(const String& s) const { return _s != s._s; }
+    bool equals(const String& s) const { return _s == s._s; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool startsWith(const String& prefix, unsigned int offset) const
+    {
+        return offset <= _s.size() && _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+    }
+    bool endsWith(const String& suffix) const
+    {
+        return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return find(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return find(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return find(_s.rfind(c)); }
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from < _s.size() && to > from ? String(_s.substr(from, to - from)) : String();
+    }
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+    void trim()
+    {
+        size_t first = _s.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) { _s.clear(); return; }
+        _s = _s.substr(first, _s.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return atof(_s.c_str()); }
+
+private:
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    std::string _s;
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+class Print {
+
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len)
+    {
+        size_t n = 0;
+        while (len--) n += write(*buf++);
+        return n;
+    }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    size_t print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v) { return print((unsigned long)v); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned int v) { return print((unsigned long)v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+    template <typename T>
+    size_t println(T v) { return print(v) + println(); }
+    size_t println() { return print("\r\n"); }
+
+private:
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(char* buf, size_t len);
+    size_t readBytes(uint8_t* buf, size_t len) { return readBytes(reinterpret_cast<char*>(buf), len); }
+    size_t readBytesUntil(char terminator, char* buf, size_t len);
+
+protected:
+    int timedRead();
+    unsigned long _timeout = 1000;
+};
+
+class HardwareSerial : public Stream {
+
+public:
+    virtual void begin(unsigned long baud) = 0;
+    virtual void end() = 0;
+    using Print::write;
+};
+
+#define UART_RX_BUFFER 512
+
+/* Serial port on a termios device (ttyUSB, ttyACM, pty slave), non-blocking.
+    fd() is valid between begin() and end(), to wait on it with epoll, see HostLoop.h.
+*/
+class Uart : public HardwareSerial {
+
+public:
+    Uart(const char* device);
+    virtual ~Uart();
+
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+    void flush();
+    using Print::write;
+
+    void setDevice(const char* device);
+    /** RTS/CTS, applied by the next begin()
+    */
+    void setFlowControl(bool on);
+    int fd();
+    /** Bytes read from the device but not consumed yet
+    */
+    int buffered();
+
+private:
+    bool fill();
+
+    const char* _device;
+    int _fd;
+    bool _flowControl;
+    uint8_t _rx[UART_RX_BUFFER];
+    uint16_t _head;
+    uint16_t _tail;
+};
+
+/* Debug output of the library (GSM_DEBUG), on stderr
+*/
+class HostConsole : public Print {
+
+public:
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+    using Print::write;
+};
+
+extern HostConsole SerialUSB;
+extern Uart Serial1; //device from the A9G_SERIAL environment variable, /dev/ttyUSB0 if unset
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef ARDUINO
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "HostLoop.h"
+
+HostLoop::HostLoop():
+    _epoll(epoll_create1(EPOLL_CLOEXEC)),
+    _count(0)
+{
+}
+
+HostLoop::~HostLoop()
+{
+    if (_epoll >= 0) {
+        close(_epoll);
+    }
+}
+
+bool HostLoop::add(ModemClass& modem, Uart& uart)
+{
+    if (_epoll < 0 || _count >= HOST_LOOP_MAX_MODEMS || uart.fd() < 0) {
+        return false;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &modem;
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, uart.fd(), &event) != 0) {
+        return false;
+    }
+    _entries[_count].modem = &modem;
+    _entries[_count].uart = &uart;
+    _count++;
+    return true;
+}
+
+void HostLoop::remove(ModemClass& modem)
+{
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].modem == &modem) {
+            if (_entries[i].uart->fd() >= 0) {
+                epoll_ctl(_epoll, EPOLL_CTL_DEL, _entries[i].uart->fd(), NULL);
+            }
+            _entries[i] = _entries[--_count];
+            return;
+        }
+    }
+}
+
+int HostLoop::run(int timeout_ms)
+{
+    //bytes already read from the device do not wake epoll again, timers never do
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].uart->buffered() > 0) {
+            timeout_ms = 0;
+            break;
+        }
+        unsigned long next = _entries[i].modem->timers().nextExpiry();
+        if (next != (unsigned long)-1 && (timeout_ms < 0 || next < (unsigned long)timeout_ms)) {
+            timeout_ms = (int)next;
+        }
+    }
+
+    struct epoll_event events[HOST_LOOP_MAX_MODEMS];
+    int n = epoll_wait(_epoll, events, HOST_LOOP_MAX_MODEMS, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int polled = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        bool ready = _entries[i].uart->buffered() > 0 || _entries[i].modem->timers().nextExpiry() == 0;
+        for (int e = 0; e < n && !ready; e++) {
+            ready = events[e].data.ptr == _entries[i].modem;
+        }
+        if (ready) {
+            _entries[i].modem->poll();
+            polled++;
+        }
+    }
+    return polled;
+}
+
+HostPty::HostPty():
+    _master(-1)
+{
+    _slave[0] = '\0';
+}
+
+HostPty::~HostPty()
+{
+    if (_master >= 0) {
+        close(_master);
+    }
+}
+
+bool HostPty::open()
+{
+    _master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (_master < 0 || grantpt(_master) != 0 || unlockpt(_master) != 0) {
+        return false;
+    }
+    if (ptsname_r(_master, _slave, sizeof(_slave)) != 0) {
+        return false;
+    }
+    struct termios tio;
+    if (tcgetattr(_master, &tio) == 0) {
+        cfmakeraw(&tio); //no echo or line discipline on the simulator side
+        tcsetattr(_master, TCSANOW, &tio);
+    }
+    return true;
+}
+
+int HostPty::master()
+{
+    return _master;
+}
+
+const char* HostPty::slave()
+{
+    return _slave;
+}
+
+#endif
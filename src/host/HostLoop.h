@@ -0,0 +1,59 @@
+#ifndef _HOST_LOOP_H_INCLUDED
+#define _HOST_LOOP_H_INCLUDED
+
+#include <Arduino.h>
+
+#include "../modem.h"
+
+#define HOST_LOOP_MAX_MODEMS 16
+
+/* Event loop for POSIX hosts: sleeps in epoll until one of the modem serial ports has bytes
+    or the next timer of a modem is due, then runs poll() on that modem only, so idle modems
+    cost no CPU. Commands themselves still wait for their response in waitForResponse().
+*/
+class HostLoop {
+
+public:
+    HostLoop();
+    ~HostLoop();
+
+    /** Watch uart, which has to be begun (ModemClass::init())
+    */
+    bool add(ModemClass& modem, Uart& uart);
+    void remove(ModemClass& modem);
+
+    /** Wait up to timeout_ms (-1 forever) for modem bytes or timers, and poll the modems
+        that got some bytes or have timers due; the wait never outlasts the nearest timer
+      @return number of modems polled, -1 on error
+    */
+    int run(int timeout_ms);
+
+private:
+    struct Entry {
+        ModemClass* modem;
+        Uart* uart;
+    };
+
+    int _epoll;
+    Entry _entries[HOST_LOOP_MAX_MODEMS];
+    uint8_t _count;
+};
+
+/* Pseudo terminal for running the library against a simulated modem: the library opens
+    slave() as its serial device, the simulator reads and writes master().
+*/
+class HostPty {
+
+public:
+    HostPty();
+    ~HostPty();
+    bool open();
+    int master();
+    const char* slave();
+
+private:
+    int _master;
+    char _slave[64];
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef _HOST_IPADDRESS_H_INCLUDED
+#define _HOST_IPADDRESS_H_INCLUDED
+
+#include "Arduino.h"
+
+class IPAddress {
+
+public:
+    IPAddress() { memset(_bytes, 0, sizeof(_bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+
+    bool fromString(const String& address) { return fromString(address.c_str()); }
+    bool fromString(const char* address)
+    {
+        unsigned int a, b, c, d;
+        char end;
+        if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+    operator uint32_t() const
+    {
+        uint32_t address;
+        memcpy(&address, _bytes, sizeof(address));
+        return address;
+    }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t& operator[](int index) { return _bytes[index]; }
+
+private:
+    uint8_t _bytes[4];
+};
+
+#endif
@@ -1,24 +1,70 @@
-#include "Modem.h"
+#include "modem.h"
 #include "socket.h"
+#include "GSMTrace.h"
 
 ModemClass::ModemClass(Uart& uart, unsigned long baud):
     _uart(&uart),
     _baud(baud),
+    _pwrPin(&GSM_PWR_PIN),
+    _rstPin(&GSM_RST_PIN),
+    _lowPwrPin(&GSM_LOW_PWR_PIN),
     _lowPowerMode(false),
+    _awake(true),
+    _awakeHolds(0),
+    _wakeCount(0),
+    _awakeSince(0),
+    _awakeMillis(0),
+    _subsystem(SUBSYSTEM_GSM),
+    _wakeSubsystem(SUBSYSTEM_GSM),
+    _gnssSince(0),
+    _gnssOn(false),
     _lastResponseOrUrcMillis(0),
     _init(false),
+    _initSocks(0),
+    _urcState(URC_IDLE),
+    _atCommandState(AT_IDLE),
     _ready(1),
 	_sent(false),
     _responseDataStorage(NULL),
-    _initSocks(0),
-    _atCommandState(AT_IDLE)
-
+    _profileStore(NULL),
+    _dataMode(false),
+    _dataClosed(false),
+    _dataLen(0),
+    _dataHeld(0),
+    _dataMillis(0)
 {
     _buffer.reserve(64); //reserve 64 chars
+    memset(&_usage, 0, sizeof(_usage));
 }
 
+ModemClass::ModemClass(Uart& uart, unsigned long baud, uint8_t pwrPin, uint8_t rstPin, uint8_t lowPwrPin):
+    ModemClass(uart, baud)
+{
+    _pins[0] = pwrPin;
+    _pins[1] = rstPin;
+    _pins[2] = lowPwrPin;
+    _pwrPin = &_pins[0];
+    _rstPin = &_pins[1];
+    _lowPwrPin = &_pins[2];
+}
 
-//Copy this code before calling init()
+uint8_t ModemClass::pwrPin()
+{
+    return *_pwrPin;
+}
+
+uint8_t ModemClass::rstPin()
+{
+    return *_rstPin;
+}
+
+uint8_t ModemClass::lowPwrPin()
+{
+    return *_lowPwrPin;
+}
+
+
+//Copy this code before calling init(), with MODEM.pwrPin()... for modems with pins of their own
 
 /*
         pinMode(GSM_PWR_PIN, OUTPUT);
@@ -35,48 +81,127 @@ ModemClass::ModemClass(Uart& uart, unsigned long baud):
 
 */
 
+#ifdef GSM_DEBUG
+#define MODEM_CMEE_LEVEL 2 //verbose error codes
+#else
+#define MODEM_CMEE_LEVEL 0 //no error codes
+#endif
+#define MODEM_PROFILE_AUTOSENSE_MS 2000
+#define MODEM_BAUD_AUTOSENSE_MS 1000
+#define MODEM_ECHO_PAYLOAD_LEN 64
+#define MODEM_ECHO_ROUNDS 4
+#define MODEM_ECHO_TIMEOUT_MS 500 //ATE0/ATE1 answer
+
+#define MODEM_ESCAPE_GUARD_MS 1100 //the escape sequence needs 1 s of silence around it
+#define MODEM_DATA_CLOSE_GAP_MS 50 //a close line comes in one piece, held bytes are payload after this
+
+//printed by the modem when the peer closes a transparent connection
+static const char* const DATA_CLOSE_LINES[] = {"\r\nCLOSED\r\n", "\r\nNO CARRIER\r\n"};
+#define DATA_CLOSE_LINE_MAX 14
+
+static const unsigned long MODEM_BAUD_RATES[] = {115200, 230400, 460800, 921600};
+
 bool ModemClass::init()
 {
     if(!_init){
-        _uart->begin(_baud > 115200 ? 115200 : _baud);
-
-        send(F("ATV1")); //set verbose mode
-        if(waitForResponse() != 1) return false;
-
-        if (!autosense()){
+        TRACE(TRACE_MODEM_INIT, 0);
+        if (!initSequence()){
+            TRACE(TRACE_MODEM_INIT, 2);
             return false;
         }
+        TRACE(TRACE_MODEM_INIT, 1);
+        _init = true;
+    }
+    return true;
+}
 
-        #ifdef GSM_DEBUG
-        send(F("AT+CMEE=2"));  // turn on verbose error codes
-        #else
-        send(F("AT+CMEE=0"));  // turn off error codes
-        #endif
-        if(waitForResponse() != 1) return false;
-
-        send(F("AT+CIPSPRT=0")); //turn off TCP prompt ">" 
-        waitForResponse();
-        
-        //check if baud can be set higher than default 115200
-
-        if (_baud > 115200){
-            sendf("AT+IPR=%ld", _baud);
-            if (waitForResponse() != 1){
-                return false;
+bool ModemClass::initSequence()
+{
+    uint32_t hash = 0;
+    uint32_t stored;
+    if (_profileStore != NULL){
+        hash = profileHash();
+        if (_profileStore->load(stored) && stored == hash){
+            //the modem boots with the saved profile, already at _baud; at 115200 autosense
+            //also answers after a factory reset, so one saved setting is checked as well
+            _uart->begin(_baud);
+            if (autosense(MODEM_PROFILE_AUTOSENSE_MS) && profileSaved()){
+                return true;
             }
+            DBG("#DEBUG# saved profile lost, applying it again");
             _uart->end();
-            delay(100);
-            _uart->begin(_baud);
+        }
+    }
 
-            if (!autosense()){
-                return false;
-            }
+    _uart->begin(_baud > 115200 ? 115200 : _baud);
+
+    send(F("ATV1")); //set verbose mode
+    if(waitForResponse() != 1) return false;
+
+    if (!autosense()){
+        return false;
+    }
+
+    sendf("AT+CMEE=%d", MODEM_CMEE_LEVEL);
+    if(waitForResponse() != 1) return false;
+
+    send(F("AT+CIPSPRT=0")); //turn off TCP prompt ">" 
+    waitForResponse();
+    
+    //check if baud can be set higher than default 115200
+
+    if (_baud > 115200){
+        sendf("AT+IPR=%ld", _baud);
+        if (waitForResponse() != 1){
+            return false;
+        }
+        _uart->end();
+        delay(100);
+        _uart->begin(_baud);
+
+        if (!autosense()){
+            return false;
+        }
+    }
+
+    if (_profileStore != NULL){
+        send(F("AT&W"));
+        if (waitForResponse(1000) == 1){
+            _profileStore->save(hash);
         }
-        _init = true;
     }
     return true;
 }
 
+bool ModemClass::profileSaved()
+{
+    String response;
+    send(F("AT+CIPSPRT?"));
+    if (waitForResponse(100, &response) != 1){
+        return false;
+    }
+    int i = response.indexOf("+CIPSPRT:");
+    return i != -1 && atoi(response.c_str() + i + 9) == 0; //the default is 1
+}
+
+uint32_t ModemClass::profileHash()
+{
+    //FNV-1a of every setting applied by init(), bump the version when init() changes
+    char config[48];
+    snprintf(config, sizeof(config), "1;V1;CMEE=%d;CIPSPRT=0;IPR=%lu", MODEM_CMEE_LEVEL, _baud);
+    uint32_t hash = 2166136261UL;
+    for (const char* c = config; *c; c++){
+        hash ^= (uint8_t)*c;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void ModemClass::setProfileStore(ModemProfileStore* store)
+{
+    _profileStore = store;
+}
+
 bool ModemClass::restart()
 {
     if(_init){
@@ -90,6 +215,9 @@ bool ModemClass::restart()
 
 bool ModemClass::factoryReset()
 {
+    if (_profileStore != NULL){
+        _profileStore->save(0); //the saved profile is overwritten
+    }
     send(F("AT&FZ&W"));
     return waitForResponse(1000) == 1;
 }
@@ -106,9 +234,64 @@ bool ModemClass::powerOff()
     return true;
 }
 
+ModemProbe::ModemProbe():
+    valid(false),
+    simReady(false),
+    creg(4),
+    attached(false),
+    pdpActive(false)
+{
+}
+
+void ModemProbe::parse(const char* response)
+{
+    //the batch answers with one OK, or a single error if any of the commands failed
+    const char* p;
+    simReady = strstr(response, "+CPIN:") != NULL && strstr(response, "READY") != NULL;
+    creg = 4;
+    if ((p = strstr(response, "+CREG:")) != NULL){
+        const char* comma = strchr(p, ',');
+        const char* eol = strchr(p, '\n');
+        if (comma != NULL && (eol == NULL || comma < eol)){
+            creg = atoi(comma + 1); //+CREG: <n>,<stat>
+        }
+    }
+    attached = (p = strstr(response, "+CGATT:")) != NULL && atoi(p + 7) == 1;
+    pdpActive = strstr(response, "IP GPRSACT") != NULL || strstr(response, "IP STATUS") != NULL
+                || strstr(response, "IP PROCESSING") != NULL;
+    valid = true;
+}
+
+bool ModemProbe::registered()
+{
+    return valid && (creg == 1 || creg == 5);
+}
+
+bool ModemClass::probe(unsigned long timeout)
+{
+    String response;
+    _probe = ModemProbe();
+    send(PROBE_COMMAND);
+    if (waitForResponse(timeout, &response) != 1){
+        return false; //cold modem or no SIM, go through every step
+    }
+    _probe.parse(response.c_str());
+    return true;
+}
+
+ModemProbe& ModemClass::lastProbe()
+{
+    return _probe;
+}
+
 bool ModemClass::autosense(unsigned int timeout)
 {
-    for (unsigned long start = millis(); (millis() - start) < timeout;){
+    #ifdef GSM_TRACE
+    uint8_t attempt = 0;
+    #endif
+    GSMTimer deadline;
+    for (_timers.arm(deadline, timeout); !deadline.expired();){
+        TRACE(TRACE_AUTOSENSE, attempt++);
         if (noop() == 1){
             return true;
         }
@@ -126,28 +309,180 @@ bool ModemClass::noop()
 void ModemClass::lowPowerMode()
 {
     _lowPowerMode = true;
-    digitalWrite(GSM_LOW_PWR_PIN, LOW);
+    sleep();
 }
 
 void ModemClass::noLowPowerMode()
 {
+    wake();
     _lowPowerMode = false;
-    digitalWrite(GSM_LOW_PWR_PIN, HIGH);
+}
+
+void ModemClass::wake()
+{
+    if (_lowPowerMode && !_awake){
+        digitalWrite(*_lowPwrPin, HIGH);
+        delay(5);
+        _awake = true;
+        _awakeSince = millis();
+        _wakeSubsystem = _subsystem;
+        _wakeCount++;
+    }
+}
+
+void ModemClass::sleep()
+{
+    if (_lowPowerMode && _awake && _awakeHolds == 0){
+        digitalWrite(*_lowPwrPin, LOW);
+        _awake = false;
+        _awakeMillis += millis() - _awakeSince;
+        _usage.awakeMillis[_wakeSubsystem] += millis() - _awakeSince;
+    }
+}
+
+void ModemClass::holdAwake()
+{
+    wake();
+    _awakeHolds++;
+}
+
+void ModemClass::releaseAwake()
+{
+    if (_awakeHolds > 0 && --_awakeHolds == 0 && _ready != 0){
+        sleep(); //with a command in flight the response puts it to sleep
+    }
+}
+
+bool ModemClass::awake()
+{
+    return _awake;
+}
+
+uint32_t ModemClass::wakeCount()
+{
+    return _wakeCount;
+}
+
+unsigned long ModemClass::awakeTime()
+{
+    return _awakeMillis + (_awake ? millis() - _awakeSince : 0);
+}
+
+void ModemClass::resetPowerStats()
+{
+    _wakeCount = 0;
+    _awakeMillis = 0;
+    _awakeSince = millis();
+}
+
+struct SubsystemPrefix {
+    const char* prefix;
+    ModemSubsystem subsystem;
+};
+
+static const char PREFIX_CIP[] PROGMEM = "AT+CIP";
+static const char PREFIX_CDNS[] PROGMEM = "AT+CDNS";
+static const char PREFIX_CGATT[] PROGMEM = "AT+CGATT";
+static const char PREFIX_CSTT[] PROGMEM = "AT+CSTT";
+static const char PREFIX_ATO[] PROGMEM = "ATO";
+static const char PREFIX_GPS[] PROGMEM = "AT+GPS";
+static const char PREFIX_AGPS[] PROGMEM = "AT+AGPS";
+static const char PREFIX_LOCATION[] PROGMEM = "AT+LOCATION";
+static const char PREFIX_CMG[] PROGMEM = "AT+CMG";
+static const char PREFIX_CNMI[] PROGMEM = "AT+CNMI";
+
+static const SubsystemPrefix SUBSYSTEM_PREFIXES[] = {
+    {PREFIX_CIP, SUBSYSTEM_GPRS},   //CIPSTART, CIPSEND, CIICR...
+    {PREFIX_CDNS, SUBSYSTEM_GPRS},
+    {PREFIX_CGATT, SUBSYSTEM_GPRS},
+    {PREFIX_CSTT, SUBSYSTEM_GPRS},
+    {PREFIX_ATO, SUBSYSTEM_GPRS},
+    {PREFIX_GPS, SUBSYSTEM_LOCATION},
+    {PREFIX_AGPS, SUBSYSTEM_LOCATION},
+    {PREFIX_LOCATION, SUBSYSTEM_LOCATION},
+    {PREFIX_CMG, SUBSYSTEM_SMS},
+    {PREFIX_CNMI, SUBSYSTEM_SMS}
+};
+
+void ModemClass::account(const char* command)
+{
+    _subsystem = SUBSYSTEM_GSM;
+    for (uint8_t i = 0; i < sizeof(SUBSYSTEM_PREFIXES) / sizeof(SUBSYSTEM_PREFIXES[0]); i++){
+        const char* prefix = SUBSYSTEM_PREFIXES[i].prefix;
+        if (strncmp(command, prefix, strlen(prefix)) == 0){
+            _subsystem = SUBSYSTEM_PREFIXES[i].subsystem;
+            break;
+        }
+    }
+    uint16_t len = strlen(command);
+    _usage.commands[_subsystem]++;
+    _usage.bytesOut[_subsystem] += len + 2; //CR LF
+
+    if (strncmp(command, "AT+CIPSEND", 10) == 0){
+        _usage.cipsends++;
+    }
+    else if (strncmp(command, "AT+CIPSTART", 11) == 0){
+        _usage.connects++;
+    }
+    else if (strncmp(command, "AT+GPS=", 7) == 0){
+        bool on = command[7] == '1';
+        if (on && !_gnssOn){
+            _gnssSince = millis();
+        }
+        else if (!on && _gnssOn){
+            _usage.gnssMillis += millis() - _gnssSince;
+        }
+        _gnssOn = on;
+    }
+}
+
+ModemUsage ModemClass::usage()
+{
+    ModemUsage usage = _usage;
+    if (_gnssOn){
+        usage.gnssMillis += millis() - _gnssSince;
+    }
+    if (_lowPowerMode && _awake){
+        usage.awakeMillis[_wakeSubsystem] += millis() - _awakeSince;
+    }
+    return usage;
+}
+
+void ModemClass::resetUsage()
+{
+    memset(&_usage, 0, sizeof(_usage));
+    _gnssSince = millis();
+    resetPowerStats();
 }
 
 bool ModemClass::turnEcho(bool on)
 {
-    sendf("ATE%d", on? 1:0);
-    uint8_t resp = waitForResponse();
-    if (resp != 1){
-        DBG("#DEBUG# setting echo mode failed!");
-        return false;
+    //poll() starts a response from the echo of the command line, and a modem with echo off
+    //answers ATE1 with a bare OK: wait for it on the UART instead
+    poll(); //URCs already received
+    _uart->print(on ? "ATE1\r" : "ATE0\r");
+    _uart->flush();
+
+    String answer;
+    unsigned long start = millis();
+    while (millis() - start < MODEM_ECHO_TIMEOUT_MS){
+        int c = _uart->read();
+        if (c < 0) continue;
+        answer += (char)c;
+        if (answer.endsWith(GSM_OK)){
+            return true;
+        }
+        if (answer.endsWith(GSM_ERROR)){
+            break;
+        }
     }
-    return true;
+    DBG("#DEBUG# setting echo mode failed!");
+    return false;
 }
 
 uint16_t ModemClass::write(uint8_t c)
 {
+    _usage.bytesOut[_subsystem]++;
     //make sure to turn off echo, because this is not intended to be used as a send method!
     //so we don't want the modem to echo back c
    return _uart->write(c);
@@ -155,6 +490,7 @@ uint16_t ModemClass::write(uint8_t c)
 
 uint16_t ModemClass::write(const uint8_t* buf, uint16_t size)
 {
+    _usage.bytesOut[_subsystem] += size;
     //make sure to turn off echo, because this is not intended to be used as a send method!
     //so we don't want the modem to echo back the content of buffer
     return _uart->write(buf, size);
@@ -166,6 +502,12 @@ void ModemClass::flush(){
 
 void ModemClass::send(const char* command)
 {
+    if (_dataMode){
+        DBG("#DEBUG# command dropped in data mode");
+        _ready = 2;
+        return;
+    }
+
     /* The chain Command -> Response shall always be respected and a new command must not be issued
     before the module has terminated all the sending of its response result code (whatever it may be).
     This applies especially to applications that ?sense? the OK text and therefore may send the next
@@ -176,10 +518,8 @@ void ModemClass::send(const char* command)
     command, then at least the 20ms pause time shall be respected.
     */
 
-    if (_lowPowerMode){
-        digitalWrite(GSM_LOW_PWR_PIN, HIGH); //turn off low power mode if on
-        delay(5);
-    }
+    account(command);
+    wake(); //turn off low power mode if on
 
     unsigned long delta = millis() - _lastResponseOrUrcMillis;
     if(delta < MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS){
@@ -194,13 +534,17 @@ void ModemClass::send(const char* command)
     _uart->flush();
 }
 
-void ModemClass::send(__FlashStringHelper* command)
+void ModemClass::send(const __FlashStringHelper* command)
 {
-    if (_lowPowerMode){
-        digitalWrite(GSM_LOW_PWR_PIN, HIGH); //turn off low power mode if on
-        delay(5);
+    if (_dataMode){
+        DBG("#DEBUG# command dropped in data mode");
+        _ready = 2;
+        return;
     }
 
+    account(reinterpret_cast<const char*>(command));
+    wake(); //turn off low power mode if on
+
     // compare the time of the last response or URC and ensure
     // at least 20ms have passed before sending a new command
     unsigned long delta = millis() - _lastResponseOrUrcMillis;
@@ -229,19 +573,25 @@ void ModemClass::sendf(const char *fmt, ...)
 int ModemClass::waitForResponse(unsigned long timeout, String* responseDataStorage)
 {
     _responseDataStorage = responseDataStorage;
-    unsigned long start = millis();
-    while ((millis() - start) < timeout){
+    GSMTimer deadline;
+    _timers.arm(deadline, timeout);
+    while (!deadline.expired()){
         uint8_t r = ready();
         if(r != 0) return r;
     }
     //clean up in case timeout occured
     DBG("#DEBUG# response timeout!");
+    cancel();
+    return -1;
+}
+
+void ModemClass::cancel()
+{
     _responseDataStorage = NULL;
     _ready = 1;
     _atCommandState = AT_IDLE;
 	_sent = false;
     _buffer = ""; //clean buffer in case we got some bytes but didn't complete in time
-    return -1;
 }
 
 uint8_t ModemClass::ready()
@@ -250,12 +600,36 @@ uint8_t ModemClass::ready()
     return _ready;
 }
 
+bool ModemClass::idle()
+{
+    poll();
+    return !_dataMode && _ready != 0 && _urcState == URC_IDLE && _atCommandState == AT_IDLE;
+}
+
+GSMTimerWheel& ModemClass::timers()
+{
+    return _timers;
+}
+
 void ModemClass::poll()
 {
+    _timers.poll();
+    if (_dataMode){
+        return; //payload, not AT framing
+    }
     //DBG("*** POLL");
     while(_uart->available()){
         char c = _uart->read();
         _buffer += c;
+        if (_urcState == URC_RECV_SOCK_CHUNK){
+            _usage.bytesIn[SUBSYSTEM_GPRS]++;
+            if (_sock < MAX_SOCKETS){ //_sock comes from the +CIPRCV header: unknown mux or garbage
+                _usage.socketReceived[_sock]++;
+            }
+        }
+        else{
+            _usage.bytesIn[_subsystem]++;
+        }
         //DBG("#DEBUG BUFFER#", _buffer);
         //DBG("#DEBUG CHAR#", c);
         switch(_atCommandState){
@@ -280,7 +654,9 @@ void ModemClass::poll()
                         case URC_RECV_SOCK_CHUNK:{
                             _buffer = "";
                             //send to correct socket!
-                            _sockets[_sock]->handleUrc(&c, 1);
+                            if (_sock < MAX_SOCKETS && _sockets[_sock] != NULL){
+                                _sockets[_sock]->handleUrc(&c, 1);
+                            }
                             if(--_chunkLen <= 0){
                                 //done receiving chunk
                                 _lastResponseOrUrcMillis = millis();
@@ -331,9 +707,7 @@ void ModemClass::poll()
                 #endif
                 if (_ready != 0){ 
                     _lastResponseOrUrcMillis = millis();
-                    if (_lowPowerMode){ //after receiving the response, bring back low power mode if it were on
-                        digitalWrite(GSM_LOW_PWR_PIN, LOW);
-                    }
+                    sleep(); //after receiving the response, bring back low power mode if it were on
                     #ifdef GSM_DEBUG
                     response.trim();
                     DBG("#DEBUG# response received: \"", response, "\"");
@@ -365,16 +739,37 @@ void ModemClass::checkUrc()
     //############################################################################ UNHANDLED
     else if(_buffer.endsWith("\r\n") && _buffer.length() > 2){
         _lastResponseOrUrcMillis = millis();
-        #ifdef GSM_DEBUG
         //can get URC not starting with \r\n+ but only with +
-        if (_buffer.startsWith("+") || _buffer.startsWith("\r\n+")){
+        _buffer.trim();
+        //the line was accounted to the last command, move it where it belongs
+        ModemSubsystem subsystem = SUBSYSTEM_GSM;
+        if (_buffer.startsWith("+GPSRD") || _buffer.startsWith("$")){
+            subsystem = SUBSYSTEM_LOCATION;
+        }
+        else if (_buffer.startsWith("+CMTI")){
+            subsystem = SUBSYSTEM_SMS;
+        }
+        else if (_buffer.startsWith("+CIP") || _buffer.startsWith("+CDNS")){
+            subsystem = SUBSYSTEM_GPRS;
+        }
+        if (subsystem != _subsystem){
+            uint32_t n = min((uint32_t)_buffer.length() + 2, _usage.bytesIn[_subsystem]);
+            _usage.bytesIn[_subsystem] -= n;
+            _usage.bytesIn[subsystem] += n;
+        }
+        //handlers get the trimmed line and must not send commands from handleUrc
+        for (int i = 0; i < MAX_URC_HANDLERS; i++){
+            if (_urcHandlers[i] != NULL){
+                _urcHandlers[i]->handleUrc(_buffer.c_str(), _buffer.length());
+            }
+        }
+        #ifdef GSM_DEBUG
+        if (_buffer.startsWith("+")){
             //DBG("#DEBUG# sent: ", _sent);
-            _buffer.trim();
-            DBG("#DEBUG# unhandled URC received: \"", _buffer, "\"");
+            DBG("#DEBUG# URC received: \"", _buffer, "\"");
         }
         else {
            // DBG("#DEBUG# sent: ", _sent);
-           _buffer.trim();
            DBG("#DEBUG# unhandled data: \"", _buffer, "\"");
         }
         #endif
@@ -409,11 +804,249 @@ inline bool ModemClass::streamSkipUntil(const char& c, String* save, const uint3
     return false;
 }
 
+bool ModemClass::startDataMode(const char* command, unsigned long timeout)
+{
+    //read the result lines ourselves: poll() would take the payload following CONNECT for URCs
+    send(command);
+    String line;
+    int8_t result = -1;
+    for (unsigned long start = millis(); result == -1 && millis() - start < timeout;){
+        line = "";
+        if (!streamSkipUntil('\n', &line, timeout - (millis() - start))){
+            break;
+        }
+        line.trim();
+        if (line.startsWith("CONNECT FAIL") || line == "NO CARRIER" || line.startsWith("ERROR")
+            || line.startsWith(GSM_CME_ERROR)){
+            result = 0;
+        }
+        else if (line.startsWith("CONNECT")){ //CONNECT or CONNECT <rate>
+            result = 1;
+        }
+    }
+    _sent = false;
+    _atCommandState = AT_IDLE;
+    _buffer = "";
+    _ready = 1;
+    _lastResponseOrUrcMillis = millis();
+    _dataMode = result == 1;
+    _dataClosed = false;
+    _dataLen = 0;
+    _dataHeld = 0;
+    DBG("#DEBUG# data mode ", _dataMode ? "on" : "failed");
+    return _dataMode;
+}
+
+bool ModemClass::escapeDataMode()
+{
+    //payload still arriving until the modem answers OK is discarded
+    delay(MODEM_ESCAPE_GUARD_MS);
+    for (unsigned long start = millis(); _dataMode && (_uart->available() || _dataLen > 0)
+        && millis() - start < MODEM_ESCAPE_GUARD_MS;){
+        pumpData();
+        uint8_t ready = _dataLen - _dataHeld;
+        memmove(_dataIn, _dataIn + ready, _dataHeld);
+        _dataLen = _dataHeld;
+    }
+    if (!_dataMode){
+        return true; //the peer closed meanwhile, the modem is in command mode already
+    }
+    _uart->print("+++");
+    _uart->flush();
+    String line;
+    for (unsigned long start = millis(); millis() - start < 2 * MODEM_ESCAPE_GUARD_MS;){
+        line = "";
+        if (!streamSkipUntil('\n', &line, 2 * MODEM_ESCAPE_GUARD_MS - (millis() - start))){
+            break;
+        }
+        line.trim();
+        if (line == "OK"){
+            _dataMode = false;
+            _dataLen = 0;
+            _dataHeld = 0;
+            _buffer = "";
+            _lastResponseOrUrcMillis = millis();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ModemClass::dataMode()
+{
+    return _dataMode;
+}
+
+void ModemClass::pumpData()
+{
+    //bytes that may start a close line are held back until it is complete or ruled out
+    while (_dataMode && _dataLen < MODEM_DATA_BUFFER && _uart->available()){
+        _dataIn[_dataLen++] = _uart->read();
+        _dataMillis = millis();
+        _dataHeld = 0;
+        for (uint8_t held = min(_dataLen, (uint8_t)DATA_CLOSE_LINE_MAX); held > 0 && _dataHeld == 0; held--){
+            const uint8_t* tail = _dataIn + _dataLen - held;
+            for (uint8_t i = 0; i < sizeof(DATA_CLOSE_LINES) / sizeof(DATA_CLOSE_LINES[0]); i++){
+                uint8_t len = strlen(DATA_CLOSE_LINES[i]);
+                if (held > len || memcmp(tail, DATA_CLOSE_LINES[i], held) != 0){
+                    continue;
+                }
+                if (held == len){
+                    _dataLen -= held;
+                    _dataMode = false;
+                    _dataClosed = true;
+                    _lastResponseOrUrcMillis = millis();
+                    DBG("#DEBUG# data mode closed by the peer");
+                    return;
+                }
+                _dataHeld = held;
+                break;
+            }
+        }
+    }
+    if (_dataHeld > 0 && millis() - _dataMillis >= MODEM_DATA_CLOSE_GAP_MS){
+        _dataHeld = 0;
+    }
+}
+
+int ModemClass::dataAvailable()
+{
+    pumpData();
+    return _dataLen - _dataHeld;
+}
+
+uint16_t ModemClass::dataRead(void* buf, uint16_t len, unsigned long timeout)
+{
+    uint8_t* p = reinterpret_cast<uint8_t*>(buf);
+    uint16_t n = 0;
+    for (unsigned long start = millis(); n < len && (_dataMode || _dataLen > 0) && millis() - start < timeout;){
+        pumpData();
+        uint8_t ready = min((uint16_t)(_dataLen - _dataHeld), (uint16_t)(len - n));
+        memcpy(p + n, _dataIn, ready);
+        memmove(_dataIn, _dataIn + ready, _dataLen - ready);
+        _dataLen -= ready;
+        n += ready;
+    }
+    _usage.bytesIn[SUBSYSTEM_GPRS] += n;
+    _usage.socketReceived[0] += n;
+    return n;
+}
+
 void ModemClass::setBaudRate(unsigned long baud)
 {
     _baud = baud;
 }
 
+unsigned long ModemClass::baudRate()
+{
+    return _baud;
+}
+
+bool ModemClass::setFlowControl(bool on)
+{
+    send(on ? F("AT+IFC=2,2") : F("AT+IFC=0,0"));
+    return waitForResponse() == 1;
+}
+
+bool ModemClass::switchBaud(unsigned long baud)
+{
+    sendf("AT+IPR=%ld", baud);
+    if (waitForResponse() != 1){
+        return false;
+    }
+    _uart->end();
+    delay(100);
+    _uart->begin(baud);
+    return autosense(MODEM_BAUD_AUTOSENSE_MS);
+}
+
+bool ModemClass::echoTest()
+{
+    //the modem echoes the whole line before rejecting the unknown command, so every
+    //printable character goes both ways
+    char line[MODEM_ECHO_PAYLOAD_LEN + 16];
+    for (uint8_t round = 0; round < MODEM_ECHO_ROUNDS; round++){
+        uint8_t len = sprintf(line, "AT+ECHO=\"");
+        for (uint8_t i = 0; i < MODEM_ECHO_PAYLOAD_LEN; i++){
+            char c = ' ' + (round * 31 + i * 7) % 95;
+            line[len++] = (c == '"' || c == '\\') ? '#' : c;
+        }
+        line[len++] = '"';
+        line[len] = '\0';
+
+        while (_uart->available()) _uart->read();
+        _uart->print(line);
+        _uart->print('\r');
+        _uart->flush();
+
+        uint8_t matched = 0;
+        unsigned long start = millis();
+        while (matched < len && millis() - start < 500){
+            int c = _uart->read();
+            if (c < 0) continue;
+            if (c != line[matched]){
+                DBG("#DEBUG# echo test failed in round ", round);
+                delay(50); //let the ERROR through before the next command
+                while (_uart->available()) _uart->read();
+                return false;
+            }
+            matched++;
+        }
+        if (matched < len){
+            return false;
+        }
+        //drop the rest of the line and the ERROR result
+        delay(50);
+        while (_uart->available()) _uart->read();
+        _lastResponseOrUrcMillis = millis();
+    }
+    return true;
+}
+
+unsigned long ModemClass::negotiateBaud(unsigned long maxBaud, bool flowControl)
+{
+    //_baud is left alone: it is the rate the modem boots with, which init() and restart() use
+    unsigned long current = _baud;
+    if (flowControl && !setFlowControl(true)){
+        return current;
+    }
+    if (!turnEcho(true)){
+        return current;
+    }
+
+    for (uint8_t i = 0; i < sizeof(MODEM_BAUD_RATES) / sizeof(MODEM_BAUD_RATES[0]); i++){
+        unsigned long baud = MODEM_BAUD_RATES[i];
+        if (baud <= current){
+            continue;
+        }
+        if (baud > maxBaud){
+            break;
+        }
+
+        unsigned long good = current;
+        if (switchBaud(baud) && echoTest()){
+            current = baud;
+            DBG("#DEBUG# baud rate ", current, " verified");
+            continue;
+        }
+
+        DBG("#DEBUG# baud rate ", baud, " failed");
+        //fall back to the last good rate, whichever rate the modem ended up at
+        if (autosense(MODEM_BAUD_AUTOSENSE_MS) && switchBaud(good)){
+            return current;
+        }
+        _uart->end();
+        delay(100);
+        _uart->begin(good);
+        if (autosense(MODEM_BAUD_AUTOSENSE_MS)){
+            return current; //AT+IPR never took effect
+        }
+        DBG("#DEBUG# modem lost during baud negotiation");
+        return 0;
+    }
+    return current;
+}
+
 void ModemClass::addUrcHandler(ModemUrcHandler* handler)
 {
     for (int i = 0; i < MAX_URC_HANDLERS; i++) {
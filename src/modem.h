@@ -6,8 +6,10 @@
 
 #include <Arduino.h>
 
+#include "GSMTimer.h"
 
 #define MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS 20
+#define MAX_SOCKETS 3
 
 //uncomment next line to debug on SerialUSB
 #define GSM_DEBUG SerialUSB
@@ -23,6 +25,12 @@
     "#DEBUG# URC received: X"
 */
 
+//uncomment next line to record the startup timeline, see GSMTrace.h
+//#define GSM_TRACE
+
+//uncomment next line on RTOS builds to share a modem between tasks, see GSMOwner.h (always on for host builds)
+//#define GSM_CONCURRENT
+
 #ifdef GSM_DEBUG
 namespace {
 template <typename T>
@@ -54,13 +62,56 @@ static const char GSM_OK[] PROGMEM = "\r\nOK\r\n";
 static const char GSM_ERROR[] PROGMEM = "\r\nERROR\r\n";
 static const char GSM_CME_ERROR[] PROGMEM = "+CME ERROR";
 static const char GSM_CMS_ERROR[] PROGMEM = "+CMS ERROR";
-static const char CLOCK_FORMAT[] PROGMEM = "+CCLK: \"%y/%m/%d,%H:%M:%S\"";
 static const char PROMPT[] PROGMEM = "\r\n>";
 
 
 class GSM_Socket;
 class GPRS;
 
+static const char PROBE_COMMAND[] PROGMEM = "AT+CPIN?;+CREG?;+CGATT?;+CIPSTATUS";
+
+/* Modem state read with one batched command by ModemClass::probe(). It lets GSM::init()
+    and GPRS::attachGPRS() skip the steps a modem that kept running already went through.
+*/
+struct ModemProbe {
+    bool valid;
+    bool simReady;
+    uint8_t creg;       //<stat> of +CREG, 4 (unknown) if not reported
+    bool attached;
+    bool pdpActive;     //IP GPRSACT, IP STATUS or IP PROCESSING
+
+    ModemProbe();
+    void parse(const char* response);
+    bool registered();
+};
+
+//subsystems modem usage is accounted to, from the command prefix or the URC
+enum ModemSubsystem {SUBSYSTEM_GSM, SUBSYSTEM_GPRS, SUBSYSTEM_LOCATION, SUBSYSTEM_SMS, SUBSYSTEMS};
+
+/* Usage counters kept by ModemClass, always on: a few increments per command or byte.
+    See GSMEnergy.h for the energy estimate.
+*/
+struct ModemUsage {
+    uint32_t commands[SUBSYSTEMS];
+    uint32_t bytesOut[SUBSYSTEMS];      //UART, commands and payload
+    uint32_t bytesIn[SUBSYSTEMS];       //UART, responses and URCs
+    unsigned long awakeMillis[SUBSYSTEMS]; //low power mode windows, by the subsystem that woke the modem
+    uint32_t socketSent[MAX_SOCKETS];   //TCP payload, data mode counts as socket 0
+    uint32_t socketReceived[MAX_SOCKETS];
+    uint32_t cipsends;
+    uint32_t connects;                  //CIPSTART attempts
+    unsigned long gnssMillis;           //between AT+GPS=1 and AT+GPS=0
+};
+
+/* Remembers on the MCU side the hash of the configuration last saved on the modem with
+    AT&W, so that ModemClass::init() can skip applying it again. See GSMProfile.h.
+*/
+class ModemProfileStore {
+    public:
+    virtual bool load(uint32_t& hash) = 0;
+    virtual bool save(uint32_t hash) = 0;
+};
+
 class ModemUrcHandler {
     public:
     virtual void handleUrc(const void* data, uint16_t len) = 0;
@@ -71,21 +122,59 @@ class ModemClass
 public:
     friend class GPRS;
     friend class GSM_Socket;
+    friend class GSMSms;
+    friend class ModemScheduler;
+    /** Modem on uart, with the pins in the GSM_*_PIN globals
+    */
     ModemClass(Uart& uart, unsigned long baud);
+    /** Modem with pins of its own, e.g. one of several on a gateway. Every GSM, GPRS,
+        GSMLocation... object takes the ModemClass it drives, MODEM by default.
+    */
+    ModemClass(Uart& uart, unsigned long baud, uint8_t pwrPin, uint8_t rstPin, uint8_t lowPwrPin);
     bool init();
     bool powerOff();
+    uint8_t pwrPin();
+    uint8_t rstPin();
+    uint8_t lowPwrPin();
     bool autosense(unsigned int timeout = 10000);
     bool noop();
     bool factoryReset();
     bool restart();
 
+    /** Query SIM, registration, attach and PDP context state in one batch
+      @return true if lastProbe() is valid
+    */
+    bool probe(unsigned long timeout = 1000);
+    ModemProbe& lastProbe();
+
+    /** Save the init() configuration on the modem and its hash in store, later boots
+        only re-apply it when the configuration changed or the modem lost it, which one
+        AT+CIPSPRT? query tells
+    */
+    void setProfileStore(ModemProfileStore* store);
+
     void lowPowerMode();
     void noLowPowerMode();
+
+    /** Keep the modem awake in low power mode until the matching releaseAwake(), so
+        that a batch of commands costs one wake up instead of one per command
+    */
+    void holdAwake();
+    void releaseAwake();
+    bool awake();
+    uint32_t wakeCount();
+    unsigned long awakeTime(); //ms the low power pin was high
+    void resetPowerStats();
+
+    /** Usage counters, gnssMillis and awakeMillis include the current period
+    */
+    ModemUsage usage();
+    void resetUsage(); //resets the power stats too
     uint16_t write(uint8_t c);
     uint16_t write(const uint8_t* buf, uint16_t len);
     void flush();
     void send(const char* command);
-    void send(__FlashStringHelper* command);
+    void send(const __FlashStringHelper* command);
     void send(const String& command)
     {
         send(command.c_str());
@@ -94,10 +183,45 @@ public:
 
 
     int waitForResponse(unsigned long timeout = 100L, String* responseDataStorage = NULL);
+    /** Give up on the pending response, as waitForResponse() does on timeout
+    */
+    void cancel();
+    /** Read the uart and advance timers()
+    */
     void poll();
     void checkUrc();
     uint8_t ready();
+    /** Deadlines of every pending operation on this modem, see GSMTimer.h
+    */
+    GSMTimerWheel& timers();
+    /** True when no command is in flight and no socket data is being received,
+        background services use it to slip their commands in
+    */
+    bool idle();
     void setBaudRate(unsigned long baud);
+    unsigned long baudRate();
+
+    /** Step the UART up through the supported rates, verifying each one with a payload
+        echo test, and settle on the highest one that passed. The rate is not saved on
+        the modem, pass the result to setBaudRate() to use it from init() again.
+      @param maxBaud     highest rate to try
+      @param flowControl enable RTS/CTS first, see setFlowControl()
+      @return the rate in use, 0 if the modem was lost
+    */
+    unsigned long negotiateBaud(unsigned long maxBaud = 921600, bool flowControl = false);
+
+    /** Hardware flow control on the modem side (AT+IFC=2,2). The Uart has to be
+        constructed with its RTS/CTS pins for the MCU side.
+    */
+    bool setFlowControl(bool on);
+
+    /** Transparent data mode, see GPRS::openDataMode(). While it is on the UART carries
+        raw payload: poll() leaves it alone and send() fails without writing anything.
+        It ends by itself when the peer closes and the modem prints CLOSED or NO CARRIER.
+    */
+    bool dataMode();
+    int dataAvailable();
+    uint16_t dataRead(void* buf, uint16_t len, unsigned long timeout = 1000L);
     void removeUrcHandler(ModemUrcHandler* handler);
     void addUrcHandler(ModemUrcHandler* handler);
     bool turnEcho(bool on);    
@@ -111,13 +235,29 @@ public:
 private:
     Uart* _uart;
     unsigned long _baud;
+    uint8_t* _pwrPin;       //the globals, or _pins
+    uint8_t* _rstPin;
+    uint8_t* _lowPwrPin;
+    uint8_t _pins[3];
     bool _lowPowerMode;
+    bool _awake;
+    uint8_t _awakeHolds;
+    uint32_t _wakeCount;
+    unsigned long _awakeSince;
+    unsigned long _awakeMillis;
+    void wake();
+    void sleep();
+    void account(const char* command);
+    ModemUsage _usage;
+    ModemSubsystem _subsystem;     //of the last command
+    ModemSubsystem _wakeSubsystem;
+    unsigned long _gnssSince;
+    bool _gnssOn;
     unsigned long _lastResponseOrUrcMillis;
     bool _init;
     uint16_t _chunkLen;
     uint8_t _sock; //socket that will receive the chunk
     void beginSend();
-    #define MAX_SOCKETS 3
     GSM_Socket* _sockets[MAX_SOCKETS] = {NULL};
     uint8_t _initSocks;
     
@@ -137,7 +277,25 @@ private:
     bool _sent;
     String _buffer;
     String* _responseDataStorage;
-    #define MAX_URC_HANDLERS 1
+    ModemProbe _probe;
+    ModemProfileStore* _profileStore;
+    GSMTimerWheel _timers;
+    uint32_t profileHash();
+    bool profileSaved();
+    bool initSequence();
+    bool echoTest();
+    bool startDataMode(const char* command, unsigned long timeout);
+    bool escapeDataMode();
+    void pumpData();
+    bool _dataMode;
+    bool _dataClosed;   //the peer closed the connection, the modem is back in command mode
+    #define MODEM_DATA_BUFFER 32
+    uint8_t _dataIn[MODEM_DATA_BUFFER];
+    uint8_t _dataLen;
+    uint8_t _dataHeld;  //trailing bytes of _dataIn that may start a close line
+    unsigned long _dataMillis;
+    bool switchBaud(unsigned long baud);
+    #define MAX_URC_HANDLERS 8
     ModemUrcHandler* _urcHandlers[MAX_URC_HANDLERS] = {NULL};
 };
 
@@ -1,6 +1,7 @@
 #include "socket.h"
 
-GSM_Socket::GSM_Socket(uint8_t mux):
+GSM_Socket::GSM_Socket(ModemClass& modem, uint8_t mux):
+    _modem(&modem),
     _mux(mux),
     _freeIndex(0),
     _free(BUFFER_MAX)
@@ -41,7 +42,8 @@ uint16_t GSM_Socket::read(void* buf, uint16_t len, unsigned long timeout) //TODO
     }
     else{
         uint16_t len_r = len;
-        for (unsigned long start = millis(); (millis() - start) < timeout && len_r > 0;){
+        GSMTimer deadline;
+        for (_modem->timers().arm(deadline, timeout); !deadline.expired() && len_r > 0;){
             uint16_t readNow = min(len_r, BUFFER_MAX - _free);
             for(int i = 0; i < readNow; i++){
                 bufB[i] = _buffer[readIndex];
@@ -50,23 +52,39 @@ uint16_t GSM_Socket::read(void* buf, uint16_t len, unsigned long timeout) //TODO
             _free += readNow;
             len_r -= readNow;
             delay(100);
-            MODEM.poll(); //let the modem read other expected data from the stream
+            _modem->poll(); //let the modem read other expected data from the stream
         }
         return len - len_r;
     }
 }
 
+uint16_t GSM_Socket::available()
+{
+    return BUFFER_MAX - _free;
+}
+
 uint16_t GSM_Socket::send(const void* buff, uint16_t len) 
+{
+    if (!sendStart(buff, len)) return 0;
+    return sendEnd(_modem->waitForResponse(60 * 1000), len); //OK if successfull; what if fail? TODO
+}
+
+bool GSM_Socket::sendStart(const void* buff, uint16_t len)
 {
     //String prompt(PROMPT);
-    if (!MODEM.turnEcho(false)) return 0;
-    MODEM.sendf("AT+CIPSEND=%d,%d", _mux, (uint16_t) len); 
-    MODEM._atCommandState = ModemClass::AT_RECV_RESP;
-    MODEM.write(reinterpret_cast<const uint8_t*>(buff), len);
-    MODEM.write(0x1A); //tell modem to send
-    MODEM.flush();
-    uint8_t resp = MODEM.waitForResponse(60 * 1000); //OK if successfull; what if fail? TODO
-    if (resp != 1) return 0;
-    MODEM.turnEcho(true);
+    if (!_modem->turnEcho(false)) return false;
+    _modem->sendf("AT+CIPSEND=%d,%d", _mux, (uint16_t) len); 
+    _modem->_atCommandState = ModemClass::AT_RECV_RESP;
+    _modem->write(reinterpret_cast<const uint8_t*>(buff), len);
+    _modem->write(0x1A); //tell modem to send
+    _modem->flush();
+    return true;
+}
+
+uint16_t GSM_Socket::sendEnd(int result, uint16_t len)
+{
+    if (result != 1) return 0;
+    _modem->_usage.socketSent[_mux] += len;
+    _modem->turnEcho(true);
     return len;
 }
@@ -11,11 +11,15 @@ public:
     friend class ModemClass;
     friend class GPRS;
 private:
-    GSM_Socket(uint8_t mux);
+    GSM_Socket(ModemClass& modem, uint8_t mux);
     bool close(unsigned long timeout = 1000L);
     uint16_t read(void* buffer, uint16_t len = 1, unsigned long timeout = 1000L);
+    uint16_t available();
     uint16_t send(const void * buff, uint16_t len);
+    bool sendStart(const void* buff, uint16_t len);  //writes the data, the response is pending
+    uint16_t sendEnd(int result, uint16_t len);
     void handleUrc(const void* urc, uint16_t len);
+    ModemClass* _modem;
     uint8_t _mux;
     uint8_t _buffer[BUFFER_MAX];
     uint8_t _freeIndex;